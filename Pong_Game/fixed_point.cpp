@@ -0,0 +1,69 @@
+// <------------------------- Simulation Numbers -------------------------------------->
+// Simulation state and coefficients are `real`: float by default, or with PONG_FIXED_POINT a 16.16
+// fixed-point number. Fixed-point arithmetic is all integer, so every compiler, optimization level
+// and vector width gives the same bits (float can differ, eg. with fused multiply-adds).
+// Rendering and other consumers convert with (float) and (int), which compile for either type.
+#include <math.h>
+
+#ifndef PONG_FIXED_POINT
+#define PONG_FIXED_POINT 0
+#endif
+
+#if PONG_FIXED_POINT
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+
+// Range is +-32767 with a resolution of 1/65536, products and quotients go through 64 bits.
+// Literals and ints convert implicitly, so `x * .5f` and `y > 0` read the same as with floats.
+struct Fixed {
+	s32 raw;
+
+	Fixed() = default;
+	constexpr Fixed(float value) : raw((s32)(value * FIXED_ONE + (value < 0 ? -.5f : .5f))) {}
+	constexpr Fixed(double value) : raw((s32)(value * FIXED_ONE + (value < 0 ? -.5 : .5))) {}
+	constexpr Fixed(int value) : raw(value * FIXED_ONE) {}
+
+	explicit constexpr operator float() const { return (float)raw * (1.f / FIXED_ONE); }
+	explicit constexpr operator int() const { return raw / FIXED_ONE; }   // Truncates like (int) of a float
+};
+
+inline Fixed
+fixed_from_raw(s32 raw) {
+	Fixed result;
+	result.raw = raw;
+	return result;
+}
+
+inline Fixed operator+(Fixed a, Fixed b) { return fixed_from_raw(a.raw + b.raw); }
+inline Fixed operator-(Fixed a, Fixed b) { return fixed_from_raw(a.raw - b.raw); }
+inline Fixed operator-(Fixed a) { return fixed_from_raw(-a.raw); }
+
+// Rounded to nearest, the shift of a negative product is arithmetic on every compiler the game targets
+inline Fixed operator*(Fixed a, Fixed b) { return fixed_from_raw((s32)(((s64)a.raw * b.raw + FIXED_ONE / 2) >> FIXED_SHIFT)); }
+inline Fixed operator/(Fixed a, Fixed b) { return fixed_from_raw((s32)(((s64)a.raw << FIXED_SHIFT) / b.raw)); }
+
+inline Fixed& operator+=(Fixed& a, Fixed b) { return a = a + b; }
+inline Fixed& operator-=(Fixed& a, Fixed b) { return a = a - b; }
+inline Fixed& operator*=(Fixed& a, Fixed b) { return a = a * b; }
+inline Fixed& operator/=(Fixed& a, Fixed b) { return a = a / b; }
+
+inline bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+inline bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+inline bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+inline bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+inline bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+inline bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+// Remainder with the sign of a, like fmodf
+inline Fixed real_mod(Fixed a, Fixed b) { return fixed_from_raw(a.raw % b.raw); }
+
+typedef Fixed real;
+
+#else
+
+inline float real_mod(float a, float b) { return fmodf(a, b); }
+
+typedef float real;
+
+#endif
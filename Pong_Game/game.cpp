@@ -8,71 +8,183 @@ enum Gamemode {
 	GM_PAUSED,
 	GM_QUIT,
 	GM_ENDSTATE,
+	GM_STRESS,
+	GM_NETPLAY,
 };
 
 Gamemode current_gamemode = GM_MENU;
 
 // ------------------ (1) Environment data -----------------------
+#include "fixed_point.cpp"
 
 // Arena Data
-const float arena_px = 0.f;
-const float arena_py = 0.f;
-const float arena_half_size_x = 90.f;
-const float arena_half_size_y = 45.f;
+const real arena_px = 0.f;
+const real arena_py = 0.f;
+const real arena_half_size_x = 90.f;
+const real arena_half_size_y = 45.f;
 
 // Ball Data
-float ball_hsx = 1.f;
-float ball_hsy = 1.f;
-float ball_py = 0.f, ball_dpy = 1.f;
-float ball_px = 0.f, ball_dpx = 100.f;
+real ball_hsx = 1.f;
+real ball_hsy = 1.f;
 
 // Ball Collision Coefficients
-float ball_max_speed_x = 135.f;
-float ball_min_speed_x = 25.f;
-float ball_max_speed_y = 160.f;
-float front_hit_coeff_x = -1.01f;       // Velocity dir should flip when ball hits the front side
-float back_hit_coeff_x = 1.1f;          // Veclocity dir should remain the same when ball hits the back side
-float player_transfer_coeff_x = .5f;
-float player_transfer_coeff_y = .75f;
-float ball_pos_transfer_coeff_y = 1.5f;
+real ball_max_speed_x = 135.f;
+real ball_min_speed_x = 25.f;
+real ball_max_speed_y = 160.f;
+real front_hit_coeff_x = -1.01f;       // Velocity dir should flip when ball hits the front side
+real back_hit_coeff_x = 1.1f;          // Veclocity dir should remain the same when ball hits the back side
+real player_transfer_coeff_x = .5f;
+real player_transfer_coeff_y = .75f;
+real ball_pos_transfer_coeff_y = 1.5f;
 
 // Common Player Data
-float player_hsx = 2.5f;
-float player_hsy = 12.f;
-float player_px = 80.f;
-#define player_fixed_ddpx 300.f
-#define player_fixed_ddpy 600.f
-#define player_friction_coeff 1.75f
+real player_hsx = 2.5f;
+real player_hsy = 12.f;
+real player_px = 80.f;
+real player_fixed_ddpx = 300.f;
+real player_fixed_ddpy = 600.f;
+real player_friction_coeff = 1.75f;
 
 // Gameplay Data
-const int win_score = 21;                 // Default 21 pts is the win condition
-float arena_coverage = .6f;               // Default 60% of each arena side allowed to move in
+int win_score = 21;                       // Default 21 pts is the win condition
+real arena_coverage = .6f;               // Default 60% of each arena side allowed to move in
 bool is_player1_ai = false;               // By default, player 1 is for the user
 bool is_player2_ai = true;                // By default, player 2 is the AI
 
+// AI Difficulty
+real ai_reaction_delay = .2f;            // Seconds before the AI acts on a new ball path
+real ai_aim_error = 15.f;                // Largest offset (in units) of the AI's target from the predicted intercept, over 13 it can miss
+
+// Menu Background
+int animated_menu_background = 0;        // 1 draws the procedural background behind the menus, which then animate instead of idling
+float menu_background_time = 0.f;
+
+#include "tuning.cpp"
+
 enum PlayerNum {
 	PLAYER_NULL,
 	PLAYER_ONE,
 	PLAYER_TWO,
 };
 
-PlayerNum which_player_won = PLAYER_NULL; // By default, no player has won
+// ------------------ (2) Entity Pools ---------------------------
+// Paddles and balls are kept in structure-of-arrays pools: each field that every tick reads and writes
+// (positions, velocities) is one contiguous array so the update loops can be vectorized, while the
+// rarely touched fields (sizes, colours, controls) live apart in the traits structs
+
+#define MAX_PADDLES 4
+#define MAX_BALLS 16
+
+// Side of the court a paddle defends, player 1 is on the right
+enum Court_Side {
+	SIDE_RIGHT,
+	SIDE_LEFT,
+
+	SIDE_COUNT,
+};
+
+struct Paddle_Pool {
+	int count;
+	real px[MAX_PADDLES], py[MAX_PADDLES];
+	real dpx[MAX_PADDLES], dpy[MAX_PADDLES];       // Speed in units per second
+	real ddpx[MAX_PADDLES], ddpy[MAX_PADDLES];     // Acceleration asked for this tick by the input or the AI
+	bool hit_ball[MAX_PADDLES];
+};
+
+struct Paddle_Traits {
+	real half_size_x[MAX_PADDLES], half_size_y[MAX_PADDLES];
+	u32 color[MAX_PADDLES];
+	Court_Side side[MAX_PADDLES];
+	bool is_ai[MAX_PADDLES];
+	Button_Key key_up[MAX_PADDLES], key_down[MAX_PADDLES], key_left[MAX_PADDLES], key_right[MAX_PADDLES];
+};
+
+struct Ball_Pool {
+	int count;
+	real px[MAX_BALLS], py[MAX_BALLS];
+	real dpx[MAX_BALLS], dpy[MAX_BALLS];
+};
+
+struct Ball_Traits {
+	real half_size_x[MAX_BALLS], half_size_y[MAX_BALLS];
+	u32 color[MAX_BALLS];
+};
+
+// Each AI paddle's cached plan for the first ball. Between serves and paddle hits the ball only moves
+// in a straight line and reflects off the top and bottom walls, so its arrival is computed once per
+// such event instead of being chased every tick
+struct Ai_Plans {
+	u32 planned_event[MAX_PADDLES];                  // ball_events the plan was made for
+	real target_py[MAX_PADDLES];                    // Where the paddle is heading now
+	real next_target_py[MAX_PADDLES];               // Target of the latest plan, taken up after the reaction delay
+	real reaction_timer[MAX_PADDLES];
+	real intercept_timer[MAX_PADDLES];              // Seconds until the ball reaches the paddle, < 0 when it is moving away
+};
+
+struct Game_State {
+	// Hot: simulated every tick
+	Paddle_Pool paddles;
+	Ball_Pool balls;
+	int score[SIDE_COUNT];
+	PlayerNum which_player_won;             // By default, no player has won
+	u32 random_state;                       // Serve directions, part of the state so replays and rollbacks repeat them
+	bool keeps_stats;                       // Whether points and wins go into save_data
+	u32 ball_events;                        // Serves and paddle hits so far, the only changes of a ball's path the AI cannot predict
+	Ai_Plans ai;
+	u32 ai_random_state;                    // Aim errors, kept apart so the AI does not change the serves
+
+	// Cold: set up once per match
+	Paddle_Traits paddle_traits;
+	Ball_Traits ball_traits;
+};
+
+Game_State game_state = {};
 
-// ------------------ (2) Player1 data ---------------------------
-float player1_py, player1_dpy;          // Speed in units per second
-float player1_px = player_px, player1_dpx;
-float player1_half_size_x = player_hsx;
-float player1_half_size_y = player_hsy;
-bool player1_hit_ball = false;
-int player1_score = 0;
+internal void
+add_paddle(Game_State* state, Court_Side side, real px, bool is_ai,
+	Button_Key key_up, Button_Key key_down, Button_Key key_left, Button_Key key_right) {
+	Paddle_Pool* paddles = &state->paddles;
+	Paddle_Traits* traits = &state->paddle_traits;
+	int i = paddles->count++;
+
+	paddles->px[i] = px, paddles->py[i] = 0.f;
+	paddles->dpx[i] = 0.f, paddles->dpy[i] = 0.f;
+	paddles->hit_ball[i] = false;
+
+	traits->half_size_x[i] = player_hsx;
+	traits->half_size_y[i] = player_hsy;
+	traits->color[i] = 0x8B0000;
+	traits->side[i] = side;
+	traits->is_ai[i] = is_ai;
+	traits->key_up[i] = key_up, traits->key_down[i] = key_down;
+	traits->key_left[i] = key_left, traits->key_right[i] = key_right;
+}
+
+internal void
+add_ball(Game_State* state, real px, real py, real dpx, real dpy) {
+	Ball_Pool* balls = &state->balls;
+	int i = balls->count++;
+
+	balls->px[i] = px, balls->py[i] = py;
+	balls->dpx[i] = dpx, balls->dpy[i] = dpy;
+	state->ball_events++;                   // A new ball is a serve
 
-// ------------------ (3) Player2 data ---------------------------
-float player2_py, player2_dpy;          // Speed in units per second
-float player2_px = -player_px, player2_dpx;
-float player2_half_size_x = player_hsx;
-float player2_half_size_y = player_hsy;
-bool player2_hit_ball = false;
-int player2_score = 0;
+	state->ball_traits.half_size_x[i] = ball_hsx;
+	state->ball_traits.half_size_y[i] = ball_hsy;
+	state->ball_traits.color[i] = 0xffff66;
+}
+
+// Sets up a fresh match: player 1 on the right with the arrow keys, player 2 on the left with WASD
+internal void
+init_match(Game_State* state) {
+	*state = {};
+	state->random_state = (u32)os_get_time_counter() | 1;
+	state->ai_random_state = state->random_state ^ 0x9e3779b9;
+	state->keeps_stats = true;
+	add_paddle(state, SIDE_RIGHT, player_px, is_player1_ai, BUTTON_UP, BUTTON_DOWN, BUTTON_LEFT, BUTTON_RIGHT);
+	add_paddle(state, SIDE_LEFT, -player_px, is_player2_ai, BUTTON_W, BUTTON_S, BUTTON_A, BUTTON_D);
+	add_ball(state, 0.f, 0.f, 100.f, 1.f);
+}
 
 // <-------------------- Menu System ----------------------------->
 
@@ -90,75 +202,140 @@ int view_stats_menu;
 int hot_quit_button;
 bool game_paused = false;
 
+// Screen fades: match starts fade in from black and dialogs dim the arena in over a few frames
+float fade_time;                            // Seconds left of the running fade, counted down every frame
+float fade_duration;
+
+internal void
+start_fade(float duration) {
+	fade_time = duration;
+	fade_duration = duration;
+}
+
+// 0 when a fade starts, 1 once it is done
+internal float
+fade_progress() {
+	return fade_time > 0 ? 1.f - fade_time / fade_duration : 1.f;
+}
+
+// Over a frame that was just drawn, while a match start fade runs
+internal void
+draw_fade_from_black() {
+	if (fade_time > 0) blend_screen<BLEND_ALPHA>(0x000000, (u32)(255.f * (1.f - fade_progress())));
+}
+
 // --------------------- Player stats ----------------------------
 #include "save_stats.cpp"
 
+// -------------------- Player profiles --------------------------
+#include "profile_store.cpp"
+
+Profile_Store profile_store;
+const char* profile_store_error;            // Why profiles are off for the session, shown on the leaderboard
+Profile_Ranking leaderboard_ranking;
+u32 leaderboard_first;                      // Rank of the top row on the leaderboard page
+
+// The store is opened the first time it is needed, sized for the profiles in the file. The platform
+// reserved get_profile_store_memory_size() for it in the permanent arena, which also serves as the
+// scratch memory while the file is read. 0 when it cannot be opened, with the reason in profile_store_error.
+internal Profile_Store*
+get_profile_store() {
+	if (!profile_store.capacity && !profile_store_error) {
+		u32 capacity = get_profile_store_capacity();
+		Memory_Arena* arena = &game_memory.permanent;
+		if (arena->size - arena->used < get_profile_store_memory_size(capacity)) profile_store_error = "TOO MANY PROFILES";
+		else if (!init_profile_store(&profile_store, arena, capacity)) profile_store_error = "TOO MANY PROFILES";
+	}
+	if (!profile_store.opened && !profile_store_error && !load_profile_store(&profile_store, &game_memory.permanent)) {
+		profile_store_error = "PROFILE FILE UNREADABLE";
+	}
+	return profile_store_error ? 0 : &profile_store;
+}
+
+internal int
+format_profile_report(char* buffer, int size) {
+	if (profile_store_error) return snprintf(buffer, size, "profiles: off, %s", profile_store_error);
+	return snprintf(buffer, size, "profiles: %u of %u, %llu page reads", profile_store.count, profile_store.capacity,
+		(unsigned long long)profile_store.page_reads);
+}
+
 // -------------------- Menu Function ----------------------------
 #include "menu.cpp"
 
+// ---------------------------- Sound ----------------------------
+#include "sound.cpp"
+
 // ------------------ (4) Helper Functions -----------------------
 
 // ----------------- Simulate Player Helper ----------------------
+// Moves every paddle in the pool using the acceleration requested for it this tick
 internal void
-simulate_player(float* player_py, float* player_dpy, float player_ddpy,
-	float* player_px, float* player_dpx, float player_ddpx, float dt) {
-
-	// Friction:-
-	player_ddpy -= (*player_dpy * player_friction_coeff);
-	player_ddpx -= (*player_dpx * player_friction_coeff);
-
-	// Equations of motion:-
-	*player_py = *player_py + (*player_dpy * dt) + (player_ddpy * dt * dt * .5f);
-	*player_dpy = *player_dpy + (player_ddpy * dt);
-	*player_px = *player_px + (*player_dpx * dt) + (player_ddpx * dt * dt * .5f);
-	*player_dpx = *player_dpx + (player_ddpx * dt);
-
-	// Wall Collisions:-
-	if (*player_py + player_hsy > arena_half_size_y) {
-		*player_py = arena_half_size_y - player_hsy;
-		*player_dpy *= -.05f;   // Bouncing back effect
-	}
-	else if (*player_py - player_hsy < -arena_half_size_y) {
-		*player_py = -arena_half_size_y + player_hsy;
-		*player_dpy *= -.05f;   // Bouncing back effect
+simulate_player(Paddle_Pool* paddles, const Paddle_Traits* traits, real dt) {
+	int count = paddles->count;
+
+	for (int i = 0; i < count; i++) {
+		// Friction:-
+		real ddpy = paddles->ddpy[i] - (paddles->dpy[i] * player_friction_coeff);
+		real ddpx = paddles->ddpx[i] - (paddles->dpx[i] * player_friction_coeff);
+
+		// Equations of motion:-
+		paddles->py[i] = paddles->py[i] + (paddles->dpy[i] * dt) + (ddpy * dt * dt * .5f);
+		paddles->dpy[i] = paddles->dpy[i] + (ddpy * dt);
+		paddles->px[i] = paddles->px[i] + (paddles->dpx[i] * dt) + (ddpx * dt * dt * .5f);
+		paddles->dpx[i] = paddles->dpx[i] + (ddpx * dt);
 	}
 
-	if (*player_px + player_hsx > arena_half_size_x) {
-		*player_px = arena_half_size_x - player_hsx;
-		*player_dpx *= -.05f;   // Bouncing back effect
-	}
-	else if (*player_px - player_hsx < -arena_half_size_x) {
-		*player_px = -arena_half_size_x + player_hsx;
-		*player_dpx *= -.05f;   // Bouncing back effect
-	}
+	for (int i = 0; i < count; i++) {
+		real hsx = traits->half_size_x[i];
+		real hsy = traits->half_size_y[i];
 
-	// Border Collisions:-
-	if (*player_px > 0 && *player_px + player_hsx < (1.f - arena_coverage) * arena_half_size_x) {
-		*player_px = (1.f - arena_coverage) * arena_half_size_x - player_hsx;
-		*player_dpx *= -0.f;   // No bouncing back effect
-	}
-	else if (*player_px < 0 && *player_px - player_hsx > -(1.f - arena_coverage) * arena_half_size_x) {
-		*player_px = -(1.f - arena_coverage) * arena_half_size_x + player_hsx;
-		*player_dpx *= -0.f;   // No bouncing back effect
+		// Wall Collisions:-
+		if (paddles->py[i] + hsy > arena_half_size_y) {
+			paddles->py[i] = arena_half_size_y - hsy;
+			paddles->dpy[i] *= -.05f;   // Bouncing back effect
+		}
+		else if (paddles->py[i] - hsy < -arena_half_size_y) {
+			paddles->py[i] = -arena_half_size_y + hsy;
+			paddles->dpy[i] *= -.05f;   // Bouncing back effect
+		}
+
+		if (paddles->px[i] + hsx > arena_half_size_x) {
+			paddles->px[i] = arena_half_size_x - hsx;
+			paddles->dpx[i] *= -.05f;   // Bouncing back effect
+		}
+		else if (paddles->px[i] - hsx < -arena_half_size_x) {
+			paddles->px[i] = -arena_half_size_x + hsx;
+			paddles->dpx[i] *= -.05f;   // Bouncing back effect
+		}
+
+		// Border Collisions:-
+		if (paddles->px[i] > 0 && paddles->px[i] + hsx < (1.f - arena_coverage) * arena_half_size_x) {
+			paddles->px[i] = (1.f - arena_coverage) * arena_half_size_x - hsx;
+			paddles->dpx[i] *= -0.f;   // No bouncing back effect
+		}
+		else if (paddles->px[i] < 0 && paddles->px[i] - hsx > -(1.f - arena_coverage) * arena_half_size_x) {
+			paddles->px[i] = -(1.f - arena_coverage) * arena_half_size_x + hsx;
+			paddles->dpx[i] *= -0.f;   // No bouncing back effect
+		}
 	}
 }
 
 // ----------------- AABB vs AABB Collision ----------------------
 internal bool
-aabb_vs_aabb(float ax, float ay, float a_hsx, float a_hsy,
-	float bx, float by, float b_hsx, float b_hsy) {
+aabb_vs_aabb(real ax, real ay, real a_hsx, real a_hsy,
+	real bx, real by, real b_hsx, real b_hsy) {
 
 	// a is ball, b are the players
 
-	float right_ball = ax + a_hsx;
-	float left_player = bx - b_hsx;
-	float left_ball = ax - a_hsx;
-	float right_player = bx + b_hsx;
+	real right_ball = ax + a_hsx;
+	real left_player = bx - b_hsx;
+	real left_ball = ax - a_hsx;
+	real right_player = bx + b_hsx;
 
-	float top_ball = ay + a_hsy;
-	float bottom_player = by - b_hsy;
-	float bottom_ball = ay - a_hsy;
-	float top_player = by + b_hsy;
+	real top_ball = ay + a_hsy;
+	real bottom_player = by - b_hsy;
+	real bottom_ball = ay - a_hsy;
+	real top_player = by + b_hsy;
 
 	return (right_ball > left_player && // Collision in +ve X (left of player)
 		left_ball < right_player &&     // Collision in -ve X (right of player)
@@ -167,211 +344,372 @@ aabb_vs_aabb(float ax, float ay, float a_hsx, float a_hsy,
 }
 
 // ----------------- AI Simulation Helper -----------------------
+// Folds an unbounded y back into [-limit, limit], as if it had bounced off walls at +-limit
+internal real
+reflect_into_range(real y, real limit) {
+	real period = 4.f * limit;
+	real folded = real_mod(y + limit, period);
+	if (folded < 0) folded += period;
+	if (folded > 2.f * limit) folded = period - folded;
+	return folded - limit;
+}
+
+// Plans paddle i's next move from the first ball's current path: where and when the ball reaches
+// the paddle's front face when it is coming this way, back to the centre otherwise
+internal void
+plan_ai_intercept(Game_State* state, int i) {
+	Ai_Plans* ai = &state->ai;
+	const Ball_Pool* balls = &state->balls;
+	real facing = (state->paddle_traits.side[i] == SIDE_RIGHT) ? 1.f : -1.f;    // Direction from the centre to the paddle's side
+
+	ai->planned_event[i] = state->ball_events;
+	ai->reaction_timer[i] = ai_reaction_delay;
+	ai->next_target_py[i] = 0.f;
+	ai->intercept_timer[i] = -1.f;
+
+	if (facing * balls->dpx[0] <= 0) return;
+	real column_px = facing * (player_px - state->paddle_traits.half_size_x[i] - state->ball_traits.half_size_x[0]);
+	real time = (column_px - balls->px[0]) / balls->dpx[0];
+	if (time < 0) return;                                   // Already past the paddle
+
+	real limit = arena_half_size_y - state->ball_traits.half_size_y[0];
+	real error = ai_aim_error * (real)((float)(random_u32(&state->ai_random_state) & 0xffff) / 32767.5f - 1.f);
+	ai->next_target_py[i] = reflect_into_range(balls->py[0] + balls->dpy[0] * time, limit) + error;
+	ai->intercept_timer[i] = time;
+}
+
+// Sets the AI's acceleration for paddle i: replans only when the ball was served or hit, then steers
+// towards the cached target, so a tick costs the same however far away the ball is
+internal void
+simulate_ai(Game_State* state, int i, real dt) {
+	Ai_Plans* ai = &state->ai;
+	Paddle_Pool* paddles = &state->paddles;
+	if (ai->planned_event[i] != state->ball_events) plan_ai_intercept(state, i);
+
+	// Keeps following the old plan until it has reacted to the new one
+	ai->reaction_timer[i] -= dt;
+	if (ai->reaction_timer[i] <= 0) ai->target_py[i] = ai->next_target_py[i];
+	ai->intercept_timer[i] -= dt;
+
+	// Critically damped spring to the target (friction already takes 1.75 * dpy), capped at twice a human's push
+	real ddpy = 60.f * (ai->target_py[i] - paddles->py[i]) - 13.75f * paddles->dpy[i];
+	paddles->ddpy[i] = ddpy > 2.f * player_fixed_ddpy ? 2.f * player_fixed_ddpy : ddpy < -2.f * player_fixed_ddpy ? -2.f * player_fixed_ddpy : ddpy;
+
+	// Holds its home column, lunging at the ball just before it arrives for a harder return
+	real facing = (state->paddle_traits.side[i] == SIDE_RIGHT) ? 1.f : -1.f;
+	real home_px = facing * player_px;
+	if (ai->intercept_timer[i] > 0 && ai->intercept_timer[i] < .15f) paddles->ddpx[i] = -facing * player_fixed_ddpx;
+	else paddles->ddpx[i] = 8.f * player_fixed_ddpx * ((home_px - paddles->px[i]) / arena_half_size_x);   // Distance over the arena first, the product overflows 16.16 fixed point
+}
+
+// ----------------- Player Input Helper ------------------------
+// Fills in the acceleration each paddle asks for this tick, from its keys or from the AI
+internal void
+process_player_input(Game_State* state, Input* input, real dt) {
+	Paddle_Pool* paddles = &state->paddles;
+	const Paddle_Traits* traits = &state->paddle_traits;
+
+	for (int i = 0; i < paddles->count; i++) {
+		paddles->ddpx[i] = 0.f, paddles->ddpy[i] = 0.f;
+		if (!traits->is_ai[i]) {
+			if (is_down(traits->key_up[i])) paddles->ddpy[i] += player_fixed_ddpy;
+			if (is_down(traits->key_down[i])) paddles->ddpy[i] -= player_fixed_ddpy;
+			if (is_down(traits->key_right[i])) paddles->ddpx[i] += player_fixed_ddpx;
+			if (is_down(traits->key_left[i])) paddles->ddpx[i] -= player_fixed_ddpx;
+		}
+		else {
+			simulate_ai(state, i, dt);
+		}
+	}
+}
+
+// ----------------- Scoring Helper -----------------------------
+// Player 1 always keeps stats, player 2 only when it is not the AI
+internal bool
+side_keeps_stats(const Game_State* state, Court_Side side) {
+	return state->keeps_stats && (side == SIDE_RIGHT || !is_player2_ai);
+}
+
+internal void
+score_point(Game_State* state, Court_Side scorer) {
+	Court_Side loser = (scorer == SIDE_RIGHT) ? SIDE_LEFT : SIDE_RIGHT;
+	int scorer_stats = scorer * (NUM_OF_MATCHES2 - NUM_OF_MATCHES1);   // Offset of the side's block of stats
+	int loser_stats = loser * (NUM_OF_MATCHES2 - NUM_OF_MATCHES1);
+
+	state->score[scorer]++;
+	if (side_keeps_stats(state, scorer)) save_data.stats[POINTS_SCORED1 + scorer_stats]++;
+	if (side_keeps_stats(state, loser)) save_data.stats[POINTS_LOST1 + loser_stats]++;
+
+	if (state->score[scorer] == win_score) {
+		if (side_keeps_stats(state, scorer)) save_data.stats[MATCHES_WON1 + scorer_stats]++;
+		if (side_keeps_stats(state, loser)) save_data.stats[MATCHES_LOST1 + loser_stats]++;
+
+		// There is no name entry, the sides keep their profiles under the names the stats screen uses
+		Profile_Store* store = get_profile_store();
+		for (int side = SIDE_RIGHT; store && side <= SIDE_LEFT; side++) {
+			if (!side_keeps_stats(state, (Court_Side)side)) continue;
+			int other = side == SIDE_RIGHT ? SIDE_LEFT : SIDE_RIGHT;
+			record_profile_match(store, side == SIDE_RIGHT ? "PLAYER I" : "PLAYER II", side == scorer, state->score[side], state->score[other]);
+		}
+		state->which_player_won = (scorer == SIDE_RIGHT) ? PLAYER_ONE : PLAYER_TWO;
+	}
+	play_sound(state->which_player_won ? SOUND_MATCH_WON : SOUND_SCORE, scorer == SIDE_RIGHT ? .5f : -.5f);
+}
+
+// ----------------- Ball Rule Helpers --------------------------
+// Bounces a ball off paddle p, which it is known to overlap
+internal void
+bounce_ball_off_paddle(real* ball_px, real ball_py, real* ball_dpx, real* ball_dpy, real ball_hsx,
+	Paddle_Pool* paddles, const Paddle_Traits* traits, int p) {
+
+	// Set hit ball state for this player, reset the others to allow AI movement
+	for (int other = 0; other < paddles->count; other++) {
+		paddles->hit_ball[other] = (other == p);
+	}
+
+	// Front faces the centre of the arena: -x for the right side, +x for the left side
+	real facing = (traits->side[p] == SIDE_RIGHT) ? 1.f : -1.f;
+	real player_hsx = traits->half_size_x[p];
+	if (facing * (paddles->px[p] - *ball_px) > 0) {   // If the ball collides on the front side of the player
+		*ball_dpx *= front_hit_coeff_x;
+		*ball_dpx += paddles->dpx[p] * player_transfer_coeff_x;
+		*ball_px = paddles->px[p] - facing * player_hsx - facing * ball_hsx;
+	}
+	else {                                            // If the ball collides on the back side of the player
+		*ball_dpx *= back_hit_coeff_x;
+		*ball_px = paddles->px[p] + facing * player_hsx + facing * ball_hsx;
+	}
+	*ball_dpy = paddles->dpy[p] * player_transfer_coeff_y;  // Bouncing back effect
+	*ball_dpy += ball_pos_transfer_coeff_y * (ball_py - paddles->py[p]);
+}
+
+// Clamps the ball velocity and bounces it off the arena top and bottom, true when it bounced
+internal bool
+apply_ball_limits(real* ball_py, real* ball_dpx, real* ball_dpy, real ball_hsy) {
+	// Clamping ball's x velocity to prevent large built-up speeds
+	if (*ball_dpx > ball_max_speed_x) *ball_dpx = ball_max_speed_x;
+	else if (*ball_dpx < -ball_max_speed_x) *ball_dpx = -ball_max_speed_x;
+	else if (*ball_dpx > 0 && *ball_dpx < ball_min_speed_x) *ball_dpx = ball_min_speed_x;
+	else if (*ball_dpx < 0 && *ball_dpx > -ball_min_speed_x) *ball_dpx = -ball_min_speed_x;
+
+	// Clamping ball's y velocity to prevent large built-up speeds
+	if (*ball_dpy > ball_max_speed_y) *ball_dpy = ball_max_speed_y;
+	else if (*ball_dpy < -ball_max_speed_y) *ball_dpy = -ball_max_speed_y;
+
+	// Ball Collision with Arena Top and Bottom => Affects ball_dpy
+	if (*ball_py + ball_hsy > arena_half_size_y) {
+		*ball_py = arena_half_size_y - ball_hsy;
+		*ball_dpy *= -1;                 // Bouncing back effect
+	}
+	else if (*ball_py - ball_hsy < -arena_half_size_y) {
+		*ball_py = -arena_half_size_y + ball_hsy;
+		*ball_dpy *= -1;                 // Bouncing back effect
+	}
+	else return false;
+	return true;
+}
+
+// ----------------- Simulate Ball Helper -----------------------
+internal void
+simulate_ball(Game_State* state, real dt) {
+	Ball_Pool* balls = &state->balls;
+	Paddle_Pool* paddles = &state->paddles;
+	const Paddle_Traits* traits = &state->paddle_traits;
+
+	// Equations of Motion:-
+	for (int b = 0; b < balls->count; b++) {
+		balls->px[b] += balls->dpx[b] * dt;
+		balls->py[b] += balls->dpy[b] * dt;
+	}
+
+	for (int b = 0; b < balls->count; b++) {
+		real hsx = state->ball_traits.half_size_x[b];
+		real hsy = state->ball_traits.half_size_y[b];
+
+		// Ball Collision with Players :- first paddle hit wins
+		// aabb_vs_aabb() checks if there is a collision on any side
+		for (int p = 0; p < paddles->count; p++) {
+			if (aabb_vs_aabb(balls->px[b], balls->py[b], hsx, hsy, paddles->px[p], paddles->py[p], traits->half_size_x[p], traits->half_size_y[p])) {
+				bounce_ball_off_paddle(&balls->px[b], balls->py[b], &balls->dpx[b], &balls->dpy[b], hsx, paddles, traits, p);
+				state->ball_events++;
+				play_sound(SOUND_PADDLE_HIT, (float)(balls->px[b] / arena_half_size_x));
+				break;
+			}
+		}
+
+		if (apply_ball_limits(&balls->py[b], &balls->dpx[b], &balls->dpy[b], hsy)) {
+			play_sound(SOUND_WALL_BOUNCE, (float)(balls->px[b] / arena_half_size_x));
+		}
+
+		// Reset: Ball Collision with Arena Left and Right
+
+		// Player 1 lost point, Player 2 scored point
+		if (balls->px[b] + hsx > 99.f) {            // Ball collision with right side of screen instead of arena
+			balls->px[b] = 0;
+			balls->py[b] = 0;
+			balls->dpx[b] = -100.f;
+			balls->dpy[b] = random_u32(&state->random_state) % 2 ? 30.f : -30.f; // Randomly decided spawn velocity direction of ball after reset
+			state->ball_events++;
+			score_point(state, SIDE_LEFT);
+		}
+		// Player 1 scored point, Player 2 lost point
+		else if (balls->px[b] + hsx < -99.f) {      // Ball collision with left side of screen instead of arena
+			balls->px[b] = 0;
+			balls->py[b] = 0;
+			balls->dpx[b] = 100.f;
+			balls->dpy[b] = random_u32(&state->random_state) % 2 ? -30.f : 30.f; // Randomly decided spawn velocity direction of ball after reset
+			state->ball_events++;
+			score_point(state, SIDE_RIGHT);
+		}
+	}
+}
+
+// -------------------- Stress Mode ------------------------------
+#include "stress_mode.cpp"
+
+// ----------------- Gameplay Helpers ---------------------------
+// One tick of match simulation, no rendering
+internal void
+simulate_gameplay(Game_State* state, Input* input, real dt) {
+	simulate_ball(state, dt);
+	process_player_input(state, input, dt);
+	simulate_player(&state->paddles, &state->paddle_traits, dt);
+}
+
 internal void
-simulate_ai(const float* player_px, const float* player_py, float* player_ddpx, float* player_ddpy, const bool* player_hit_ball) {
-	float epsilon_y = 10.f;
-	if (ball_py - *player_py > epsilon_y)
-		*player_ddpy += 750.f * ((ball_py - *player_py) / arena_half_size_y);        // Acc. based on dist from ball
-	else if (ball_py - *player_py < -epsilon_y)
-		*player_ddpy -= 750.f * ((*player_py - ball_py) / arena_half_size_y);
-
-	// TODO: Clean up AI code and create perfect mirrored AI for both sides
-	if (player_px < 0 && (ball_px > (1.f - arena_coverage) * arena_half_size_x) ||  // If ball is in the other player's court
-		// (ball_py - *player_py > epsilon_y) ||    // ie. Ball Y is greater than player_y: Out of vertical range
-		// (ball_py - *player_py < -epsilon_y) ||   // // ie. Ball Y is lower than player_y: Out of vertical range
-		*player_hit_ball)
-		*player_ddpx += 350.f;
-	else if	(player_px > 0 && (ball_px < -(1.f - arena_coverage) * arena_half_size_x) || // If ball is in the other player's court
-		*player_hit_ball)
-		*player_ddpx += 350.f;
-	// If the ball is in the player's vertical range
-	else if (player_px < 0 &&
-		(ball_py > 0 && ball_py - *player_py < epsilon_y) ||
-		(ball_py <= 0 && ball_py - *player_py > -epsilon_y))
-		*player_ddpx -= 350.f;
-	else if (player_px > 0 &&
-		(ball_py > 0 && ball_py - *player_py < epsilon_y) ||
-		(ball_py <= 0 && ball_py - *player_py > -epsilon_y))
-		*player_ddpx -= 350.f;
+render_gameplay(const Game_State* state) {
+	// Draw the central arena
+	draw_arena((float)arena_half_size_x, (float)arena_half_size_y, 0x000000, 0x006400);
+	draw_bounds((float)arena_half_size_x, (float)arena_half_size_y, 1, 3, (float)player_hsx, (float)arena_coverage, 0xc0c0c0);
+
+	const Ball_Pool* balls = &state->balls;
+	for (int b = 0; b < balls->count; b++) {
+		draw_rect((float)balls->px[b], (float)balls->py[b], (float)state->ball_traits.half_size_x[b], (float)state->ball_traits.half_size_y[b], state->ball_traits.color[b]);
+	}
+
+	const Paddle_Pool* paddles = &state->paddles;
+	for (int p = 0; p < paddles->count; p++) {
+		draw_rect((float)paddles->px[p], (float)paddles->py[p], (float)state->paddle_traits.half_size_x[p], (float)state->paddle_traits.half_size_y[p], state->paddle_traits.color[p]);
+	}
+
+	// Display Scores
+	draw_number(state->score[SIDE_RIGHT], 10, 40, 1.f, 0xbbffbb);
+	draw_number(state->score[SIDE_LEFT], -10, 40, 1.f, 0xbbffbb);
 }
 
+// -------------------- Rollback Netplay -------------------------
+#include "netplay.cpp"
+
+// ------------------------- Rewind ------------------------------
+#include "rewind.cpp"
+
+// ------------------- Suspend and Resume ------------------------
+#include "suspend.cpp"
+
 // ----------------- Code Refactor Helpers ----------------------
 internal void
 reset_game() {
-	player1_score = 0, player2_score = 0;
-	player1_px = player_px, player2_px = -player_px;
-	player1_py = 0, player2_py = 0;
-	player1_dpx = 0, player1_dpy = 0;
-	player2_dpx = 0, player2_dpy = 0;
-	ball_py = 0.f, ball_dpy = 1.f;
-	ball_px = 0.f, ball_dpx = 100.f;
+	init_match(&game_state);
+	stress_state.count = 0;
+	stop_netplay(&netplay_session);
+	clear_rewind_history();
 	current_menumode = MN_MAIN;
 	current_gamemode = GM_MENU;
 }
 
-// ---------------- Main Game Simulation ------------------------
+// ----------------- Idle Screen Helpers ------------------------
+#include <string.h>
+
+// Pause, quit, menu and end screens do not animate: each is drawn purely from the state below,
+// so when it is unchanged since the last frame the framebuffer is unchanged too
+struct Idle_Screen_Key {
+	Gamemode gamemode;
+	Menumode menumode;
+	int hot_gameplay_button;
+	int hot_menu_button;
+	int view_stats_menu;
+	Profile_Ranking leaderboard_ranking;
+	u32 leaderboard_first;
+	int hot_quit_button;
+	PlayerNum which_player_won;
+	u32 rewind_tick;
+	Save_Data save_data;
+};
+
+Idle_Screen_Key last_screen_key = {};
+bool last_frame_was_animated = false;
+
+internal Idle_Screen_Key
+get_idle_screen_key() {
+	Idle_Screen_Key key = {};
+	key.gamemode = current_gamemode;
+	key.menumode = current_menumode;
+	key.hot_gameplay_button = hot_gameplay_button;
+	key.hot_menu_button = hot_menu_button;
+	key.view_stats_menu = view_stats_menu;
+	key.leaderboard_ranking = leaderboard_ranking;
+	key.leaderboard_first = leaderboard_first;
+	key.hot_quit_button = hot_quit_button;
+	key.which_player_won = game_state.which_player_won;
+	key.rewind_tick = rewind_history.cursor_tick;
+	key.save_data = save_data;
+	return key;
+}
+
+// Only gameplay, the stress mode, netplay, running fades, rewinding and the animated menu background
+// animate, every other mode just waits for input
+internal bool
+is_idle_gamemode() {
+	if (fade_time > 0 || rewind_scrubbing) return false;
+	if (current_gamemode == GM_MENU && animated_menu_background) return false;
+	return current_gamemode != GM_GAMEPLAY && current_gamemode != GM_STRESS && current_gamemode != GM_NETPLAY;
+}
+
+// Pause, quit and end dialogs sit over the frozen match: the arena is redrawn and dimmed, so
+// redrawing an idle dialog never darkens it further, then a translucent box goes on top
 internal void
+draw_dialog_backdrop(float half_size_x, float half_size_y) {
+	render_gameplay(&game_state);
+	blend_screen<BLEND_ALPHA>(0x000000, (u32)(150.f * fade_progress()));
+	draw_rect_blended<BLEND_ALPHA>(0, 0, half_size_x, half_size_y, 0x006400, 200);
+}
+
+// ---------------- Main Game Simulation ------------------------
+// Returns true if the framebuffer changed this frame and has to be presented
+internal bool
 simulate_game(Input* input, float dt) {
+	bool frame_started_animated = !is_idle_gamemode();
+
+	// Reloaded tuning waits while netplay runs, both peers have to simulate with the same values
+	if (current_gamemode != GM_NETPLAY) apply_published_tuning();
+
 	// ------------------ Gameplay System ---------------------------------
 	if (current_gamemode == GM_GAMEPLAY) {
 
 		// Pause Screen
-		if (pressed(BUTTON_P)) current_gamemode = GM_PAUSED;
+		if (pressed(BUTTON_P)) {
+			current_gamemode = GM_PAUSED;
+			start_fade(.15f);
+		}
 
 		// Escape to Main Menu
-		if (pressed(BUTTON_ESC)) current_gamemode = GM_QUIT;
+		if (pressed(BUTTON_ESC)) {
+			current_gamemode = GM_QUIT;
+			start_fade(.15f);
+		}
 
 		// Gameplay if game is not paused
 		if (!game_paused) {
-
-			// ------------- (5) Env Simulation ---------------------------
-
-			// Draw the central arena
-			draw_arena(arena_half_size_x, arena_half_size_y, 0x000000, 0x006400);
-			draw_bounds(arena_half_size_x, arena_half_size_y, 1, 3, player_hsx, arena_coverage, 0xc0c0c0);
-
-			// Simulate the ball
-			{
-				// Equations of Motion:-
-				ball_px += ball_dpx * dt;
-				ball_py += ball_dpy * dt;
-
-				// Ball Collision with Players :-
-
-				// aabb_vs_aabb() checks if there is a collision on any side
-				if (aabb_vs_aabb(ball_px, ball_py, ball_hsx, ball_hsy, player1_px, player1_py, player_hsx, player_hsy)) {
-
-					player1_hit_ball = true;        // Set hit ball state for player 1 to be true
-					player2_hit_ball = false;       // Reset hit ball state for player 2 to allow AI movement
-
-					if (player1_px > ball_px) {     // If the ball collides on the left (front) side of player 1
-						ball_dpx *= front_hit_coeff_x;
-						ball_dpx += player1_dpx * player_transfer_coeff_x;
-						ball_px = player1_px - player_hsx - ball_hsx;
-					}
-					else {                          // If the ball collides on the right (back) side of player 1
-						ball_dpx *= back_hit_coeff_x;
-						ball_px = player1_px + player_hsx + ball_hsx;
-					}
-					ball_dpy = player1_dpy * player_transfer_coeff_y;  // Bouncing back effect
-					ball_dpy += ball_pos_transfer_coeff_y * (ball_py - player1_py);
-				}
-				else if (aabb_vs_aabb(ball_px, ball_py, ball_hsx, ball_hsy, player2_px, player2_py, player_hsx, player_hsy)) {
-
-					player2_hit_ball = true;        // Set hit ball state for player 2 to be true
-					player1_hit_ball = false;
-
-					if (player2_px < ball_px) {     // If the ball collides on the right (front) side of player 2
-						ball_dpx *= front_hit_coeff_x;
-						ball_dpx += player2_dpx * player_transfer_coeff_x;
-						ball_px = player2_px + player_hsx + ball_hsx;
-					}
-					else {                          // If the ball collides on the left (back) side of player 2
-						ball_dpx *= back_hit_coeff_x;
-						ball_px = player2_px - player_hsx - ball_hsx;
-					}
-					ball_dpy = player2_dpy * player_transfer_coeff_y;  // Bouncing back effect
-					ball_dpy += ball_pos_transfer_coeff_y * (ball_py - player2_py);
-				}
-
-				// Clamping ball's x velocity to prevent large built-up speeds
-				if (ball_dpx > ball_max_speed_x) ball_dpx = ball_max_speed_x;
-				else if (ball_dpx < -ball_max_speed_x) ball_dpx = -ball_max_speed_x;
-				else if (ball_dpx > 0 && ball_dpx < ball_min_speed_x) ball_dpx = ball_min_speed_x;
-				else if (ball_dpx < 0 && ball_dpx > -ball_min_speed_x) ball_dpx = -ball_min_speed_x;
-
-				// Clamping ball's y velocity to prevent large built-up speeds
-				if (ball_dpy > ball_max_speed_y) ball_dpy = ball_max_speed_y;
-				else if (ball_dpy < -ball_max_speed_y) ball_dpy = -ball_max_speed_y;
-
-				// Ball Collision with Arena Top and Bottom => Affects ball_dpy
-				if (ball_py + ball_hsy > arena_half_size_y) {
-					ball_py = arena_half_size_y - ball_hsy;
-					ball_dpy *= -1;                 // Bouncing back effect
-				}
-				else if (ball_py - ball_hsy < -arena_half_size_y) {
-					ball_py = -arena_half_size_y + ball_hsy;
-					ball_dpy *= -1;                 // Bouncing back effect
-				}
-
-				// Random Integer Helpers
-				LARGE_INTEGER curr_time;              // ISO time stored using large_integer
-				QueryPerformanceCounter(&curr_time);  // Store high resolution (<1us) time stamp in curr_time
-				int currTime = curr_time.QuadPart;    // Convert time stamp to integer
-
-				// Reset: Ball Collision with Arena Left and Right
-
-				// Player 1 lost point, Player 2 scored point
-				if (ball_px + ball_hsx > 99.f) {            // Ball collision with right side of screen instead of arena
-					ball_px = 0;
-					ball_py = 0;
-					ball_dpx = -100.f;
-					ball_dpy = currTime % 2 ? 30.f : -30.f; // Randomly decided spawn velocity direction of ball after reset
-					player2_score++;
-					save_data.stats[POINTS_LOST1]++;
-					if (!is_player2_ai) save_data.stats[POINTS_SCORED2]++;
-					// Player 1 lost, Player 2 won
-					if (player2_score == win_score) {
-						save_data.stats[MATCHES_LOST1]++;
-						if (!is_player2_ai) save_data.stats[MATCHES_WON2]++;
-						which_player_won = PLAYER_TWO;
-						current_gamemode = GM_ENDSTATE;
-					}
-				}
-				// Player 1 scored point, Player 2 lost point
-				else if (ball_px + ball_hsx < -99.f) {      // Ball collision with left side of screen instead of arena
-					ball_px = 0;
-					ball_py = 0;
-					ball_dpx = 100.f;
-					ball_dpy = currTime % 2 ? -30.f : 30.f; // Randomly decided spawn velocity direction of ball after reset
-					player1_score++;
-					save_data.stats[POINTS_SCORED1]++;
-					if (!is_player2_ai) save_data.stats[POINTS_LOST2]++;
-					// Player 1 won, Player 2 lost
-					if (player1_score == win_score) {
-						save_data.stats[MATCHES_WON1]++;
-						if (!is_player2_ai) save_data.stats[MATCHES_LOST2]++;
-						which_player_won = PLAYER_ONE;
-						current_gamemode = GM_ENDSTATE;
-					}
-				}
-			}
-
-			// ------------- (6) Player 1 Simulation ----------------------
-			float player1_ddpy = 0.f, player1_ddpx = 0.f;
-			if (!is_player1_ai) {
-				if (is_down(BUTTON_UP)) player1_ddpy += player_fixed_ddpy;
-				if (is_down(BUTTON_DOWN)) player1_ddpy -= player_fixed_ddpy;
-				if (is_down(BUTTON_RIGHT)) player1_ddpx += player_fixed_ddpx;
-				if (is_down(BUTTON_LEFT)) player1_ddpx -= player_fixed_ddpx;
+			simulate_gameplay(&game_state, input, dt);
+			record_rewind_tick(&game_state, dt);
+			render_gameplay(&game_state);
+			draw_fade_from_black();
+
+			if (game_state.which_player_won != PLAYER_NULL) {
+				current_gamemode = GM_ENDSTATE;
+				start_fade(.4f);
+				clear_suspended_match();
 			}
-			else {
-				simulate_ai(&player1_px, &player1_py, &player1_ddpx, &player1_ddpy, &player1_hit_ball);
-			}
-
-			simulate_player(&player1_py, &player1_dpy, player1_ddpy, &player1_px, &player1_dpx, player1_ddpx, dt);
-
-			// ------------- (7) Player 2 Simulation ----------------------
-			float player2_ddpy = 0.f, player2_ddpx = 0.f;
-			if (!is_player2_ai) {
-				if (is_down(BUTTON_W)) player2_ddpy += player_fixed_ddpy;
-				if (is_down(BUTTON_S)) player2_ddpy -= player_fixed_ddpy;
-				if (is_down(BUTTON_D)) player2_ddpx += player_fixed_ddpx;
-				if (is_down(BUTTON_A)) player2_ddpx -= player_fixed_ddpx;
-			}
-			else {
-				simulate_ai(&player2_px, &player2_py, &player2_ddpx, &player2_ddpy, &player2_hit_ball);
-			}
-
-			simulate_player(&player2_py, &player2_dpy, player2_ddpy, &player2_px, &player2_dpx, player2_ddpx, dt);
-
-			// ------------- (8) Rendering --------------------------------
-			draw_rect(ball_px, ball_py, ball_hsx, ball_hsy, 0xffff66);
-			draw_rect(player1_px, player1_py, player1_half_size_x, player1_half_size_y, 0x8B0000);
-			draw_rect(player2_px, player2_py, player2_half_size_x, player2_half_size_y, 0x8B0000);
-			// Display Scores
-			draw_number(player1_score, 10, 40, 1.f, 0xbbffbb);
-			draw_number(player2_score, -10, 40, 1.f, 0xbbffbb);
 		}
 	}
 
@@ -380,14 +718,17 @@ simulate_game(Input* input, float dt) {
 		if pressed(BUTTON_P) {
 			game_paused = false;
 			current_gamemode = GM_GAMEPLAY;
+			resume_from_rewind();
 		}
-		draw_rect(0, 0, 30, 15, 0x006400);
+		else update_rewind_controls(input);
+		draw_dialog_backdrop(30, 15);
 		draw_text("PAUSED", -16, 2, 1, 0xffffff);
+		draw_rewind_timeline();
 	}
 
 	else if (current_gamemode == GM_QUIT) {
 		game_paused = true;
-		draw_rect(0, 0, 80, 35, 0x006400);
+		draw_dialog_backdrop(80, 35);
 		draw_text("I WANT TO QUIT THE GAME", -68, 15, 1, 0xffffff);
 
 		// Navigation between the two options
@@ -399,7 +740,10 @@ simulate_game(Input* input, float dt) {
 		// Select whether to quit or not
 		if (pressed(BUTTON_ENTER)) {
 			game_paused = false;
-			if (hot_quit_button == 0) reset_game();
+			if (hot_quit_button == 0) {
+				suspend_match();                // Kept for the next launch rather than thrown away
+				reset_game();
+			}
 			else current_gamemode = GM_GAMEPLAY;
 		}
 
@@ -422,19 +766,63 @@ simulate_game(Input* input, float dt) {
 	// ------------------ Menu System -------------------------------------
 	else if (current_gamemode == GM_MENU) {
 		load_game();
+		menu_background_time += dt;
 		manage_menu(input);
 	}
 
+	// ------------------ Multi-Ball Stress Mode --------------------------
+	else if (current_gamemode == GM_STRESS) {
+		// Escape to Main Menu, P doubles the balls (wrapping back round), Enter toggles ball vs ball
+		if (pressed(BUTTON_ESC)) reset_game();
+		else {
+			if (!stress_state.count) init_stress_mode(&stress_state, MIN_STRESS_BALLS);
+			if (pressed(BUTTON_P)) init_stress_mode(&stress_state, stress_state.count < MAX_STRESS_BALLS ? 2 * stress_state.count : MIN_STRESS_BALLS);
+			if (pressed(BUTTON_ENTER)) stress_state.balls_collide = !stress_state.balls_collide;
+
+			process_player_input(&game_state, input, dt);
+			simulate_player(&game_state.paddles, &game_state.paddle_traits, dt);
+			simulate_stress_mode(&stress_state, &game_state.paddles, &game_state.paddle_traits, dt);
+			render_stress_mode(&stress_state, &game_state);
+			draw_fade_from_black();
+		}
+	}
+
+	// ------------------ Rollback Netplay --------------------------------
+	else if (current_gamemode == GM_NETPLAY) {
+		if (pressed(BUTTON_ESC)) reset_game();
+		else {
+			// Fixed ticks out of the variable frame time, at most a quarter second behind
+			Netplay_Session* session = &netplay_session;
+			session->time_accumulator += dt;
+			if (session->time_accumulator > .25f) session->time_accumulator = .25f;
+			u8 local_bits = sample_local_net_input(input);
+			while (session->time_accumulator >= netplay_dt) {
+				netplay_tick(session, &game_state, local_bits, true);
+				session->time_accumulator -= netplay_dt;
+			}
+
+			render_gameplay(&game_state);
+
+			// Only end on a winner both peers agree on
+			if (game_state.which_player_won != PLAYER_NULL && netplay_is_confirmed(session)) {
+				current_gamemode = GM_ENDSTATE;
+				start_fade(.4f);
+			}
+		}
+	}
+
 	// ------------------ Endgame Management ------------------------------
 	else if (current_gamemode == GM_ENDSTATE) {
+		// Keep resending our last inputs so the remote peer can confirm the end too
+		if (netplay_session.active) netplay_tick(&netplay_session, &game_state, 0, false);
 		save_game();
-		draw_rect(0, 0, 60, 30, 0x006400);
+		draw_dialog_backdrop(60, 30);
 
-		if (which_player_won == PLAYER_ONE) {
+		if (game_state.which_player_won == PLAYER_ONE) {
 			if (is_player2_ai) draw_text("YOU WON", -19, 12, 1, 0xffffff);
 			else draw_text("PLAYER I WON", -35, 12, 1, 0xffffff);
 		}
-		else if (which_player_won == PLAYER_TWO) {
+		else if (game_state.which_player_won == PLAYER_TWO) {
 			if (is_player2_ai) draw_text("YOU LOST", -21, 12, 1, 0xffffff);
 			else draw_text("PLAYER II WON", -36, 12, 1, 0xffffff);
 		}
@@ -445,4 +833,16 @@ simulate_game(Input* input, float dt) {
 			reset_game();
 		}
 	}
+
+	fade_time = fade_time > dt ? fade_time - dt : 0.f;
+	update_suspend_autosave(dt);
+
+	// Animated frames (and the first idle frame drawn over them) always change the screen,
+	// idle frames only when the state they are drawn from changed
+	Idle_Screen_Key screen_key = get_idle_screen_key();
+	bool frame_changed = frame_started_animated || last_frame_was_animated ||
+		memcmp(&screen_key, &last_screen_key, sizeof(screen_key)) != 0;
+	last_screen_key = screen_key;
+	last_frame_was_animated = frame_started_animated;
+	return frame_changed;
 }
@@ -0,0 +1,138 @@
+// Game module: the game and renderer as a shared library, the third kind of unity build root next to the
+// platform layers. A host (linux_host.cpp) loads it, calls update_and_render() every frame and swaps in a
+// rebuilt copy while the game runs, see the interface at the end of platform_common.cpp.
+// Build: g++ -O2 -shared -fPIC -o libpong_game.so game_module.cpp
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.cpp"
+
+struct Render_State {
+	int width, height;
+	void* memory;
+};
+
+global_variable bool running = true;
+global_variable Render_State render_state;
+
+#include "renderer.cpp"
+#include "platform_common.cpp"
+
+// ---------------- Platform Services ---------------------------
+// The os_ functions the game calls are forwarded to the host
+global_variable Platform_Api platform;
+
+internal String os_read_save_file(Memory_Arena* arena) { return platform.read_save_file(arena); }
+internal int os_write_save_file(String data) { return platform.write_save_file(data); }
+internal String os_read_suspend_file(Memory_Arena* arena) { return platform.read_suspend_file(arena); }
+internal int os_write_suspend_file(String data) { return platform.write_suspend_file(data); }
+internal int os_read_profile_file(void* buffer, u64 offset, u32 size) { return platform.read_profile_file(buffer, offset, size); }
+internal int os_write_profile_file(const void* data, u64 offset, u32 size) { return platform.write_profile_file(data, offset, size); }
+internal u64 os_get_time_counter() { return platform.get_time_counter(); }
+internal u64 os_get_time_frequency() { return platform.get_time_frequency(); }
+internal bool os_udp_open(u16 local_port, const char* remote_host, u16 remote_port) { return platform.udp_open(local_port, remote_host, remote_port); }
+internal void os_udp_close() { platform.udp_close(); }
+internal void os_udp_send(const void* data, int size) { platform.udp_send(data, size); }
+internal int os_udp_receive(void* buffer, int max_size) { return platform.udp_receive(buffer, max_size); }
+
+#include "game.cpp"
+
+// ---------------- Module State --------------------------------
+// The game keeps its state in globals, which a reload would reset. Around a reload they are copied
+// out to memory the host owns and back into the new module. Each piece is matched by name and size,
+// so a rebuild that changes a struct resets just that piece instead of reading it wrongly.
+// The tuning constants are left out: a rebuilt module starts from its own compiled values.
+struct State_Piece {
+	const char* name;
+	void* data;
+	size_t size;
+};
+
+#define STATE_PIECE(variable) { #variable, &variable, sizeof(variable) }
+
+global_variable State_Piece state_pieces[] = {
+	STATE_PIECE(current_gamemode),
+	STATE_PIECE(current_menumode),
+	STATE_PIECE(game_state),
+	STATE_PIECE(is_player1_ai),
+	STATE_PIECE(is_player2_ai),
+	STATE_PIECE(hot_gameplay_button),
+	STATE_PIECE(hot_menu_button),
+	STATE_PIECE(view_stats_menu),
+	STATE_PIECE(hot_quit_button),
+	STATE_PIECE(game_paused),
+	STATE_PIECE(fade_time),
+	STATE_PIECE(fade_duration),
+	STATE_PIECE(save_data),
+	STATE_PIECE(profile_store),
+	STATE_PIECE(leaderboard_ranking),
+	STATE_PIECE(leaderboard_first),
+	STATE_PIECE(stress_state),
+	STATE_PIECE(netplay_session),
+	STATE_PIECE(rewind_history),
+};
+
+// Saved as a name hash and size before each piece's bytes
+struct State_Piece_Header {
+	u32 name_hash;
+	u32 size;
+};
+
+// Fixed and float builds store `real` in the same size, the number format is part of every name so
+// switching between them resets the state instead of reading one as the other
+internal u32
+hash_piece_name(const char* name) {
+	u32 hash = 2166136261u ^ PONG_FIXED_POINT;
+	for (; *name; name++) hash = (hash ^ (u8)*name) * 16777619u;
+	return hash;
+}
+
+extern "C" ATTACH_GAME(attach_game) {
+	platform = *api;
+	int reset_count = 0;
+	if (!state_size) return 0;
+
+	for (int p = 0; p < (int)(sizeof(state_pieces) / sizeof(state_pieces[0])); p++) {
+		State_Piece* piece = &state_pieces[p];
+		u32 name_hash = hash_piece_name(piece->name);
+		bool restored = false;
+		for (size_t at = 0; at + sizeof(State_Piece_Header) <= state_size;) {
+			State_Piece_Header header;
+			memcpy(&header, (const u8*)state + at, sizeof(header));
+			at += sizeof(header);
+			if (header.name_hash == name_hash && header.size == piece->size && at + header.size <= state_size) {
+				memcpy(piece->data, (const u8*)state + at, piece->size);
+				restored = true;
+				break;
+			}
+			at += header.size;
+		}
+		if (!restored) reset_count++;
+	}
+	return reset_count;
+}
+
+extern "C" DETACH_GAME(detach_game) {
+	size_t size = 0;
+	for (int p = 0; p < (int)(sizeof(state_pieces) / sizeof(state_pieces[0])); p++) {
+		State_Piece* piece = &state_pieces[p];
+		if (size + sizeof(State_Piece_Header) + piece->size > capacity) return 0;
+		State_Piece_Header header = { hash_piece_name(piece->name), (u32)piece->size };
+		memcpy((u8*)state + size, &header, sizeof(header));
+		memcpy((u8*)state + size + sizeof(header), piece->data, piece->size);
+		size += sizeof(header) + piece->size;
+	}
+	return size;
+}
+
+extern "C" UPDATE_AND_RENDER(update_and_render) {
+	game_memory = *memory;
+	render_state.width = framebuffer->width;
+	render_state.height = framebuffer->height;
+	render_state.memory = framebuffer->memory;
+
+	simulate_game(input, dt);
+
+	*memory = game_memory;              // The arenas' used and high-water marks
+	return running;
+}
@@ -0,0 +1,69 @@
+// <------------------------- Input Latency Stats ------------------------------------->
+// Time from a key transition arriving at the platform layer to the present of the first frame
+// that simulated it. Windows only has the time a key was posted to the nearest system tick, so
+// there the export says how coarse the timestamps are. Kept as a histogram of fixed width buckets,
+// so recording an event costs the same whatever the run length and the whole distribution can be
+// exported at exit.
+
+#define LATENCY_BUCKET_US 250
+#define LATENCY_BUCKETS 200                 // Up to 50ms, anything slower lands in the last bucket
+
+struct Latency_Stats {
+	u64 histogram[LATENCY_BUCKETS];
+	u64 count;
+	u64 unpresented;                        // Events whose frame changed nothing on screen (eg. key ups)
+	double total_us;
+	double max_us;
+	u32 timestamp_resolution_us;            // How coarse the key timestamps are, 0 when they are as fine as the counter
+};
+
+global_variable Latency_Stats input_latency;
+
+// Called by whichever thread presents, once the present of the frame that first simulated the events returned
+internal void
+record_input_latency(Latency_Stats* stats, const u64* event_times, int event_count, u64 present_time, u64 frequency) {
+	for (int e = 0; e < event_count; e++) {
+		double us = 1000000.0 * (double)(present_time - event_times[e]) / (double)frequency;
+		stats->histogram[clamp(0, (int)(us / LATENCY_BUCKET_US), LATENCY_BUCKETS - 1)]++;
+		stats->count++;
+		stats->total_us += us;
+		if (us > stats->max_us) stats->max_us = us;
+	}
+}
+
+// Called by the game thread for a simulated frame that is not presented
+internal void
+record_unpresented_input(Latency_Stats* stats, const Input* input) {
+	stats->unpresented += input->event_count;
+}
+
+// Upper edge of the bucket holding the given fraction of events, in microseconds
+internal int
+latency_percentile_us(const Latency_Stats* stats, float fraction) {
+	u64 target = (u64)(fraction * stats->count);
+	u64 seen = 0;
+	for (int b = 0; b < LATENCY_BUCKETS; b++) {
+		seen += stats->histogram[b];
+		if (seen > target) return (b + 1) * LATENCY_BUCKET_US;
+	}
+	return LATENCY_BUCKETS * LATENCY_BUCKET_US;
+}
+
+// CSV export: a summary comment line, then one row per non-empty bucket. Returns the length written.
+internal int
+format_latency_histogram(const Latency_Stats* stats, char* buffer, int size) {
+	int length = snprintf(buffer, size, "# events %llu, unpresented %llu, mean %.0fus, p50 %dus, p99 %dus, max %.0fus",
+		(unsigned long long)stats->count, (unsigned long long)stats->unpresented, stats->count ? stats->total_us / stats->count : 0.0,
+		latency_percentile_us(stats, .5f), latency_percentile_us(stats, .99f), stats->max_us);
+	if (stats->timestamp_resolution_us && length < size) {
+		length += snprintf(buffer + length, size - length, ", key arrival times only to within %uus", stats->timestamp_resolution_us);
+	}
+	if (length < size) length += snprintf(buffer + length, size - length, "\nbucket_start_us,bucket_end_us,count\n");
+
+	for (int b = 0; b < LATENCY_BUCKETS && length < size; b++) {
+		if (!stats->histogram[b]) continue;
+		length += snprintf(buffer + length, size - length, "%d,%d,%llu\n",
+			b * LATENCY_BUCKET_US, (b + 1) * LATENCY_BUCKET_US, (unsigned long long)stats->histogram[b]);
+	}
+	return length < size ? length : size - 1;
+}
@@ -0,0 +1,898 @@
+// Benchmark suite: renderer primitives at several resolutions, the canonical screens and simulation
+// throughput. Results are written as JSON and checked against a stored baseline.
+// Build: g++ -O2 -o pong_bench linux_bench.cpp
+// Usage: ./pong_bench [-json results.json] [-baseline bench_baseline.json] [-threshold 0.25] [-quick] [-no-counters]
+//                    [-render-threads n]
+//        ./pong_bench -merge run1.json run2.json ... [-json bench_baseline.json] [-baseline other.json]
+//        ./pong_bench ... -baseline bench_baseline.json -update prefix[,prefix...] -json bench_baseline.json
+//        (-update writes the baseline back with only the metrics starting with a prefix from this run)
+//        ./pong_bench -train   (scripted play through the menus and matches, for profile-guided builds)
+// Each metric also gets cycles, instructions, cache and branch misses and bytes written per op when
+// the machine allows hardware counters (perf_event_open), otherwise only times. -no-counters skips them.
+// The counters only see the bench's own thread, not the render workers that draw background bands:
+// one per other processor, or -render-threads n of them.
+// Exit code: 0 when no metric regressed, 1 when one did, a 4K overlay misses the 16 ms budget, the
+//            4K procedural background misses its 2 ms or differs from the per-pixel formula, or a
+//            profile leaderboard is out of order,
+//            2 when a file cannot be read or written
+#include "linux_os.cpp"
+#include "game.cpp"
+
+#define BENCH_MAX_METRICS 128
+#define BENCH_MAX_SAMPLES 31
+#define BENCH_MAX_MERGED 15
+
+// Hardware counters, per op, when the machine lets the bench read them
+enum Bench_Counter {
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_CACHE_MISSES,               // Last level cache
+	COUNTER_BRANCH_MISSES,
+	COUNTER_BYTES_WRITTEN,              // Last level cache write misses times the 64 byte line
+
+	COUNTER_COUNT,
+};
+
+struct Bench_Metric {
+	char name[64];
+	double ns_per_op;                   // Median over the samples
+	double mad_ns;                      // Median absolute deviation, the noise estimate
+	int samples;
+	bool counted;
+	double counters[COUNTER_COUNT];     // Per op, -1 for a counter the machine does not have
+
+	// How to measure it again, not stored in the JSON
+	void (*op)();
+	int width, height;
+};
+
+struct Bench_Results {
+	Bench_Metric metrics[BENCH_MAX_METRICS];
+	int count;
+};
+
+global_variable int bench_samples = 21;
+global_variable double bench_min_batch_ns = 2000000.0;   // Each sample times enough ops to take at least this long
+
+internal int
+compare_doubles(const void* a, const void* b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+internal double
+median_of(double* values, int count) {
+	qsort(values, count, sizeof(double), compare_doubles);
+	return count % 2 ? values[count / 2] : .5 * (values[count / 2 - 1] + values[count / 2]);
+}
+
+internal double
+bench_ns_since(u64 start) {
+	return (double)(os_get_time_counter() - start);        // os_get_time_counter() counts nanoseconds here
+}
+
+// ---------------- Hardware Counters ----------------------------
+// Counted with perf_event_open over one more batch of each metric, after the timed samples, as one
+// group so every counter covers the same stretch (scaled up if the kernel had to multiplex them).
+// Where they are not allowed, as in most containers and VMs without a PMU, or with a high
+// perf_event_paranoid, the suite says so once and only times. Single counters a CPU lacks are left out.
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+struct Bench_Counters {
+	int group_fd;                       // -1 when there are no counters
+	int fds[COUNTER_COUNT];             // -1 for a counter that would not open
+	int read_index[COUNTER_COUNT];      // Where each counter is in a group read
+	int open_count;
+};
+
+global_variable Bench_Counters bench_counters = { -1 };
+global_variable const char* counter_names[COUNTER_COUNT] = { "cycles", "instructions", "cache_misses", "branch_misses", "bytes_written" };
+
+internal int
+open_counter(u32 type, u64 config, int group_fd) {
+	perf_event_attr attr = {};
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group_fd < 0;       // The group follows its leader
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+internal bool
+open_bench_counters(Bench_Counters* counters) {
+	const u32 types[COUNTER_COUNT] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+	const u64 configs[COUNTER_COUNT] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+		PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) };
+
+	counters->group_fd = -1;
+	counters->open_count = 0;
+	int first_error = 0;
+	for (int c = 0; c < COUNTER_COUNT; c++) {
+		counters->fds[c] = open_counter(types[c], configs[c], counters->group_fd);
+		if (counters->fds[c] < 0) {
+			if (!first_error) first_error = errno;
+			continue;
+		}
+		if (counters->group_fd < 0) counters->group_fd = counters->fds[c];
+		counters->read_index[c] = counters->open_count++;
+	}
+
+	if (counters->group_fd < 0) {
+		printf("hardware counters unavailable (%s), timing only\n", strerror(first_error));
+		return false;
+	}
+	for (int c = 0; c < COUNTER_COUNT; c++) {
+		if (counters->fds[c] < 0) printf("hardware counter %s unavailable, left out\n", counter_names[c]);
+	}
+	return true;
+}
+
+// Runs op batch times with the counters on, false if the kernel never got them onto the CPU
+internal bool
+count_metric(Bench_Counters* counters, Bench_Metric* metric, int batch) {
+	ioctl(counters->group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(counters->group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	for (int i = 0; i < batch; i++) metric->op();
+	ioctl(counters->group_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+	// Counter count, time enabled, time running, then the values in the order they were opened
+	u64 values[3 + COUNTER_COUNT];
+	if (read(counters->group_fd, values, sizeof(values)) < (ssize_t)(3 * sizeof(u64)) || !values[2]) return false;
+	double scale = (double)values[1] / (double)values[2] / batch;
+	for (int c = 0; c < COUNTER_COUNT; c++) {
+		metric->counters[c] = counters->fds[c] < 0 ? -1.0 : values[3 + counters->read_index[c]] * scale;
+	}
+	metric->counters[COUNTER_BYTES_WRITTEN] *= metric->counters[COUNTER_BYTES_WRITTEN] < 0 ? 1.0 : 64.0;
+	return true;
+}
+
+// Times op: one untimed warm-up batch sized so that it takes bench_min_batch_ns, then that batch
+// repeated for every sample. Median and MAD keep a few preempted samples from moving the result.
+internal void
+measure_metric(Bench_Metric* metric) {
+	void (*op)() = metric->op;
+	render_state.width = metric->width;
+	render_state.height = metric->height;
+
+	int batch = 1;
+	for (;;) {
+		u64 start = os_get_time_counter();
+		for (int i = 0; i < batch; i++) op();
+		if (bench_ns_since(start) >= bench_min_batch_ns || batch >= (1 << 24)) break;
+		batch *= 2;
+	}
+
+	double per_op[BENCH_MAX_SAMPLES];
+	for (int s = 0; s < bench_samples; s++) {
+		u64 start = os_get_time_counter();
+		for (int i = 0; i < batch; i++) op();
+		per_op[s] = bench_ns_since(start) / batch;
+	}
+
+	metric->samples = bench_samples;
+	metric->ns_per_op = median_of(per_op, bench_samples);
+	for (int s = 0; s < bench_samples; s++) {
+		per_op[s] = per_op[s] > metric->ns_per_op ? per_op[s] - metric->ns_per_op : metric->ns_per_op - per_op[s];
+	}
+	metric->mad_ns = median_of(per_op, bench_samples);
+	metric->counted = bench_counters.group_fd >= 0 && count_metric(&bench_counters, metric, batch);
+}
+
+internal void
+run_metric(Bench_Results* results, const char* name, void (*op)()) {
+	Bench_Metric* metric = &results->metrics[results->count++];
+	snprintf(metric->name, sizeof(metric->name), "%s", name);
+	metric->op = op;
+	metric->width = render_state.width;
+	metric->height = render_state.height;
+	measure_metric(metric);
+	printf("%-36s %14.1f ns %10.1f mad", metric->name, metric->ns_per_op, metric->mad_ns);
+	if (metric->counted) {
+		const double* counters = metric->counters;
+		printf(" %12.0f cyc", counters[COUNTER_CYCLES]);
+		if (counters[COUNTER_CYCLES] > 0 && counters[COUNTER_INSTRUCTIONS] >= 0) printf(" %5.2f ipc", counters[COUNTER_INSTRUCTIONS] / counters[COUNTER_CYCLES]);
+		if (counters[COUNTER_CACHE_MISSES] >= 0) printf(" %10.1f llc-miss", counters[COUNTER_CACHE_MISSES]);
+		if (counters[COUNTER_BRANCH_MISSES] >= 0) printf(" %9.1f br-miss", counters[COUNTER_BRANCH_MISSES]);
+		if (counters[COUNTER_BYTES_WRITTEN] >= 0) printf(" %12.0f B-wr", counters[COUNTER_BYTES_WRITTEN]);
+	}
+	printf("\n");
+}
+
+// ---------------- Renderer Primitives --------------------------
+internal void bench_clear_screen() { clear_screen(0x006400); }
+internal void bench_draw_rect_in_pixels() { draw_rect_in_pixels(render_state.width / 4, render_state.height / 4, 3 * render_state.width / 4, 3 * render_state.height / 4, 0xff0000); }
+internal void bench_draw_rect() { draw_rect(0, 0, (float)arena_half_size_x, (float)arena_half_size_y, 0x000000); }
+internal void bench_draw_text() { draw_text("PING PONG", -50, 40, 2, 0xffffff); }
+internal void bench_draw_number() { draw_number(1234567, 10, 40, 1.f, 0xbbffbb); }
+internal void bench_draw_bounds() { draw_bounds((float)arena_half_size_x, (float)arena_half_size_y, 1, 3, (float)player_hsx, (float)arena_coverage, 0xc0c0c0); }
+
+// Full screen translucent overlays, the worst case of a dim or fade
+internal void bench_overlay_alpha() { blend_screen<BLEND_ALPHA>(0x000000, 150); }
+internal void bench_overlay_add() { blend_screen<BLEND_ADD>(0x202020, 128); }
+internal void bench_overlay_multiply() { blend_screen<BLEND_MULTIPLY>(0x006400, 128); }
+internal void bench_draw_text_alpha() { draw_text_blended<BLEND_ALPHA>("PING PONG", -50, 40, 2, 0xffffff, 128); }
+
+// A 16x16 grid of small rects, through draw_rect() one at a time and then as one batch. Rects per
+// second is BENCH_RECTS over the time per op.
+#define BENCH_RECTS 256
+
+internal void
+bench_draw_rects() {
+	for (int i = 0; i < BENCH_RECTS; i++) {
+		draw_rect((i % 16)*5.f - 40.f, (i / 16)*4.f - 32.f, 1.5f, 1.f, 0xffffff);
+	}
+}
+
+internal void
+bench_draw_rects_batched() {
+	Rect_Batch batch;
+	batch.count = 0;
+	for (int i = 0; i < BENCH_RECTS; i++) {
+		push_rect(&batch, (i % 16)*5.f - 40.f, (i / 16)*4.f - 32.f, 1.5f, 1.f, 0xffffff);
+	}
+	draw_rect_batch(&batch);
+}
+
+// The animated menu background, incremental against the per-pixel formula
+internal void bench_background() { draw_procedural_background(12.5f); }
+internal void bench_background_naive() { draw_procedural_background_naive(12.5f); }
+
+// ---------------- Canonical Screens ----------------------------
+// Every screen is one simulate_game() frame from the same starting state, so a frame never changes
+// the next one (no menu moves, no points scored)
+global_variable Game_State bench_rally_state;
+global_variable Input bench_input;
+
+internal void
+bench_screen(Gamemode gamemode, Menumode menumode) {
+	current_gamemode = gamemode;
+	current_menumode = menumode;
+	game_paused = false;                // Left set by the pause and quit screens
+	fade_time = 0.f;                    // Time the settled screen, not a fade
+	game_state = bench_rally_state;
+	begin_frame_memory(&game_memory);
+	simulate_game(&bench_input, 1.f / 60.f);
+	end_frame_memory(&game_memory);
+}
+
+internal void bench_main_menu() { bench_screen(GM_MENU, MN_MAIN); }
+internal void bench_play_menu() { bench_screen(GM_MENU, MN_PLAY); }
+internal void bench_stats_menu() { bench_screen(GM_MENU, MN_STATS); }
+internal void bench_quit_menu() { bench_screen(GM_MENU, MN_QUIT); }
+internal void bench_pause_screen() { bench_screen(GM_PAUSED, MN_MAIN); }
+internal void bench_quit_dialog() { bench_screen(GM_QUIT, MN_MAIN); }
+internal void bench_gameplay_frame() { bench_screen(GM_GAMEPLAY, MN_MAIN); }
+
+// ---------------- Simulation -----------------------------------
+// AI against AI without rendering, restarting the match whenever one is won
+internal void
+bench_simulate_tick() {
+	if (game_state.which_player_won != PLAYER_NULL) game_state = bench_rally_state;
+	simulate_gameplay(&game_state, &bench_input, 1.f / 60.f);
+}
+
+// The same with the tick recorded for rewind, the difference is the cost of recording
+internal void
+bench_simulate_tick_with_rewind() {
+	bench_simulate_tick();
+	record_rewind_tick(&game_state, 1.f / 60.f);
+}
+
+// The batched path: every stress ball through the same loops, ball vs ball on
+internal void
+bench_simulate_stress_tick() {
+	simulate_stress_mode(&stress_state, &game_state.paddles, &game_state.paddle_traits, 1.f / 60.f);
+}
+
+// ---------------- Profile Store --------------------------------
+// A million profiles in a file of their own, so updates and leaderboard pages are timed with the
+// index much bigger than the caches and rows spread over thousands of file pages
+#define BENCH_PROFILES 1000000
+
+global_variable Profile_Store bench_profiles;
+global_variable u32 bench_profile_random = 0x2545f491;
+
+internal u32
+next_bench_profile_random() {
+	bench_profile_random ^= bench_profile_random << 13;
+	bench_profile_random ^= bench_profile_random >> 17;
+	bench_profile_random ^= bench_profile_random << 5;
+	return bench_profile_random;
+}
+
+internal void
+get_bench_profile_name(u32 profile, char* name) {
+	snprintf(name, PROFILE_NAME_SIZE, "PLAYER %u", profile);
+}
+
+// A match between two random players
+internal void
+bench_profile_record_match() {
+	char winner[PROFILE_NAME_SIZE], loser[PROFILE_NAME_SIZE];
+	get_bench_profile_name(next_bench_profile_random() % BENCH_PROFILES, winner);
+	get_bench_profile_name(next_bench_profile_random() % BENCH_PROFILES, loser);
+	record_profile_match(&bench_profiles, winner, true, 10, 6);
+	record_profile_match(&bench_profiles, loser, false, 6, 10);
+}
+
+internal void
+bench_profile_leaderboard_top() {
+	Leaderboard_Row rows[10];
+	query_leaderboard(&bench_profiles, RANK_BY_WIN_RATE, 0, rows, 10);
+}
+
+// A stats screen page anywhere down the leaderboard
+internal void
+bench_profile_leaderboard_page() {
+	Leaderboard_Row rows[LEADERBOARD_ROWS];
+	query_leaderboard(&bench_profiles, RANK_BY_WINS, next_bench_profile_random() % BENCH_PROFILES, rows, LEADERBOARD_ROWS);
+}
+
+// Writes the file a page at a time and opens it the way the game does. The file is unlinked once
+// open, so it goes away with the process.
+internal bool
+open_bench_profiles() {
+	size_t index_size = (size_t)BENCH_PROFILES * 64 + 16 * 1024 * 1024;
+	Memory_Arena arena = {};
+	arena.base = (u8*)os_reserve_memory(2 * index_size);
+	arena.size = index_size;
+	Memory_Arena scratch = {};
+	scratch.base = arena.base + index_size;
+	scratch.size = index_size;
+	if (!arena.base || !init_profile_store(&bench_profiles, &arena, BENCH_PROFILES)) return false;
+
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/pong_bench_profiles_%d.pongdb", (int)getpid());
+	os_set_profile_file(path);
+	static u8 page[PROFILE_PAGE_SIZE];
+	Profile_File_Header header = { PROFILE_MAGIC, PROFILE_VERSION, PROFILE_PAGE_SIZE, BENCH_PROFILES };
+	memcpy(page, &header, sizeof(header));
+	bool written = os_write_profile_file(page, 0, PROFILE_PAGE_SIZE);
+	for (u32 first = 0; written && first < BENCH_PROFILES; first += PROFILE_RECORDS_PER_PAGE) {
+		memset(page, 0, sizeof(page));
+		Profile_Record* records = (Profile_Record*)page;
+		for (u32 r = 0; r < PROFILE_RECORDS_PER_PAGE && first + r < BENCH_PROFILES; r++) {
+			get_bench_profile_name(first + r, records[r].name);
+			u32* stats = records[r].stats;
+			stats[PROFILE_MATCHES] = next_bench_profile_random() % 200;
+			stats[PROFILE_WON] = stats[PROFILE_MATCHES] ? next_bench_profile_random() % (stats[PROFILE_MATCHES] + 1) : 0;
+			stats[PROFILE_LOST] = stats[PROFILE_MATCHES] - stats[PROFILE_WON];
+			stats[PROFILE_POINTS_SCORED] = 10 * stats[PROFILE_WON] + next_bench_profile_random() % (8 * stats[PROFILE_LOST] + 1);
+			stats[PROFILE_POINTS_LOST] = 10 * stats[PROFILE_LOST] + next_bench_profile_random() % (8 * stats[PROFILE_WON] + 1);
+		}
+		written = os_write_profile_file(page, profile_record_offset(first), PROFILE_PAGE_SIZE);
+	}
+	unlink(path);
+	if (!written) return false;
+
+	u64 start = os_get_time_counter();
+	bool loaded = load_profile_store(&bench_profiles, &scratch);
+	double load_ms = (double)(os_get_time_counter() - start) * 1000.0 / os_get_time_frequency();
+	printf("profile store: %u profiles loaded in %.1f ms (%.0f MB index)\n", bench_profiles.count, load_ms, arena.used / (1024.0 * 1024.0));
+	return loaded;
+}
+
+// Every leaderboard ordered and sized right after the timed updates
+internal bool
+check_bench_profile_rankings() {
+	for (int r = 0; r < RANKING_COUNT; r++) {
+		const Profile_Tree* tree = &bench_profiles.trees[r];
+		bool ordered = profile_tree_size(tree, tree->root) == bench_profiles.count;
+		u32 above = profile_at_rank(&bench_profiles, (Profile_Ranking)r, 0);
+		for (u32 rank = 1; ordered && rank < 2000; rank++) {
+			u32 profile = profile_at_rank(&bench_profiles, (Profile_Ranking)r, rank);
+			ordered = profile != PROFILE_NONE && ranks_above(&bench_profiles, (Profile_Ranking)r, above, profile);
+			above = profile;
+		}
+		if (!ordered) {
+			printf("profile leaderboard %d is out of order\n", r);
+			return false;
+		}
+	}
+	return true;
+}
+
+// ---------------- Training Workload ----------------------------
+// Plays through the game the way a user would, frame by frame with key taps, so a profile-guided
+// build learns from gameplay and menus rather than from the timed loops above
+internal void
+train_frames(int frames) {
+	for (int f = 0; f < frames; f++) {
+		begin_frame_memory(&game_memory);
+		simulate_game(&bench_input, 1.f / 60.f);
+		begin_input_frame(&bench_input);
+		end_frame_memory(&game_memory);
+	}
+}
+
+internal void
+train_tap(Button_Key button) {
+	process_button_transition(&bench_input, button, true, 0);
+	train_frames(1);
+	process_button_transition(&bench_input, button, false, 0);
+	train_frames(1);
+}
+
+internal void
+run_training_workload() {
+	const int resolutions[][2] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+	for (int r = 0; r < (int)(sizeof(resolutions) / sizeof(resolutions[0])); r++) {
+		render_state.width = resolutions[r][0];
+		render_state.height = resolutions[r][1];
+		current_gamemode = GM_MENU;
+		current_menumode = MN_MAIN;
+		hot_menu_button = hot_gameplay_button = hot_quit_button = view_stats_menu = 0;
+
+		// Main menu round trip, the stats pages, then a single player match with a pause and a quit dialog
+		for (int i = 0; i < 3; i++) train_tap(BUTTON_DOWN);
+		train_tap(BUTTON_DOWN);
+		train_tap(BUTTON_ENTER);
+		train_tap(BUTTON_RIGHT);
+		train_tap(BUTTON_LEFT);
+		train_tap(BUTTON_ESC);
+		train_tap(BUTTON_UP);
+		train_tap(BUTTON_ENTER);
+		for (int i = 0; i < 3; i++) train_tap(BUTTON_RIGHT);
+		train_tap(BUTTON_ENTER);
+
+		for (int i = 0; i < 20; i++) {
+			bench_input.buttons[BUTTON_UP].is_down = (i % 4) < 2;      // Player 1 moves about, the AI plays player 2
+			bench_input.buttons[BUTTON_DOWN].is_down = (i % 4) >= 2;
+			train_frames(60);
+		}
+		bench_input.buttons[BUTTON_UP].is_down = bench_input.buttons[BUTTON_DOWN].is_down = false;
+		train_tap(BUTTON_P);
+		train_frames(30);
+		train_tap(BUTTON_P);
+		train_frames(120);
+		train_tap(BUTTON_ESC);
+		train_tap(BUTTON_RIGHT);
+		train_tap(BUTTON_ENTER);
+		train_frames(120);
+		train_tap(BUTTON_ESC);
+		train_tap(BUTTON_LEFT);
+		train_tap(BUTTON_ENTER);
+
+		// A short stress test, then back to the menu
+		train_tap(BUTTON_ENTER);
+		train_tap(BUTTON_RIGHT);
+		train_tap(BUTTON_RIGHT);
+		train_tap(BUTTON_ENTER);
+		train_frames(120);
+		train_tap(BUTTON_ESC);
+	}
+}
+
+// ---------------- JSON Results ---------------------------------
+internal bool
+write_results_json(const Bench_Results* results, const char* path) {
+	static char text[BENCH_MAX_METRICS * 320 + 64];
+	int length = snprintf(text, sizeof(text), "{\n  \"version\": 1,\n  \"metrics\": [\n");
+	for (int m = 0; m < results->count; m++) {
+		const Bench_Metric* metric = &results->metrics[m];
+		length += snprintf(text + length, sizeof(text) - length,
+			"    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"mad_ns\": %.2f, \"ops_per_second\": %.1f, \"samples\": %d",
+			metric->name, metric->ns_per_op, metric->mad_ns, 1000000000.0 / metric->ns_per_op, metric->samples);
+		for (int c = 0; c < COUNTER_COUNT && metric->counted; c++) {
+			if (metric->counters[c] >= 0) length += snprintf(text + length, sizeof(text) - length, ", \"%s\": %.1f", counter_names[c], metric->counters[c]);
+		}
+		length += snprintf(text + length, sizeof(text) - length, "}%s\n", m + 1 < results->count ? "," : "");
+	}
+	length += snprintf(text + length, sizeof(text) - length, "  ]\n}\n");
+
+	String data = { text, (unsigned int)length };
+	return os_write_entire_file(path, data);
+}
+
+// Reads back the metrics of a file written by write_results_json(), not a general JSON parser
+internal bool
+read_results_json(Bench_Results* results, const char* path) {
+	// Read null terminated, so the string functions stop at the end of the file
+	String file = os_read_entire_file(&game_memory.transient, path);
+	if (!file.data) return false;
+	char* text = file.data;
+
+	results->count = 0;
+	for (char* at = strstr(text, "\"name\": \""); at && results->count < BENCH_MAX_METRICS; at = strstr(at, "\"name\": \"")) {
+		Bench_Metric* metric = &results->metrics[results->count];
+		at += strlen("\"name\": \"");
+		char* end = strchr(at, '"');
+		if (!end || end - at >= (int)sizeof(metric->name)) break;
+		memcpy(metric->name, at, end - at);
+		metric->name[end - at] = 0;
+
+		char* ns = strstr(end, "\"ns_per_op\": ");
+		char* mad = strstr(end, "\"mad_ns\": ");
+		char* samples = strstr(end, "\"samples\": ");
+		if (!ns || !mad || !samples) break;
+		metric->ns_per_op = atof(ns + strlen("\"ns_per_op\": "));
+		metric->mad_ns = atof(mad + strlen("\"mad_ns\": "));
+		metric->samples = atoi(samples + strlen("\"samples\": "));
+		metric->op = 0;
+
+		// Counters are optional and only count when they are inside this metric's braces
+		char* close = strchr(end, '}');
+		metric->counted = false;
+		for (int c = 0; c < COUNTER_COUNT; c++) {
+			char key[32];
+			snprintf(key, sizeof(key), "\"%s\": ", counter_names[c]);
+			char* counter = strstr(end, key);
+			metric->counters[c] = counter && close && counter < close ? atof(counter + strlen(key)) : -1.0;
+			if (metric->counters[c] >= 0) metric->counted = true;
+		}
+		results->count++;
+		at = end;
+	}
+
+	return results->count > 0;
+}
+
+internal bool
+is_regression(const Bench_Metric* metric, const Bench_Metric* base, double threshold) {
+	double noise = 3.0 * (metric->mad_ns + base->mad_ns);
+	return metric->ns_per_op > (1.0 + threshold) * base->ns_per_op && metric->ns_per_op - base->ns_per_op > noise;
+}
+
+// A metric regresses when it is slower by more than threshold and the difference is well outside
+// the noise of both runs. A whole run can be slowed down by another process, so a metric has to
+// stay regressed over a few fresh measurements (the fastest one counts) before it is reported.
+// Returns the number of regressions.
+internal int
+compare_with_baseline(Bench_Results* results, const Bench_Results* baseline, double threshold) {
+	const int confirmations = 3;
+	int regressions = 0;
+	int compared = 0;
+	double log_ratio_sum = 0.0;
+	printf("\n%-36s %12s %12s %8s\n", "metric", "baseline ns", "current ns", "change");
+	for (int m = 0; m < results->count; m++) {
+		Bench_Metric* metric = &results->metrics[m];
+		const Bench_Metric* base = 0;
+		for (int b = 0; b < baseline->count; b++) {
+			if (!strcmp(baseline->metrics[b].name, metric->name)) base = &baseline->metrics[b];
+		}
+		if (!base) {
+			printf("%-36s %12s %12.1f %8s\n", metric->name, "-", metric->ns_per_op, "new");
+			continue;
+		}
+
+		// Merged results come from files and cannot be re-measured
+		for (int c = 0; c < confirmations && metric->op && is_regression(metric, base, threshold); c++) {
+			Bench_Metric retry = *metric;
+			measure_metric(&retry);
+			if (retry.ns_per_op < metric->ns_per_op) *metric = retry;
+		}
+
+		double change = metric->ns_per_op / base->ns_per_op - 1.0;
+		bool regressed = is_regression(metric, base, threshold);
+		log_ratio_sum += log(metric->ns_per_op / base->ns_per_op);
+		compared++;
+		regressions += regressed;
+		printf("%-36s %12.1f %12.1f %+7.1f%%%s\n", metric->name, base->ns_per_op, metric->ns_per_op, 100.0 * change,
+			regressed ? "  REGRESSED" : "");
+	}
+	if (compared) printf("\ngeometric mean change over %d metrics: %+.1f%%\n", compared, 100.0 * (exp(log_ratio_sum / compared) - 1.0));
+	return regressions;
+}
+
+internal bool
+has_listed_prefix(const char* name, const char* prefixes) {
+	for (const char* prefix = prefixes; *prefix;) {
+		const char* comma = strchr(prefix, ',');
+		size_t length = comma ? (size_t)(comma - prefix) : strlen(prefix);
+		if (length && !strncmp(name, prefix, length)) return true;
+		if (!comma) break;
+		prefix = comma + 1;
+	}
+	return false;
+}
+
+// The baseline again, but with the metrics whose names start with one of the comma separated
+// prefixes taken from results: replaced in place, dropped when results no longer have them and
+// added at the end when new. Every other metric keeps the numbers it was baselined with.
+internal void
+update_baseline_metrics(Bench_Results* results, const Bench_Results* baseline, const char* prefixes) {
+	static Bench_Results updated;
+	updated.count = 0;
+	for (int b = 0; b < baseline->count; b++) {
+		const Bench_Metric* metric = &baseline->metrics[b];
+		if (has_listed_prefix(metric->name, prefixes)) {
+			metric = 0;
+			for (int m = 0; m < results->count; m++) {
+				if (!strcmp(results->metrics[m].name, baseline->metrics[b].name)) metric = &results->metrics[m];
+			}
+		}
+		if (metric) updated.metrics[updated.count++] = *metric;
+	}
+
+	for (int m = 0; m < results->count && updated.count < BENCH_MAX_METRICS; m++) {
+		if (!has_listed_prefix(results->metrics[m].name, prefixes)) continue;
+		bool found = false;
+		for (int b = 0; b < baseline->count; b++) found |= !strcmp(baseline->metrics[b].name, results->metrics[m].name);
+		if (!found) updated.metrics[updated.count++] = results->metrics[m];
+	}
+	*results = updated;
+}
+
+// Combines several separate runs: for each metric, the run with the median time. Timings shift
+// between processes (code and page placement), which more samples within one run cannot show.
+internal bool
+merge_results(Bench_Results* merged, const char** paths, int count) {
+	static Bench_Results runs[BENCH_MAX_MERGED];
+	for (int r = 0; r < count; r++) {
+		if (!read_results_json(&runs[r], paths[r])) {
+			printf("could not read %s\n", paths[r]);
+			return false;
+		}
+	}
+
+	for (int m = 0; m < runs[0].count; m++) {
+		Bench_Metric found[BENCH_MAX_MERGED];
+		double times[BENCH_MAX_MERGED];
+		int found_count = 0;
+		for (int r = 0; r < count; r++) {
+			for (int n = 0; n < runs[r].count; n++) {
+				if (strcmp(runs[r].metrics[n].name, runs[0].metrics[m].name)) continue;
+				found[found_count] = runs[r].metrics[n];
+				times[found_count++] = runs[r].metrics[n].ns_per_op;
+			}
+		}
+
+		double median = median_of(times, found_count);
+		for (int f = 0; f < found_count; f++) {
+			if (found[f].ns_per_op == median || f + 1 == found_count) {
+				merged->metrics[merged->count++] = found[f];
+				break;
+			}
+		}
+	}
+	printf("merged %d runs of %d metrics\n", count, merged->count);
+	return true;
+}
+
+// Counts the 4K metrics starting with prefix that are slower than budget_ns
+internal int
+check_4k_budget(const Bench_Results* results, const char* prefix, double budget_ns) {
+	int over_budget = 0;
+	for (int m = 0; m < results->count; m++) {
+		const Bench_Metric* metric = &results->metrics[m];
+		if (strncmp(metric->name, prefix, strlen(prefix)) || !strstr(metric->name, "/3840x2160")) continue;
+
+		bool over = metric->ns_per_op > budget_ns;
+		printf("%-36s %6.2f ms of the %.0f ms budget%s\n", metric->name, metric->ns_per_op / 1e6, budget_ns / 1e6, over ? "  OVER BUDGET" : "");
+		over_budget += over;
+	}
+	return over_budget;
+}
+
+// The incremental background has to give the per-pixel formula's frame exactly, at widths that
+// do and do not fill the 16 pixel steps and at times where the origin is on and off the screen
+internal bool
+check_background_matches_naive(u32* reference) {
+	const int sizes[][2] = { { 3840, 2160 }, { 1283, 7 }, { 15, 3 } };
+	for (int s = 0; s < 3; s++) {
+		render_state.width = sizes[s][0];
+		render_state.height = sizes[s][1];
+		size_t size = (size_t)render_state.width * render_state.height * sizeof(u32);
+		for (float time = 0.f; time < 100.f; time += 9.7f) {
+			draw_procedural_background_naive(time);
+			memcpy(reference, render_state.memory, size);
+			draw_procedural_background(time);
+			if (memcmp(reference, render_state.memory, size)) {
+				printf("procedural background differs from the per-pixel formula at %dx%d, time %.1f\n", render_state.width, render_state.height, time);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// A batch has to land every rect on the pixels draw_rect() does, for counts that do and do not fill
+// the four rect SSE2 steps, rects partly and fully off the screen and a blended batch
+internal bool
+check_rect_batch_matches_single(u32* reference) {
+	const int sizes[][2] = { { 1920, 1080 }, { 1283, 7 }, { 15, 3 } };
+	u32 random_state = 0x2545f491;
+	for (int s = 0; s < 3; s++) {
+		render_state.width = sizes[s][0];
+		render_state.height = sizes[s][1];
+		size_t size = (size_t)render_state.width * render_state.height * sizeof(u32);
+		for (int count = 1; count <= 2*RECT_BATCH_CAPACITY + 3; count += 7) {
+			float rects[2*RECT_BATCH_CAPACITY + 3][4];
+			for (int i = 0; i < count; i++) {
+				for (int c = 0; c < 4; c++) {
+					random_state = random_state*1664525u + 1013904223u;
+					rects[i][c] = c < 2 ? (int)(random_state >> 16) % 24000 / 100.f - 120.f : (random_state >> 16) % 3000 / 100.f;
+				}
+			}
+
+			clear_screen(0x000000);
+			for (int i = 0; i < count; i++) draw_rect(rects[i][0], rects[i][1], rects[i][2], rects[i][3], 0x10000 * i + 0x2a);
+			for (int i = 0; i < count; i++) draw_rect_blended<BLEND_ALPHA>(rects[i][1], rects[i][0], rects[i][3], rects[i][2], 0xffffff, 96);
+			memcpy(reference, render_state.memory, size);
+
+			Rect_Batch batch;
+			batch.count = 0;
+			clear_screen(0x000000);
+			for (int i = 0; i < count; i++) push_rect(&batch, rects[i][0], rects[i][1], rects[i][2], rects[i][3], 0x10000 * i + 0x2a);
+			draw_rect_batch(&batch);
+			for (int i = 0; i < count; i++) push_rect_blended<BLEND_ALPHA>(&batch, rects[i][1], rects[i][0], rects[i][3], rects[i][2], 0xffffff, 96);
+			draw_rect_batch_blended<BLEND_ALPHA>(&batch);
+			if (memcmp(reference, render_state.memory, size)) {
+				printf("rect batch of %d differs from single draw_rect calls at %dx%d\n", count, render_state.width, render_state.height);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+internal void
+measure_all_metrics(Bench_Results* results, const int resolutions[][2], int resolution_count) {
+	// A rally a few seconds in, AI against AI, with fixed serves so every run times the same frames
+	is_player1_ai = true;
+	is_player2_ai = true;
+	init_match(&bench_rally_state);
+	bench_rally_state.random_state = 0x1234567;
+	bench_rally_state.ai_random_state = 0x89abcdef;
+	bench_rally_state.keeps_stats = false;         // The matches it plays are not written to the profile file
+	for (int t = 0; t < 300; t++) {
+		simulate_gameplay(&bench_rally_state, &bench_input, 1.f / 60.f);
+	}
+
+	char name[64];
+	for (int r = 0; r < resolution_count; r++) {
+		render_state.width = resolutions[r][0];
+		render_state.height = resolutions[r][1];
+
+		struct { const char* name; void (*op)(); } ops[] = {
+			{ "clear_screen", bench_clear_screen },
+			{ "draw_rect_in_pixels", bench_draw_rect_in_pixels },
+			{ "draw_rect", bench_draw_rect },
+			{ "draw_text", bench_draw_text },
+			{ "draw_number", bench_draw_number },
+			{ "draw_bounds", bench_draw_bounds },
+			{ "overlay_alpha", bench_overlay_alpha },
+			{ "overlay_add", bench_overlay_add },
+			{ "overlay_multiply", bench_overlay_multiply },
+			{ "draw_text_alpha", bench_draw_text_alpha },
+			{ "draw_rects_256", bench_draw_rects },
+			{ "draw_rects_256_batched", bench_draw_rects_batched },
+			{ "procedural_background", bench_background },
+			{ "procedural_background_naive", bench_background_naive },
+			{ "screen_main_menu", bench_main_menu },
+			{ "screen_play_menu", bench_play_menu },
+			{ "screen_stats_menu", bench_stats_menu },
+			{ "screen_quit_menu", bench_quit_menu },
+			{ "screen_paused", bench_pause_screen },
+			{ "screen_quit_dialog", bench_quit_dialog },
+			{ "screen_gameplay", bench_gameplay_frame },
+		};
+		for (int o = 0; o < (int)(sizeof(ops) / sizeof(ops[0])); o++) {
+			snprintf(name, sizeof(name), "%s/%dx%d", ops[o].name, render_state.width, render_state.height);
+			run_metric(results, name, ops[o].op);
+		}
+	}
+
+	game_state = bench_rally_state;
+	run_metric(results, "simulate_gameplay_tick", bench_simulate_tick);
+	clear_rewind_history();
+	run_metric(results, "simulate_gameplay_tick_rewind", bench_simulate_tick_with_rewind);
+	clear_rewind_history();
+
+	stress_state = {};
+	init_stress_mode(&stress_state, 4096);
+	stress_state.balls_collide = true;
+	run_metric(results, "simulate_stress_tick/4096", bench_simulate_stress_tick);
+	stress_state = {};
+
+	snprintf(name, sizeof(name), "profile_record_match/%d", BENCH_PROFILES);
+	run_metric(results, name, bench_profile_record_match);
+	snprintf(name, sizeof(name), "profile_leaderboard_top10/%d", BENCH_PROFILES);
+	run_metric(results, name, bench_profile_leaderboard_top);
+	snprintf(name, sizeof(name), "profile_leaderboard_page/%d", BENCH_PROFILES);
+	run_metric(results, name, bench_profile_leaderboard_page);
+}
+
+int main(int argc, char** argv) {
+	const char* json_path = 0;
+	const char* baseline_path = 0;
+	double threshold = .25;
+	bool train = false;
+	bool counters = true;
+	int render_threads = -1;
+	const char* update_prefixes = 0;
+	const char* merge_paths[BENCH_MAX_MERGED];
+	int merge_count = 0;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-json") && i + 1 < argc) json_path = argv[++i];
+		else if (!strcmp(argv[i], "-merge")) {
+			while (i + 1 < argc && argv[i + 1][0] != '-' && merge_count < BENCH_MAX_MERGED) merge_paths[merge_count++] = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-baseline") && i + 1 < argc) baseline_path = argv[++i];
+		else if (!strcmp(argv[i], "-threshold") && i + 1 < argc) threshold = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-update") && i + 1 < argc) update_prefixes = argv[++i];
+		else if (!strcmp(argv[i], "-train")) train = true;
+		else if (!strcmp(argv[i], "-no-counters")) counters = false;
+		else if (!strcmp(argv[i], "-render-threads") && i + 1 < argc) render_threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-quick")) {
+			bench_samples = 7;
+			bench_min_batch_ns = 500000.0;
+		}
+	}
+
+	if (update_prefixes && !baseline_path) {
+		printf("-update needs the -baseline it updates\n");
+		return 2;
+	}
+
+	const int resolutions[][2] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+
+	// One reserved block: a framebuffer for the biggest resolution and a second one to check frames
+	// against, and the transient arena for save and results files
+	size_t framebuffer_size = 3840 * 2160 * sizeof(u32);
+	size_t permanent_size = 2 * framebuffer_size + 1024 * 1024;
+	size_t transient_size = 4 * 1024 * 1024;
+	void* memory_block = os_reserve_memory(permanent_size + transient_size);
+	if (!memory_block) return 2;
+	init_game_memory(&game_memory, memory_block, permanent_size, transient_size);
+	render_state.memory = push_size(&game_memory.permanent, framebuffer_size);
+	if (train) {
+		run_training_workload();
+		return 0;
+	}
+
+	static Bench_Results results;
+	if (merge_count) {
+		if (!merge_results(&results, merge_paths, merge_count)) return 2;
+	}
+	else {
+		render_threads = start_render_workers(render_threads);
+		u32* reference = (u32*)push_size(&game_memory.permanent, framebuffer_size);
+		if (!check_background_matches_naive(reference)) return 1;
+		if (!check_rect_batch_matches_single(reference)) return 1;
+		if (counters) open_bench_counters(&bench_counters);
+		if (!open_bench_profiles()) {
+			printf("could not write the profile file\n");
+			return 2;
+		}
+		measure_all_metrics(&results, resolutions, (int)(sizeof(resolutions) / sizeof(resolutions[0])));
+		if (!check_bench_profile_rankings()) return 1;
+	}
+
+	// Overlays have to fit a 60 Hz frame at 4K whatever the baseline says, the animated background 2 ms
+	int over_budget = check_4k_budget(&results, "overlay_", 16000000.0);
+	int background_over_budget = check_4k_budget(&results, "procedural_background/", 2000000.0);
+	if (background_over_budget && render_threads >= 0) {
+		printf("procedural background: over the 2 ms budget at 4K drawn by %d thread%s (the bench and %d render worker%s),\n"
+			"this machine has too few processors or too little memory bandwidth to meet it\n",
+			render_threads + 1, render_threads ? "s" : "", render_threads, render_threads == 1 ? "" : "s");
+	}
+	over_budget += background_over_budget;
+
+	// Re-measured metrics are compared first, so the JSON holds their confirmed times
+	int regressions = 0;
+	static Bench_Results baseline;
+	if (baseline_path) {
+		if (!read_results_json(&baseline, baseline_path)) {
+			printf("could not read baseline %s\n", baseline_path);
+			return 2;
+		}
+		regressions = compare_with_baseline(&results, &baseline, threshold);
+		printf("\n%d metric%s regressed by more than %.0f%%\n", regressions, regressions == 1 ? "" : "s", 100.0 * threshold);
+	}
+
+	// A change re-baselines the metrics it meant to change, not every number in the file
+	if (update_prefixes) update_baseline_metrics(&results, &baseline, update_prefixes);
+
+	if (json_path && !write_results_json(&results, json_path)) {
+		printf("could not write %s\n", json_path);
+		return 2;
+	}
+	return regressions || over_budget ? 1 : 0;
+}
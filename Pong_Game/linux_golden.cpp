@@ -0,0 +1,541 @@
+// Golden image harness: plays scripted scenarios through simulate_game() on a headless framebuffer
+// at several resolutions, hashes every frame and checks the hashes against a stored list, so
+// renderer changes can be shown to be pixel-identical.
+// Build: g++ -O2 -o pong_golden linux_golden.cpp
+// Usage: ./pong_golden [-golden golden_hashes.txt] [-out golden_out] [-reference dir]
+//        ./pong_golden -update [-golden golden_hashes.txt]
+//        ./pong_golden -write-reference dir [-only scenario]
+// On a mismatch the first differing frame of each scenario is written to the -out directory as
+// <scenario>_<width>x<height>_<frame>.ppm. A -reference directory holding the same frame from a
+// known good build (made with -write-reference) also gets a _diff.ppm marking the changed pixels.
+// Exit code: 0 when every frame matches, 1 on a mismatch, 2 when a file cannot be read or written
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "utils.cpp"
+
+struct Render_State {
+	int width, height;
+	void* memory;
+};
+
+global_variable bool running = true;
+global_variable Render_State render_state;
+
+#include "renderer.cpp"
+#include "platform_common.cpp"
+
+// ---------------- Deterministic Platform Layer --------------------
+// The game sees a clock that advances exactly one frame per simulated frame, a save file held in
+// memory and no network, so every run draws the same frames
+global_variable u64 golden_clock;
+global_variable char golden_save[256];
+global_variable unsigned int golden_save_size;
+
+internal void*
+os_reserve_memory(size_t size) {
+	os_allocation_count++;
+	return calloc(1, size);
+}
+
+// Null terminated, like the other platform layers
+internal String
+os_read_entire_file(Memory_Arena* arena, const char* file_path) {
+	String result = { 0 };
+	FILE* file = fopen(file_path, "rb");
+	if (!file) return result;
+
+	fseek(file, 0, SEEK_END);
+	unsigned int size = (unsigned int)ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* data = (char*)push_size(arena, (size_t)size + 1);
+	if (data && fread(data, 1, size, file) == size) {
+		data[size] = 0;
+		result.data = data;
+		result.size = size;
+	}
+	fclose(file);
+	return result;
+}
+
+internal int
+os_write_entire_file(const char* file_path, String data) {
+	FILE* file = fopen(file_path, "wb");
+	if (!file) return false;
+	int result = fwrite(data.data, 1, data.size, file) == data.size;
+	fclose(file);
+	return result;
+}
+
+internal String
+os_read_save_file(Memory_Arena* arena) {
+	String result = { 0 };
+	char* data = (char*)push_size(arena, golden_save_size);
+	if (!data) return result;
+	memcpy(data, golden_save, golden_save_size);
+	result.data = data;
+	result.size = golden_save_size;
+	return result;
+}
+
+internal int
+os_write_save_file(String data) {
+	if (data.size > sizeof(golden_save)) return false;
+	memcpy(golden_save, data.data, data.size);
+	golden_save_size = data.size;
+	return true;
+}
+
+// The profile file is kept in memory too, seeded with the same players for every scenario
+global_variable u8 golden_profiles[16 * 1024];
+global_variable u32 golden_profiles_size;
+
+internal int
+os_read_profile_file(void* buffer, u64 offset, u32 size) {
+	if (offset >= golden_profiles_size) return 0;
+	u32 available = golden_profiles_size - (u32)offset;
+	u32 bytes_read = size < available ? size : available;
+	memcpy(buffer, golden_profiles + offset, bytes_read);
+	return (int)bytes_read;
+}
+
+internal int
+os_write_profile_file(const void* data, u64 offset, u32 size) {
+	if (offset + size > sizeof(golden_profiles)) return false;
+	memcpy(golden_profiles + offset, data, size);
+	if (offset + size > golden_profiles_size) golden_profiles_size = (u32)(offset + size);
+	return true;
+}
+
+// Scenarios never resume a match, and what they suspend is dropped
+internal String
+os_read_suspend_file(Memory_Arena* arena) {
+	String result = { 0 };
+	return result;
+}
+
+internal int
+os_write_suspend_file(String data) {
+	return true;
+}
+
+internal u64
+os_get_time_counter() {
+	return golden_clock;
+}
+
+internal u64
+os_get_time_frequency() {
+	return 1000000000ull;
+}
+
+internal bool os_udp_open(u16 local_port, const char* remote_host, u16 remote_port) { return false; }
+internal void os_udp_close() {}
+internal void os_udp_send(const void* data, int size) {}
+internal int os_udp_receive(void* buffer, int max_size) { return -1; }
+
+#include "game.cpp"
+
+// ---------------- Scenarios ------------------------------------
+// A script is one character per frame: '.' waits, U D L R are the arrows, w s a d the second
+// player's keys, P pause, E enter and X escape. A count before a key holds it for that many
+// frames ("20U"), before a '.' waits that long. '!' runs the scenario's hook without using a frame.
+struct Golden_Scenario {
+	const char* name;
+	const char* script;
+	void (*hook)();
+};
+
+// Both sides one point from winning, so the next point ends the match
+internal void
+set_match_point() {
+	game_state.score[SIDE_LEFT] = win_score - 1;
+	game_state.score[SIDE_RIGHT] = win_score - 1;
+}
+
+global_variable Golden_Scenario golden_scenarios[] = {
+	{ "main_menu", "..D.D.D.U.U.U.", 0 },
+	{ "play_menu", "E..R.R.R.L.X.", 0 },
+	{ "stats_menu", "D.E..D.U.X.", 0 },
+	{ "leaderboard", "D.E..D.D..R..L..E..E..X.", 0 },
+	{ "quit_menu", "D.D.E..R.L.X.", 0 },
+	{ "single_player", "E.E30.20U40.20D20.P12.P20.X12.R.E20.", 0 },
+	{ "multiplayer", "E.R.E20.15w15U15s15D30.", 0 },
+	{ "stress", "E.R.R.E30.P20.E20.X.", 0 },
+	{ "rewind", "E.E60.P12.30L.R.R.U.D.P20.", 0 },
+	{ "match_end", "E.E10.!400.E.", set_match_point },
+};
+
+global_variable const int golden_resolutions[][2] = { { 640, 360 }, { 1280, 720 }, { 797, 451 } };   // The odd size exercises the SIMD row tails
+
+internal int
+golden_key_button(char key) {
+	switch (key) {
+		case 'U': return BUTTON_UP;
+		case 'D': return BUTTON_DOWN;
+		case 'L': return BUTTON_LEFT;
+		case 'R': return BUTTON_RIGHT;
+		case 'w': return BUTTON_W;
+		case 's': return BUTTON_S;
+		case 'a': return BUTTON_A;
+		case 'd': return BUTTON_D;
+		case 'P': return BUTTON_P;
+		case 'E': return BUTTON_ENTER;
+		case 'X': return BUTTON_ESC;
+	}
+	return -1;
+}
+
+// The same profiles on file for every scenario, more than a leaderboard page holds
+internal void
+seed_golden_profiles() {
+	struct { const char* name; u32 stats[PROFILE_STAT_COUNT]; } seeds[] = {
+		{ "PLAYER I", { 12, 7, 5, 150, 131 } },
+		{ "PLAYER II", { 4, 1, 3, 40, 55 } },
+		{ "Ada", { 30, 21, 9, 402, 310 } },
+		{ "grace.h", { 9, 8, 1, 115, 60 } },
+		{ "Linus", { 21, 7, 14, 260, 301 } },
+		{ "margaret", { 2, 2, 0, 28, 11 } },
+		{ "Ken_T", { 17, 11, 6, 230, 198 } },
+		{ "Dennis", { 0, 0, 0, 0, 0 } },
+	};
+	u32 count = sizeof(seeds) / sizeof(seeds[0]);
+	golden_profiles_size = 0;
+	for (u32 i = 0; i < count; i++) {
+		Profile_Record record = {};
+		snprintf(record.name, sizeof(record.name), "%s", seeds[i].name);
+		memcpy(record.stats, seeds[i].stats, sizeof(record.stats));
+		os_write_profile_file(&record, profile_record_offset(i), sizeof(record));
+	}
+	Profile_File_Header header = { PROFILE_MAGIC, PROFILE_VERSION, PROFILE_PAGE_SIZE, count };
+	os_write_profile_file(&header, 0, sizeof(header));
+	profile_store.opened = false;
+	profile_store_error = 0;
+	leaderboard_ranking = RANK_BY_WINS;
+	leaderboard_first = 0;
+}
+
+// Every scenario starts from the main menu of a fresh game with the same stats on file
+internal void
+reset_scenario(Input* input) {
+	golden_clock = 1;
+	Save_Data stats = { 0, { 12, 7, 5, 150, 131, 4, 1, 3, 40, 55 } };
+	os_write_save_file(String{ (char*)&stats, sizeof(stats) });
+	seed_golden_profiles();
+
+	*input = {};
+	stress_state = {};
+	is_player1_ai = false;
+	is_player2_ai = true;
+	reset_game();
+	hot_gameplay_button = 0;
+	hot_menu_button = 0;
+	view_stats_menu = 0;
+	hot_quit_button = 0;
+	game_paused = false;
+	fade_time = 0.f;
+	last_screen_key = {};
+	last_frame_was_animated = false;
+	memset(render_state.memory, 0, render_state.width * render_state.height * sizeof(u32));
+}
+
+// FNV-1a over whole pixels
+internal u64
+hash_framebuffer() {
+	u64 hash = 0xcbf29ce484222325ull;
+	u32* pixel = (u32*)render_state.memory;
+	for (int i = 0; i < render_state.width * render_state.height; i++) {
+		hash = (hash ^ pixel[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// ---------------- Golden Hashes --------------------------------
+#define GOLDEN_MAX_ENTRIES 8192
+
+struct Golden_Entry {
+	char key[48];                       // scenario/widthxheight
+	int frame;
+	u64 hash;
+};
+
+struct Golden_List {
+	Golden_Entry entries[GOLDEN_MAX_ENTRIES];
+	int count;
+};
+
+internal bool
+read_golden_list(Golden_List* list, const char* path) {
+	// Read null terminated, so the string functions stop at the end of the file
+	String file = os_read_entire_file(&game_memory.transient, path);
+	if (!file.data) return false;
+	char* text = file.data;
+
+	list->count = 0;
+	for (char* line = strtok(text, "\n"); line && list->count < GOLDEN_MAX_ENTRIES; line = strtok(0, "\n")) {
+		if (line[0] == '#') continue;
+		Golden_Entry* entry = &list->entries[list->count];
+		unsigned long long hash;
+		if (sscanf(line, "%47s %d %llx", entry->key, &entry->frame, &hash) == 3) {
+			entry->hash = hash;
+			list->count++;
+		}
+	}
+	return true;
+}
+
+internal bool
+write_golden_list(const Golden_List* list, const char* path) {
+	int size = 128 + list->count * 80;
+	char* text = (char*)push_size(&game_memory.transient, size);
+	if (!text) return false;
+	int length = snprintf(text, size, "# scenario/resolution frame framebuffer hash, written by pong_golden -update\n");
+	for (int e = 0; e < list->count; e++) {
+		const Golden_Entry* entry = &list->entries[e];
+		length += snprintf(text + length, size - length, "%s %d %016llx\n", entry->key, entry->frame, (unsigned long long)entry->hash);
+	}
+
+	String data = { text, (unsigned int)length };
+	return os_write_entire_file(path, data);
+}
+
+// Entries are checked in the order they were written, so the search starts after the last match
+internal const Golden_Entry*
+find_golden_entry(const Golden_List* list, const char* key, int frame, int* cursor) {
+	for (int i = 0; i < list->count; i++) {
+		const Golden_Entry* entry = &list->entries[(*cursor + i) % list->count];
+		if (entry->frame == frame && !strcmp(entry->key, key)) {
+			*cursor = (*cursor + i + 1) % list->count;
+			return entry;
+		}
+	}
+	return 0;
+}
+
+// ---------------- PPM Images -----------------------------------
+internal bool
+write_ppm(const char* path, const u32* pixels, int width, int height) {
+	int header_size = 32;
+	char* text = (char*)push_size(&game_memory.transient, header_size + width * height * 3);
+	if (!text) return false;
+	int length = snprintf(text, header_size, "P6\n%d %d\n255\n", width, height);
+
+	// The framebuffer is bottom up
+	for (int y = height - 1; y >= 0; y--) {
+		for (int x = 0; x < width; x++) {
+			u32 color = pixels[x + y * width];
+			text[length++] = (char)(color >> 16);
+			text[length++] = (char)(color >> 8);
+			text[length++] = (char)color;
+		}
+	}
+
+	String data = { text, (unsigned int)length };
+	return os_write_entire_file(path, data);
+}
+
+// Reads a PPM written by write_ppm() back into framebuffer order, returns 0 if it does not match the size
+internal u32*
+read_ppm(const char* path, int width, int height) {
+	String file = os_read_entire_file(&game_memory.transient, path);
+	if (!file.data) return 0;
+
+	int file_width, file_height, header_size = 0;
+	u32* pixels = 0;
+	if (file.size > 16 && sscanf(file.data, "P6 %d %d 255%n", &file_width, &file_height, &header_size) == 2 &&
+		file_width == width && file_height == height && file.size >= header_size + 1 + width * height * 3u) {
+		pixels = push_array(&game_memory.transient, u32, width * height);
+		if (!pixels) return 0;
+		const u8* rgb = (const u8*)file.data + header_size + 1;
+		for (int y = height - 1; y >= 0; y--) {
+			for (int x = 0; x < width; x++, rgb += 3) {
+				pixels[x + y * width] = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+			}
+		}
+	}
+	return pixels;
+}
+
+// Changed pixels in red over a darkened copy of the current frame, returns how many changed
+internal int
+write_diff_ppm(const char* path, const u32* reference, const u32* current, int width, int height) {
+	u32* diff = push_array(&game_memory.transient, u32, width * height);
+	if (!diff) return 0;
+	int changed = 0;
+	for (int i = 0; i < width * height; i++) {
+		if ((reference[i] & 0xffffff) != (current[i] & 0xffffff)) {
+			diff[i] = 0xff0000;
+			changed++;
+		}
+		else {
+			diff[i] = (current[i] >> 2) & 0x3f3f3f;
+		}
+	}
+	write_ppm(path, diff, width, height);
+	return changed;
+}
+
+// ---------------- Runner ---------------------------------------
+enum Golden_Mode {
+	GOLDEN_CHECK,
+	GOLDEN_UPDATE,
+	GOLDEN_WRITE_REFERENCE,
+};
+
+struct Golden_Run {
+	Golden_Mode mode;
+	Golden_List* golden;
+	Golden_List* results;
+	const char* out_dir;
+	const char* reference_dir;
+	int mismatched_scenarios;
+	int golden_cursor;
+};
+
+// Plays one scenario at the current resolution, returns false if it could not write an image
+internal bool
+run_scenario(Golden_Run* run, const Golden_Scenario* scenario) {
+	char key[48];
+	snprintf(key, sizeof(key), "%s/%dx%d", scenario->name, render_state.width, render_state.height);
+
+	static Input input;
+	reset_scenario(&input);
+
+	int frame = 0;
+	bool mismatched = false;
+	int held_button = -1;
+	for (const char* at = scenario->script; *at; at++) {
+		if (*at == '!') {
+			if (scenario->hook) scenario->hook();
+			continue;
+		}
+
+		int count = 1;
+		if (*at >= '0' && *at <= '9') {
+			count = (int)strtol(at, (char**)&at, 10);
+			if (!*at) break;
+		}
+
+		for (int f = 0; f < count; f++, frame++) {
+			begin_frame_memory(&game_memory);
+			begin_input_frame(&input);
+			int button = golden_key_button(*at);
+			if (held_button != button && held_button >= 0) process_button_transition(&input, held_button, false, golden_clock);
+			if (button >= 0) process_button_transition(&input, button, true, golden_clock);
+			held_button = button;
+
+			simulate_game(&input, 1.f / 60.f);
+			golden_clock += 1000000000ull / 60;
+
+			u64 hash = hash_framebuffer();
+			char name[128];
+			snprintf(name, sizeof(name), "%s/%s_%dx%d_%04d.ppm", run->out_dir, scenario->name, render_state.width, render_state.height, frame);
+
+			if (run->mode == GOLDEN_WRITE_REFERENCE) {
+				if (!write_ppm(name, (u32*)render_state.memory, render_state.width, render_state.height)) return false;
+				continue;
+			}
+			if (run->mode == GOLDEN_UPDATE) {
+				if (run->results->count >= GOLDEN_MAX_ENTRIES) continue;
+				Golden_Entry* entry = &run->results->entries[run->results->count++];
+				snprintf(entry->key, sizeof(entry->key), "%s", key);
+				entry->frame = frame;
+				entry->hash = hash;
+				continue;
+			}
+
+			// Only the first mismatch of a scenario is reported, later frames usually follow from it
+			const Golden_Entry* expected = find_golden_entry(run->golden, key, frame, &run->golden_cursor);
+			if (mismatched || (expected && expected->hash == hash)) continue;
+			mismatched = true;
+			run->mismatched_scenarios++;
+			if (!expected) {
+				printf("%-28s frame %4d  no golden hash\n", key, frame);
+				continue;
+			}
+
+			if (!write_ppm(name, (u32*)render_state.memory, render_state.width, render_state.height)) return false;
+			printf("%-28s frame %4d  MISMATCH  %s", key, frame, name);
+
+			u32* reference = 0;
+			if (run->reference_dir) {
+				char reference_name[128];
+				snprintf(reference_name, sizeof(reference_name), "%s/%s_%dx%d_%04d.ppm", run->reference_dir, scenario->name, render_state.width, render_state.height, frame);
+				reference = read_ppm(reference_name, render_state.width, render_state.height);
+			}
+			if (reference) {
+				char diff_name[136];
+				snprintf(diff_name, sizeof(diff_name), "%.*s_diff.ppm", (int)strlen(name) - 4, name);
+				int changed = write_diff_ppm(diff_name, reference, (u32*)render_state.memory, render_state.width, render_state.height);
+				printf(", %d pixels differ: %s", changed, diff_name);
+			}
+			printf("\n");
+		}
+	}
+
+	if (run->mode == GOLDEN_CHECK && !mismatched) printf("%-28s %4d frames ok\n", key, frame);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	const char* golden_path = "golden_hashes.txt";
+	const char* only = 0;
+	Golden_Run run = {};
+	run.out_dir = "golden_out";
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-golden") && i + 1 < argc) golden_path = argv[++i];
+		else if (!strcmp(argv[i], "-out") && i + 1 < argc) run.out_dir = argv[++i];
+		else if (!strcmp(argv[i], "-reference") && i + 1 < argc) run.reference_dir = argv[++i];
+		else if (!strcmp(argv[i], "-update")) run.mode = GOLDEN_UPDATE;
+		else if (!strcmp(argv[i], "-write-reference") && i + 1 < argc) {
+			run.mode = GOLDEN_WRITE_REFERENCE;
+			run.out_dir = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-only") && i + 1 < argc) only = argv[++i];
+	}
+
+	// One reserved block: the framebuffer for the biggest resolution and the index for as many profiles
+	// as the in-memory profile file holds, and a transient arena that holds a frame's images (written,
+	// reference and diff) and the hash list files
+	size_t framebuffer_size = 1280 * 720 * sizeof(u32);
+	u32 golden_profile_capacity = (u32)((sizeof(golden_profiles) / PROFILE_PAGE_SIZE - 1) * PROFILE_RECORDS_PER_PAGE) + PROFILE_STORE_HEADROOM;
+	size_t permanent_size = framebuffer_size + 1024 * 1024 + get_profile_store_memory_size(golden_profile_capacity);
+	size_t transient_size = 16 * 1024 * 1024;
+	void* memory_block = os_reserve_memory(permanent_size + transient_size);
+	if (!memory_block) return 2;
+	init_game_memory(&game_memory, memory_block, permanent_size, transient_size);
+
+	static Golden_List golden, results;
+	run.golden = &golden;
+	run.results = &results;
+	if (run.mode == GOLDEN_CHECK && !read_golden_list(&golden, golden_path)) {
+		printf("could not read %s\n", golden_path);
+		return 2;
+	}
+	if (run.mode != GOLDEN_UPDATE) mkdir(run.out_dir, 0755);
+
+	const int resolution_count = (int)(sizeof(golden_resolutions) / sizeof(golden_resolutions[0]));
+	render_state.memory = push_size(&game_memory.permanent, framebuffer_size);
+	for (int r = 0; r < resolution_count; r++) {
+		render_state.width = golden_resolutions[r][0];
+		render_state.height = golden_resolutions[r][1];
+		for (int s = 0; s < (int)(sizeof(golden_scenarios) / sizeof(golden_scenarios[0])); s++) {
+			if (only && strcmp(only, golden_scenarios[s].name)) continue;
+			if (!run_scenario(&run, &golden_scenarios[s])) {
+				printf("could not write to %s\n", run.out_dir);
+				return 2;
+			}
+		}
+	}
+
+	if (run.mode == GOLDEN_UPDATE) {
+		if (!write_golden_list(&results, golden_path)) {
+			printf("could not write %s\n", golden_path);
+			return 2;
+		}
+		printf("wrote %d frame hashes to %s\n", results.count, golden_path);
+	}
+	if (run.mode == GOLDEN_CHECK) printf("\n%d scenario%s mismatched\n", run.mismatched_scenarios, run.mismatched_scenarios == 1 ? "" : "s");
+	return run.mismatched_scenarios ? 1 : 0;
+}
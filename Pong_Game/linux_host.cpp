@@ -0,0 +1,188 @@
+// Hot-reload host: a headless Linux platform layer that runs the game from the shared library built from
+// game_module.cpp and loads it again whenever it is rebuilt, keeping the match in progress.
+// Build: g++ -O2 -shared -fPIC -o libpong_game.so game_module.cpp
+//        g++ -O2 -o pong_host linux_host.cpp -ldl
+// Usage: (printf '\n\n'; sleep 60) | ./pong_host [-module path/libpong_game.so] [-w width] [-h height]
+// The module defaults to libpong_game.so next to the executable. On exit it prints how many reloads
+// there were and the slowest one, which has to stay under a frame.
+#include <dlfcn.h>
+#include <limits.h>
+#include <sys/inotify.h>
+#include "linux_os.cpp"
+#include "linux_input.cpp"
+#include "profile_store.cpp"                // Only to size the module's profile index
+
+#define MODULE_STATE_CAPACITY (4 * 1024 * 1024)
+
+struct Game_Module {
+	void* library;
+	Attach_Game* attach_game;
+	Detach_Game* detach_game;
+	Update_And_Render* update_and_render;
+};
+
+// The module is loaded from a private copy: dlopen() would hand back the already loaded library for
+// a path it has seen, and the linker can start rewriting the original while it is in use
+internal bool
+load_game_module(Game_Module* module, const char* path, int generation) {
+	char copy_path[64];
+	snprintf(copy_path, sizeof(copy_path), "/tmp/pong_game_%d_%d.so", (int)getpid(), generation);
+
+	int source = open(path, O_RDONLY);
+	if (source < 0) return false;
+	int copy = open(copy_path, O_WRONLY | O_CREAT | O_TRUNC, 0700);
+	bool copied = copy >= 0;
+	char buffer[64 * 1024];
+	for (ssize_t bytes; copied && (bytes = read(source, buffer, sizeof(buffer))) > 0;) {
+		copied = write(copy, buffer, bytes) == bytes;
+	}
+	close(source);
+	if (copy >= 0) close(copy);
+
+	Game_Module loaded = {};
+	if (copied) loaded.library = dlopen(copy_path, RTLD_NOW | RTLD_LOCAL);
+	unlink(copy_path);                  // Stays mapped until dlclose()
+	if (!loaded.library) {
+		printf("could not load %s: %s\n", path, copied ? dlerror() : "copy failed");
+		return false;
+	}
+
+	loaded.attach_game = (Attach_Game*)dlsym(loaded.library, "attach_game");
+	loaded.detach_game = (Detach_Game*)dlsym(loaded.library, "detach_game");
+	loaded.update_and_render = (Update_And_Render*)dlsym(loaded.library, "update_and_render");
+	if (!loaded.attach_game || !loaded.detach_game || !loaded.update_and_render) {
+		printf("%s is not a game module\n", path);
+		dlclose(loaded.library);
+		return false;
+	}
+	*module = loaded;
+	return true;
+}
+
+// Becomes true when the module file is closed after writing or renamed into place
+internal bool
+module_changed(int inotify_fd, const char* module_name) {
+	alignas(inotify_event) char events[4096];
+	bool changed = false;
+	for (ssize_t size; (size = read(inotify_fd, events, sizeof(events))) > 0;) {
+		for (char* at = events; at < events + size; at += sizeof(inotify_event) + ((inotify_event*)at)->len) {
+			inotify_event* event = (inotify_event*)at;
+			if (event->len && !strcmp(event->name, module_name)) changed = true;
+		}
+	}
+	return changed;
+}
+
+internal float
+seconds_since(u64 start) {
+	return (float)(os_get_time_counter() - start) / 1000000000.f;
+}
+
+// Entry Point for the hot-reload host
+int main(int argc, char** argv) {
+	int width = 1280, height = 720;
+	char module_path[PATH_MAX] = {};
+	ssize_t exe_length = readlink("/proc/self/exe", module_path, sizeof(module_path) - 32);
+	char* exe_slash = exe_length > 0 ? strrchr(module_path, '/') : 0;
+	if (exe_slash) strcpy(exe_slash + 1, "libpong_game.so");
+	else strcpy(module_path, "./libpong_game.so");
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-w") && i + 1 < argc) width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-h") && i + 1 < argc) height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-module") && i + 1 < argc) snprintf(module_path, sizeof(module_path), "%s", argv[++i]);
+	}
+
+	// Memory is all the host's: the framebuffer, the module's saved state and the game's profile index
+	// in the permanent arena, and the game's transient arena
+	size_t framebuffer_size = (size_t)width * height * sizeof(u32);
+	size_t permanent_size = framebuffer_size + MODULE_STATE_CAPACITY + 1024 * 1024 +
+		get_profile_store_memory_size(get_profile_store_capacity());
+	size_t transient_size = 1024 * 1024;
+	void* memory_block = os_reserve_memory(permanent_size + transient_size);
+	if (!memory_block) return 1;
+	init_game_memory(&game_memory, memory_block, permanent_size, transient_size);
+
+	Framebuffer framebuffer = { width, height, push_size(&game_memory.permanent, framebuffer_size) };
+	void* module_state = push_size(&game_memory.permanent, MODULE_STATE_CAPACITY);
+
+	Platform_Api platform = {};
+	platform.read_save_file = os_read_save_file;
+	platform.write_save_file = os_write_save_file;
+	platform.read_suspend_file = os_read_suspend_file;
+	platform.write_suspend_file = os_write_suspend_file;
+	platform.read_profile_file = os_read_profile_file;
+	platform.write_profile_file = os_write_profile_file;
+	platform.get_time_counter = os_get_time_counter;
+	platform.get_time_frequency = os_get_time_frequency;
+	platform.udp_open = os_udp_open;
+	platform.udp_close = os_udp_close;
+	platform.udp_send = os_udp_send;
+	platform.udp_receive = os_udp_receive;
+
+	// The directory is watched, a rebuild replaces the file rather than rewriting it
+	char module_directory[PATH_MAX];
+	const char* module_slash = strrchr(module_path, '/');
+	const char* module_name = module_slash ? module_slash + 1 : module_path;
+	snprintf(module_directory, sizeof(module_directory), "%.*s", module_slash ? (int)(module_slash - module_path) + 1 : 1, module_slash ? module_path : ".");
+	int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0 || inotify_add_watch(inotify_fd, module_directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		printf("cannot watch %s for rebuilds\n", module_directory);
+	}
+
+	Game_Module module;
+	int generation = 0;
+	if (!load_game_module(&module, module_path, generation++)) return 1;
+	module.attach_game(&platform, 0, 0);
+
+	Input input = {};
+	const float target_frame_time = 1.f / 60.f;
+	bool stdin_open = true;
+	int reload_count = 0;
+	float max_reload_ms = 0.f;
+	size_t state_size = 0;
+	u64 frame_begin_time = os_get_time_counter();
+
+	while (running) {
+		begin_frame_memory(&game_memory);
+
+		// ------------ (0) Reload -----------------------------
+		// The old module saves its state into host memory and is unloaded, the new one picks the state up
+		if (inotify_fd >= 0 && module_changed(inotify_fd, module_name)) {
+			u64 reload_begin = os_get_time_counter();
+			Game_Module new_module;
+			if (load_game_module(&new_module, module_path, generation++)) {
+				state_size = module.detach_game(module_state, MODULE_STATE_CAPACITY);
+				dlclose(module.library);
+				module = new_module;
+				int reset_count = module.attach_game(&platform, module_state, state_size);
+
+				float reload_ms = seconds_since(reload_begin) * 1000.f;
+				if (reload_ms > max_reload_ms) max_reload_ms = reload_ms;
+				reload_count++;
+				printf("reloaded %s in %.2fms, %zu KB of state", module_name, reload_ms, state_size / 1024);
+				if (reset_count) printf(", %d pieces changed layout and were reset", reset_count);
+				printf("%s\n", reload_ms > target_frame_time * 1000.f ? ", OVER A FRAME" : "");
+			}
+		}
+
+		// ------------ (1) Take Input -------------------------
+		bool release_pending = false;
+		for (int i = 0; i < BUTTON_COUNT; i++) {
+			release_pending |= release_next_frame[i];
+		}
+		if (!stdin_open && !pending_key_count && !release_pending) break;
+
+		int timeout_ms = (int)((target_frame_time - seconds_since(frame_begin_time)) * 1000.f);
+		wait_for_keys(&stdin_open, timeout_ms < 0 ? 0 : timeout_ms);
+		frame_begin_time = os_get_time_counter();
+		begin_headless_input_frame(&input);
+
+		// ------------ (2) Simulate and Render ----------------
+		if (!module.update_and_render(&game_memory, &input, target_frame_time, &framebuffer)) running = false;
+
+		end_frame_memory(&game_memory);
+	}
+
+	printf("reloads: %d, slowest %.2fms (a frame is %.2fms)\n", reload_count, max_reload_ms, target_frame_time * 1000.f);
+	return 0;
+}
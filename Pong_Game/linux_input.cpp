@@ -0,0 +1,111 @@
+// Key input for the headless Linux programs (linux_platform.cpp and linux_host.cpp): keys are read
+// from stdin, so a terminal or a piped script can play
+// ---------------- Headless Input ------------------------------
+// A terminal only reports key presses, so every key read from stdin is a tap:
+// down for one frame and released on the next one
+global_variable bool release_next_frame[BUTTON_COUNT];
+global_variable char pending_keys[256];
+global_variable u64 pending_key_times[256];     // When each byte was read, for the latency stats
+global_variable int pending_key_count;
+global_variable int key_wait_wake_fd = -1;      // An eventfd other threads write to end wait_for_keys() early
+
+// Decodes the next key in pending_keys, returns the number of bytes it used (0 if incomplete)
+internal int
+decode_key(const char* keys, int count, int* button) {
+	*button = -1;
+	if (keys[0] == 27) {                      // Arrow keys arrive as ESC [ A..D, a lone ESC is the escape key
+		if (count >= 3 && keys[1] == '[') {
+			switch (keys[2]) {
+				case 'A': *button = BUTTON_UP; break;
+				case 'B': *button = BUTTON_DOWN; break;
+				case 'C': *button = BUTTON_RIGHT; break;
+				case 'D': *button = BUTTON_LEFT; break;
+			}
+			return 3;
+		}
+		if (count >= 2 && keys[1] == '[') return 0;
+		*button = BUTTON_ESC;
+		return 1;
+	}
+
+	switch (keys[0]) {
+		case 'w': *button = BUTTON_W; break;
+		case 's': *button = BUTTON_S; break;
+		case 'a': *button = BUTTON_A; break;
+		case 'd': *button = BUTTON_D; break;
+		case 'p': *button = BUTTON_P; break;
+		case '\r':
+		case '\n': *button = BUTTON_ENTER; break;
+	}
+	return 1;
+}
+
+// Presses the button for the next queued key, one tap per frame so that a scripted key
+// never lands in the same frame as the mode change caused by the key before it.
+// A '.' in a script lets one frame pass without a key.
+internal void
+process_pending_keys(Input* input) {
+	int used = 0;
+	while (used < pending_key_count) {
+		if (pending_keys[used] == '.') {
+			used++;
+			break;
+		}
+
+		int button;
+		int length = decode_key(pending_keys + used, pending_key_count - used, &button);
+		if (!length) break;
+		if (button >= 0) {
+			if (input->buttons[button].half_transition_count) break;   // Released this frame, press it on the next one
+			process_button_transition(input, button, true, pending_key_times[used]);
+			release_next_frame[button] = true;
+			used += length;
+			break;
+		}
+		used += length;
+	}
+	memmove(pending_keys, pending_keys + used, pending_key_count - used);
+	memmove(pending_key_times, pending_key_times + used, (pending_key_count - used) * sizeof(u64));
+	pending_key_count -= used;
+}
+
+// Waits up to timeout_ms (-1 for no limit) for stdin or a write to key_wait_wake_fd and queues the keys
+// read, returns false if no keys arrived
+internal bool
+wait_for_keys(bool* stdin_open, int timeout_ms) {
+	// A full key buffer is left in stdin until the script has caught up
+	bool read_keys = *stdin_open && pending_key_count < (int)sizeof(pending_keys);
+	pollfd polls[2] = { { read_keys ? STDIN_FILENO : -1, POLLIN, 0 }, { key_wait_wake_fd, POLLIN, 0 } };
+	if (poll(polls, 2, timeout_ms) <= 0) return false;
+
+	// Reading the eventfd resets it, one that cannot be read is not waited on again
+	u64 wakes;
+	if (polls[1].revents && read(key_wait_wake_fd, &wakes, sizeof(wakes)) != sizeof(wakes)) key_wait_wake_fd = -1;
+	if (!polls[0].revents) return false;
+
+	int bytes = read(STDIN_FILENO, pending_keys + pending_key_count, sizeof(pending_keys) - pending_key_count);
+	if (bytes <= 0) *stdin_open = false;
+	else {
+		u64 read_time = os_get_time_counter();
+		for (int i = 0; i < bytes; i++) {
+			pending_key_times[pending_key_count + i] = read_time;
+		}
+		pending_key_count += bytes;
+	}
+	return true;
+}
+
+// Releases last frame's taps and presses the next queued key
+internal void
+begin_headless_input_frame(Input* input) {
+	// Taps are released by us, not by a key event, so the release is not timed as input
+	begin_input_frame(input);
+	for (int i = 0; i < BUTTON_COUNT; i++) {
+		if (release_next_frame[i]) {
+			release_next_frame[i] = false;
+			input->buttons[i].is_down = false;
+			input->buttons[i].half_transition_count++;
+		}
+	}
+	process_pending_keys(input);
+}
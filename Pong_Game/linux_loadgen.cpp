@@ -0,0 +1,270 @@
+// Load generator for pong_server: plays -players clients at once over UDP. Each joins, then every
+// tick sends an input that chases the ball in the newest state it decoded and acknowledges that state.
+// Build: g++ -O2 -o pong_loadgen linux_loadgen.cpp
+// Usage: ./pong_loadgen [-server host] [-port 47100] [-players 2000] [-seconds 10] [-sockets 32]
+// The players are spread over -sockets sockets, so the server sees several addresses. At the end it
+// prints what the players received and asks the server for its tick times and matches per core.
+// Exit code: 0, or 1 when a state failed to decode, a player got no seat without being refused one,
+//            or the server did not answer
+#include "linux_os.cpp"
+#include "game.cpp"
+#include "match_server.cpp"
+
+#define LOAD_MAX_PLAYERS (1 << 20)          // Player index is the low bits of its join nonce
+#define LOAD_MAX_SOCKETS 256
+#define LOAD_BATCH 64
+#define LOAD_MAX_PACKET 512
+
+struct Load_Player {
+	u32 nonce;
+	u32 match;                              // SERVER_FULL until seated
+	int player;
+	bool seated, refused;
+	Server_View view;
+	u64 states;
+};
+
+struct Load_Socket {
+	int fd;
+	int pending;
+	mmsghdr messages[LOAD_BATCH];
+	iovec vectors[LOAD_BATCH];
+	Server_Input packets[LOAD_BATCH];       // A join fits in an input's space
+};
+
+struct Load_Generator {
+	Load_Player* players;
+	int player_count;
+	int* seat_players;                      // Player index by 2 * match + player, -1 for none
+	Load_Socket* sockets;
+	int socket_count;
+	u32 salt;                               // High bits of every nonce, different for each run
+
+	u64 states, state_bytes, whole_states, decode_failures;
+	bool have_stats;
+	Server_Stats stats;
+};
+
+internal void
+flush_load_socket(Load_Socket* socket) {
+	for (int sent = 0; sent < socket->pending;) {
+		int count = sendmmsg(socket->fd, socket->messages + sent, socket->pending - sent, 0);
+		if (count <= 0) break;
+		sent += count;
+	}
+	socket->pending = 0;
+}
+
+internal void
+queue_load_packet(Load_Socket* socket, const void* packet, int size) {
+	memcpy(&socket->packets[socket->pending], packet, size);
+	socket->vectors[socket->pending] = { &socket->packets[socket->pending], (size_t)size };
+	socket->messages[socket->pending].msg_hdr = {};
+	socket->messages[socket->pending].msg_hdr.msg_iov = &socket->vectors[socket->pending];
+	socket->messages[socket->pending].msg_hdr.msg_iovlen = 1;
+	if (++socket->pending == LOAD_BATCH) flush_load_socket(socket);
+}
+
+// Up when the ball is above the paddle, down when below
+internal u8
+chase_ball(const Load_Player* player) {
+	const Match_Snapshot* snapshot = latest_server_snapshot(&player->view);
+	if (!snapshot) return 0;
+	int difference = snapshot->ball_py - snapshot->paddle_py[player->player];
+	return difference > 512 ? NET_UP : difference < -512 ? NET_DOWN : 0;
+}
+
+// Seated players send their input, the others their join a few times a second
+internal void
+send_load_packets(Load_Generator* load, u32 tick) {
+	for (int i = 0; i < load->player_count; i++) {
+		Load_Player* player = &load->players[i];
+		Load_Socket* socket = &load->sockets[i % load->socket_count];
+		if (player->seated) {
+			Server_Input input = { { SERVER_MAGIC, SERVER_INPUT, (u8)player->player, 0, player->match }, player->view.latest_tick, chase_ball(player) };
+			queue_load_packet(socket, &input, sizeof(input));
+		}
+		else if (!player->refused && (tick + i) % 15 == 0) {
+			Server_Join join = { { SERVER_MAGIC, SERVER_JOIN, 0, 0, 0 }, player->nonce };
+			queue_load_packet(socket, &join, sizeof(join));
+		}
+	}
+	for (int s = 0; s < load->socket_count; s++) flush_load_socket(&load->sockets[s]);
+}
+
+internal void
+handle_load_packet(Load_Generator* load, const u8* data, int size) {
+	Server_Header header;
+	if (size < (int)sizeof(header)) return;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != SERVER_MAGIC) return;
+
+	if (header.type == SERVER_WELCOME && size == (int)sizeof(Server_Welcome)) {
+		Server_Welcome welcome;
+		memcpy(&welcome, data, sizeof(welcome));
+		int index = welcome.nonce & (LOAD_MAX_PLAYERS - 1);
+		if ((welcome.nonce & ~(LOAD_MAX_PLAYERS - 1)) != load->salt || index >= load->player_count) return;
+		Load_Player* player = &load->players[index];
+		if (player->seated) return;
+		if (header.match == SERVER_FULL || header.match >= SERVER_MAX_MATCHES || header.player > 1) {
+			player->refused = true;
+			return;
+		}
+		player->seated = true;
+		player->match = header.match;
+		player->player = header.player;
+		load->seat_players[2 * header.match + header.player] = index;
+	}
+	else if (header.type == SERVER_STATE && header.match < SERVER_MAX_MATCHES && header.player <= 1) {
+		int index = load->seat_players[2 * header.match + header.player];
+		if (index < 0) return;
+		Server_State state;
+		memcpy(&state, data, size < (int)sizeof(state) ? size : sizeof(state));
+		Load_Player* player = &load->players[index];
+		load->states++;
+		load->state_bytes += size;
+		if (state.base_tick == SERVER_NO_BASE) load->whole_states++;
+		if (decode_server_state(&player->view, &state, size)) player->states++;
+		else load->decode_failures++;
+	}
+	else if (header.type == SERVER_STATS && size == (int)sizeof(Server_Stats)) {
+		memcpy(&load->stats, data, sizeof(load->stats));
+		load->have_stats = true;
+	}
+}
+
+internal void
+receive_load_packets(Load_Generator* load) {
+	static u8 buffers[LOAD_BATCH][LOAD_MAX_PACKET];
+	static iovec vectors[LOAD_BATCH];
+	static mmsghdr messages[LOAD_BATCH];
+	for (int s = 0; s < load->socket_count; s++) {
+		for (;;) {
+			for (int i = 0; i < LOAD_BATCH; i++) {
+				vectors[i] = { buffers[i], LOAD_MAX_PACKET };
+				messages[i].msg_hdr = {};
+				messages[i].msg_hdr.msg_iov = &vectors[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+			int count = recvmmsg(load->sockets[s].fd, messages, LOAD_BATCH, MSG_DONTWAIT, 0);
+			if (count <= 0) break;
+			for (int i = 0; i < count; i++) handle_load_packet(load, buffers[i], (int)messages[i].msg_len);
+			if (count < LOAD_BATCH) break;
+		}
+	}
+}
+
+internal bool
+open_load_sockets(Load_Generator* load, const char* host, u16 port) {
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	char port_text[8];
+	snprintf(port_text, sizeof(port_text), "%u", port);
+	addrinfo* server = 0;
+	if (getaddrinfo(host, port_text, &hints, &server)) return false;
+
+	bool opened = true;
+	for (int s = 0; s < load->socket_count && opened; s++) {
+		int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		int buffer_size = 4 * 1024 * 1024;
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+		opened = fd >= 0 && connect(fd, server->ai_addr, server->ai_addrlen) == 0;
+		load->sockets[s] = {};
+		load->sockets[s].fd = fd;
+	}
+	freeaddrinfo(server);
+	return opened;
+}
+
+internal void
+sleep_until(u64 time) {
+	u64 now = os_get_time_counter();
+	if (now >= time) return;
+	timespec ts = { (time_t)((time - now) / 1000000000ull), (long)((time - now) % 1000000000ull) };
+	nanosleep(&ts, 0);
+}
+
+int main(int argc, char** argv) {
+	const char* host = "127.0.0.1";
+	u16 port = 47100;
+	int player_count = 2000;
+	int socket_count = 32;
+	float seconds = 10.f;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-server") && i + 1 < argc) host = argv[++i];
+		else if (!strcmp(argv[i], "-port") && i + 1 < argc) port = (u16)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-players") && i + 1 < argc) player_count = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-sockets") && i + 1 < argc) socket_count = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seconds") && i + 1 < argc) seconds = (float)atof(argv[++i]);
+	}
+	player_count = clamp(1, player_count, LOAD_MAX_PLAYERS - 1);
+	socket_count = clamp(1, socket_count, LOAD_MAX_SOCKETS);
+
+	size_t permanent_size = player_count * sizeof(Load_Player) + 2 * SERVER_MAX_MATCHES * sizeof(int) + socket_count * sizeof(Load_Socket) + 1024 * 1024;
+	void* memory_block = os_reserve_memory(permanent_size);
+	if (!memory_block) return 1;
+	init_game_memory(&game_memory, memory_block, permanent_size, 0);
+	static Load_Generator load;
+	load.player_count = player_count;
+	load.socket_count = socket_count;
+	load.players = push_array(&game_memory.permanent, Load_Player, player_count);
+	load.seat_players = push_array(&game_memory.permanent, int, 2 * SERVER_MAX_MATCHES);
+	load.sockets = push_array(&game_memory.permanent, Load_Socket, socket_count);
+	load.salt = (u32)os_get_time_counter() & ~(u32)(LOAD_MAX_PLAYERS - 1);
+	for (int i = 0; i < 2 * SERVER_MAX_MATCHES; i++) load.seat_players[i] = -1;
+	for (int i = 0; i < player_count; i++) {
+		load.players[i] = {};
+		load.players[i].nonce = load.salt | (u32)i;
+		load.players[i].match = SERVER_FULL;
+		init_server_view(&load.players[i].view);
+	}
+	if (!open_load_sockets(&load, host, port)) {
+		printf("could not reach %s:%u\n", host, port);
+		return 1;
+	}
+
+	// Players tick at the server's rate, a tick's inputs go out in batches of sendmmsg
+	u64 tick_time = (u64)(netplay_dt * os_get_time_frequency());
+	u64 start_time = os_get_time_counter();
+	u64 end_time = start_time + (u64)(seconds * os_get_time_frequency());
+	u64 next_tick = start_time;
+	for (u32 tick = 0; os_get_time_counter() < end_time; tick++) {
+		receive_load_packets(&load);
+		send_load_packets(&load, tick);
+		next_tick += tick_time;
+		sleep_until(next_tick);
+	}
+	double run_seconds = (double)(os_get_time_counter() - start_time) / os_get_time_frequency();
+
+	// The players stop, so the server's stats cover the run and nothing after it
+	Server_Header request = { SERVER_MAGIC, SERVER_STATS_REQUEST, 0, 0, 0 };
+	u64 stats_deadline = os_get_time_counter() + os_get_time_frequency();
+	for (u64 next_request = 0; !load.have_stats && os_get_time_counter() < stats_deadline;) {
+		if (os_get_time_counter() >= next_request) {
+			send(load.sockets[0].fd, &request, sizeof(request), 0);
+			next_request = os_get_time_counter() + os_get_time_frequency() / 10;
+		}
+		receive_load_packets(&load);
+		usleep(1000);
+	}
+
+	int seated = 0, refused = 0;
+	u64 states_decoded = 0;
+	for (int i = 0; i < player_count; i++) {
+		seated += load.players[i].seated;
+		refused += load.players[i].refused;
+		states_decoded += load.players[i].states;
+	}
+	printf("players: %d seated, %d refused, %d without an answer, of %d\n", seated, refused, player_count - seated - refused, player_count);
+	printf("states: %llu received (%.1f per seated player per second), %.1f bytes each, %.1f%% sent whole, %llu failed to decode\n",
+		load.states, seated ? states_decoded / run_seconds / seated : 0.0, load.states ? (double)load.state_bytes / load.states : 0.0,
+		load.states ? 100.0 * load.whole_states / load.states : 0.0, load.decode_failures);
+	if (load.have_stats) {
+		char report[512];
+		format_server_stats(&load.stats, report, sizeof(report));
+		printf("%s\n", report);
+	}
+	else printf("the server did not answer the stats request\n");
+	return load.decode_failures || seated + refused < player_count || !load.have_stats ? 1 : 0;
+}
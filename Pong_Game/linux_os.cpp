@@ -0,0 +1,332 @@
+// Linux side of the platform layer: framebuffer, files, time and sockets, shared by the headless
+// game (linux_platform.cpp) and the benchmark suite (linux_bench.cpp)
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "utils.cpp"
+
+struct Render_State {
+	int width, height;
+	void* memory;
+};
+
+global_variable bool running = true;
+global_variable Render_State render_state;
+
+#include "renderer.cpp"
+#include "platform_common.cpp"
+#include "input_latency.cpp"
+
+// ------------ OS Helper Functions ----------------------------
+#include <cassert>
+
+// The one block of memory the program runs in, see init_game_memory()
+internal void*
+os_reserve_memory(size_t size) {
+	os_allocation_count++;
+	void* block = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return block == MAP_FAILED ? 0 : block;
+}
+
+// Reads into the given arena, with a 0 after the data so text files can be used as strings
+internal String
+os_read_entire_file(Memory_Arena* arena, const char* file_path) {
+	String result = { 0 };
+
+	int fd = open(file_path, O_RDONLY);
+	if (fd < 0) return result;
+
+	off_t file_size = lseek(fd, 0, SEEK_END);
+	lseek(fd, 0, SEEK_SET);
+	char* data = (char*)push_size(arena, (size_t)file_size + 1);
+	if (data && read(fd, data, file_size) == (ssize_t)file_size) {
+		data[file_size] = 0;
+		result.data = data;
+		result.size = (unsigned int)file_size;
+	}
+
+	close(fd);
+	return result;
+}
+
+internal String
+os_read_save_file(Memory_Arena* arena) {
+	return os_read_entire_file(arena, "save.pongsav");
+}
+
+internal int
+os_write_entire_file(const char* file_path, String data) {
+	int fd = open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		assert(0);
+		return false;
+	}
+
+	int result = write(fd, data.data, data.size) == (ssize_t)data.size;
+	close(fd);
+	return result;
+}
+
+internal int
+os_write_save_file(String data) {
+	return os_write_entire_file("save.pongsav", data);
+}
+
+// The suspended match file is only used when a path is set (pong_linux -suspend), so scripted runs
+// do not resume each other's matches. It stays open and is overwritten in place: one system call
+// for a few hundred bytes, safe in a signal handler, and a torn write fails the file's checksum.
+global_variable char suspend_file_path[256];
+global_variable int suspend_file = -1;
+
+internal void
+os_set_suspend_file(const char* path) {
+	snprintf(suspend_file_path, sizeof(suspend_file_path), "%s", path);
+}
+
+internal String
+os_read_suspend_file(Memory_Arena* arena) {
+	String result = { 0 };
+	if (!suspend_file_path[0]) return result;
+	return os_read_entire_file(arena, suspend_file_path);
+}
+
+internal int
+os_write_suspend_file(String data) {
+	if (!suspend_file_path[0]) return false;
+	if (suspend_file < 0) suspend_file = open(suspend_file_path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+	if (suspend_file < 0) return false;
+	return pwrite(suspend_file, data.data, data.size, 0) == (ssize_t)data.size && ftruncate(suspend_file, data.size) == 0;
+}
+
+// The profile store's paged file, also only used when a path is set (pong_linux -profiles). It stays
+// open: pages are read and records rewritten in place at their offsets.
+global_variable char profile_file_path[256];
+global_variable int profile_file = -1;
+
+internal void
+os_set_profile_file(const char* path) {
+	if (profile_file >= 0) close(profile_file);
+	profile_file = -1;
+	snprintf(profile_file_path, sizeof(profile_file_path), "%s", path);
+}
+
+internal bool
+open_profile_file() {
+	if (profile_file < 0 && profile_file_path[0]) profile_file = open(profile_file_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	return profile_file >= 0;
+}
+
+// Bytes read, fewer than size past the end of the file
+internal int
+os_read_profile_file(void* buffer, u64 offset, u32 size) {
+	if (!open_profile_file()) return 0;
+	ssize_t bytes_read = pread(profile_file, buffer, size, (off_t)offset);
+	return bytes_read < 0 ? 0 : (int)bytes_read;
+}
+
+internal int
+os_write_profile_file(const void* data, u64 offset, u32 size) {
+	if (!open_profile_file()) return false;
+	return pwrite(profile_file, data, size, (off_t)offset) == (ssize_t)size;
+}
+
+// Monotonic time stamp in nanoseconds, used by the game to seed its randomness
+internal u64
+os_get_time_counter() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+// Counts per second of os_get_time_counter()
+internal u64
+os_get_time_frequency() {
+	return 1000000000ull;
+}
+
+// UDP socket connected to a single remote peer, non-blocking
+global_variable int udp_socket = -1;
+
+internal bool
+os_udp_open(u16 local_port, const char* remote_host, u16 remote_port) {
+	udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (udp_socket < 0) return false;
+
+	sockaddr_in local = {};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(local_port);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	char port[8];
+	snprintf(port, sizeof(port), "%u", remote_port);
+
+	addrinfo* remote = 0;
+	if (bind(udp_socket, (sockaddr*)&local, sizeof(local)) < 0 || getaddrinfo(remote_host, port, &hints, &remote)) {
+		close(udp_socket);
+		udp_socket = -1;
+		return false;
+	}
+	int connected = connect(udp_socket, remote->ai_addr, remote->ai_addrlen);
+	freeaddrinfo(remote);
+	fcntl(udp_socket, F_SETFL, O_NONBLOCK);
+	return connected == 0;
+}
+
+internal void
+os_udp_close() {
+	if (udp_socket >= 0) close(udp_socket);
+	udp_socket = -1;
+}
+
+internal void
+os_udp_send(const void* data, int size) {
+	send(udp_socket, data, size, 0);
+}
+
+// Returns the size of the datagram read, or -1 when there is none
+internal int
+os_udp_receive(void* buffer, int max_size) {
+	return (int)recv(udp_socket, buffer, max_size, 0);
+}
+
+// Named shared memory other processes can map, for the spectator feed. Creating replaces any block of
+// the same name: readers still mapping the old one keep it until they let go.
+#include <sys/stat.h>
+
+internal void*
+os_create_shared_memory(const char* name, size_t size) {
+	os_allocation_count++;
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0) return 0;
+	void* block = ftruncate(fd, size) == 0 ? mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (block == MAP_FAILED) shm_unlink(name);
+	return block == MAP_FAILED ? 0 : block;
+}
+
+// Read-only, so a reader cannot disturb the process that writes the block
+internal const void*
+os_open_shared_memory(const char* name, size_t* size) {
+	int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) return 0;
+	struct stat info;
+	void* block = fstat(fd, &info) == 0 && info.st_size > 0 ? mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (block == MAP_FAILED) return 0;
+	*size = info.st_size;
+	return block;
+}
+
+internal void
+os_close_shared_memory(const void* block, size_t size) {
+	munmap((void*)block, size);
+}
+
+internal void
+os_remove_shared_memory(const char* name) {
+	shm_unlink(name);
+}
+
+// ------------ Render Workers ---------------------------------
+// Threads that draw bands of rows alongside the calling thread (see run_row_bands in renderer.cpp).
+// A frame is cut into a few more bands than there are threads and each thread takes the next band
+// left, so one that gets descheduled holds up a small band rather than a whole share of the frame.
+#include <atomic>
+#include <pthread.h>
+#include <semaphore.h>
+
+#define RENDER_WORKERS_MAX 15
+#define RENDER_BANDS_PER_THREAD 4
+
+struct Render_Workers {
+	pthread_t threads[RENDER_WORKERS_MAX];
+	int count;
+	sem_t start;                            // Posted once per worker for each job
+	sem_t done;                             // Posted by each worker once no band is left
+	Draw_Rows* draw_rows;
+	void* data;
+	int height;
+	int band_count;
+	std::atomic<int> next_band;
+	std::atomic<bool> running;
+};
+
+global_variable Render_Workers render_workers;
+
+internal void
+draw_next_bands(Render_Workers* workers) {
+	for (;;) {
+		int band = workers->next_band.fetch_add(1, std::memory_order_relaxed);
+		if (band >= workers->band_count) return;
+		int y_begin = (int)((s64)workers->height * band / workers->band_count);
+		int y_end = (int)((s64)workers->height * (band + 1) / workers->band_count);
+		workers->draw_rows(workers->data, y_begin, y_end);
+	}
+}
+
+internal void*
+render_worker_thread(void* param) {
+	Render_Workers* workers = (Render_Workers*)param;
+	for (;;) {
+		sem_wait(&workers->start);
+		if (!workers->running.load(std::memory_order_relaxed)) return 0;
+		draw_next_bands(workers);
+		sem_post(&workers->done);
+	}
+}
+
+// The semaphores order the job's fields before the workers read them and the rows before the return
+internal void
+run_bands_on_render_workers(Draw_Rows* draw_rows, void* data, int height) {
+	Render_Workers* workers = &render_workers;
+	int band_count = (workers->count + 1) * RENDER_BANDS_PER_THREAD;
+	workers->draw_rows = draw_rows;
+	workers->data = data;
+	workers->height = height;
+	workers->band_count = band_count < height ? band_count : height;
+	workers->next_band.store(0, std::memory_order_relaxed);
+	for (int i = 0; i < workers->count; i++) sem_post(&workers->start);
+	draw_next_bands(workers);
+	for (int i = 0; i < workers->count; i++) sem_wait(&workers->done);
+}
+
+// count threads besides the caller, or one per other online processor when count is negative.
+// Returns how many started, with none the caller keeps drawing every row itself.
+internal int
+start_render_workers(int count) {
+	if (count < 0) count = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+	if (count > RENDER_WORKERS_MAX) count = RENDER_WORKERS_MAX;
+	if (count <= 0) return 0;
+	if (sem_init(&render_workers.start, 0, 0) || sem_init(&render_workers.done, 0, 0)) return 0;
+
+	render_workers.running.store(true, std::memory_order_relaxed);
+	while (render_workers.count < count &&
+		   !pthread_create(&render_workers.threads[render_workers.count], 0, render_worker_thread, &render_workers)) {
+		render_workers.count++;
+	}
+	if (render_workers.count) run_row_bands = run_bands_on_render_workers;
+	return render_workers.count;
+}
+
+internal void
+stop_render_workers() {
+	run_row_bands = 0;
+	render_workers.running.store(false, std::memory_order_relaxed);
+	for (int i = 0; i < render_workers.count; i++) sem_post(&render_workers.start);
+	for (int i = 0; i < render_workers.count; i++) pthread_join(render_workers.threads[i], 0);
+	render_workers.count = 0;
+}
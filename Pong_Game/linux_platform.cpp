@@ -0,0 +1,846 @@
+// Headless Linux platform layer: renders into an in-memory framebuffer and reads keys from stdin
+// Build: g++ -O2 -pthread -o pong_linux linux_platform.cpp
+// Usage: (printf '\n\np'; sleep 10) | ./pong_linux [-w width] [-h height] [-input-latency histogram.csv] [-unpaced]
+//        (add -tuning file to read gameplay constants from somewhere other than tuning.txt,
+//        -suspend file to keep an unfinished match in the file and resume it on the next run,
+//        -profiles file to keep the players' profiles for the leaderboard in the file,
+//        -spectate name [-spectate-frames] to publish the match in shared memory for pong_spectator,
+//        -sound file.wav | null to mix the match's sounds into a WAV file or nowhere,
+//        -pipeline to present from a thread of its own, -present-ms n to give each present a cost)
+//        ./pong_linux -bench-stress
+//        ./pong_linux -spectator-test [-w width] [-h height]
+//        ./pong_linux -net <local port> <remote host> <remote port> <player 0|1> [-delay n] [-rollback n] [-seed n]
+//        ./pong_linux -net-test [-frames n] [-delay n] [-rollback n] [-latency ms] [-jitter ms] [-loss percent]
+#include "linux_os.cpp"
+#include "game.cpp"
+#include "linux_input.cpp"
+
+internal float
+seconds_since(u64 start) {
+	return (float)(os_get_time_counter() - start) / 1000000000.f;
+}
+
+// ---------------- Stress Benchmark ----------------------------
+// Runs the multi-ball stress mode at growing ball counts and reports how the broadphase scales
+internal void
+run_stress_benchmark() {
+	const int warmup_ticks = 60, measured_ticks = 600;
+	const float dt = 1.f / 60.f;
+	init_match(&game_state);
+
+	printf("%8s %8s %14s %14s\n", "balls", "collide", "pairs/tick", "ns/ball/tick");
+	for (int collide = 0; collide < 2; collide++) {
+		for (int count = MIN_STRESS_BALLS; count <= MAX_STRESS_BALLS; count *= 2) {
+			init_stress_mode(&stress_state, count);
+			stress_state.balls_collide = collide;
+			for (int t = 0; t < warmup_ticks; t++) {
+				simulate_stress_mode(&stress_state, &game_state.paddles, &game_state.paddle_traits, dt);
+			}
+
+			u64 pairs = 0;
+			u64 begin = os_get_time_counter();
+			for (int t = 0; t < measured_ticks; t++) {
+				simulate_stress_mode(&stress_state, &game_state.paddles, &game_state.paddle_traits, dt);
+				pairs += stress_state.pairs_tested;
+			}
+			float ns = (float)(os_get_time_counter() - begin) / measured_ticks / count;
+
+			printf("%8d %8s %14llu %14.2f\n", count, collide ? "yes" : "no", pairs / measured_ticks, ns);
+		}
+	}
+}
+
+// ---------------- Netplay Loopback Test ------------------------
+// Scripted paddle movement so both peers know what the other one "pressed" without a keyboard
+internal u8
+netplay_bot_input(s32 frame, int player) {
+	int phase = (frame / (23 + 17 * player)) % 4;
+	if (phase == 0) return NET_UP;
+	if (phase == 2) return NET_DOWN;
+	if (phase == 3 && player) return NET_LEFT;
+	return 0;
+}
+
+internal void
+sleep_until(u64 time) {
+	u64 now = os_get_time_counter();
+	if (now >= time) return;
+	timespec ts = { (time_t)((time - now) / 1000000000ull), (long)((time - now) % 1000000000ull) };
+	nanosleep(&ts, 0);
+}
+
+internal void
+print_netplay_report(Netplay_Session* session) {
+	float ms_per_count = 1000.f / (float)os_get_time_frequency();
+	u64 rollbacks = session->rollbacks ? session->rollbacks : 1;
+	printf("player %d: frames %d, rollbacks %llu, frames re-simulated %llu (%.2f per rollback, max %d)\n",
+		session->config.local_player, session->current_frame, session->rollbacks, session->frames_resimulated,
+		(float)session->frames_resimulated / rollbacks, session->max_rollback_frames);
+	printf("player %d: re-simulation %.1fus per rollback, %.1fus max, %.3fus per frame\n",
+		session->config.local_player, 1000.f * ms_per_count * session->resimulation_time / rollbacks,
+		1000.f * ms_per_count * session->max_rollback_time,
+		session->frames_resimulated ? 1000.f * ms_per_count * session->resimulation_time / session->frames_resimulated : 0.f);
+	printf("player %d: stalled ticks %llu, packets sent %llu (dropped %llu), received %llu, rtt %.1fms\n",
+		session->config.local_player, session->stalled_ticks, session->packets_sent, session->packets_dropped,
+		session->packets_received, session->rtt_ms);
+}
+
+// Plays frames ticks against the remote peer in real time, then keeps the connection serviced
+// until the remote has everything. Returns the checksum of the final state, 0 on failure.
+internal u64
+run_netplay_peer(Netplay_Config config, s32 frames) {
+	if (!start_netplay(&netplay_session, &game_state, config)) {
+		printf("player %d: could not open port %u\n", config.local_player, config.local_port);
+		return 0;
+	}
+
+	u64 tick_time = (u64)(os_get_time_frequency() * netplay_dt);
+	u64 next_tick = os_get_time_counter();
+	u64 give_up = next_tick + os_get_time_frequency() * (10 + frames / 30);
+	u64 linger_until = 0;
+	for (;;) {
+		u64 now = os_get_time_counter();
+		if (now > give_up) {
+			printf("player %d: timed out at frame %d, confirmed %d\n", config.local_player,
+				netplay_session.current_frame, netplay_session.remote_confirmed_frame);
+			stop_netplay(&netplay_session);
+			return 0;
+		}
+
+		bool advance = netplay_session.current_frame < frames;
+		netplay_tick(&netplay_session, &game_state, netplay_bot_input(netplay_session.current_frame + config.input_delay, config.local_player), advance);
+
+		// Done once every input is confirmed here, after a short linger so the remote gets our last acks
+		if (!advance && netplay_is_confirmed(&netplay_session)) {
+			if (!linger_until) linger_until = now + os_get_time_frequency() / 2;
+			else if (now >= linger_until) break;
+		}
+
+		next_tick += tick_time;
+		sleep_until(next_tick);
+	}
+
+	u64 checksum = checksum_game_state(&game_state);
+	print_netplay_report(&netplay_session);
+	stop_netplay(&netplay_session);
+	return checksum;
+}
+
+// Forks two peers on localhost that play the same match over a lossy, jittery link, and
+// checks that they end up with the same game state
+internal int
+run_netplay_test(Netplay_Config config, s32 frames) {
+	const u16 ports[2] = { 47001, 47002 };
+	int pipes[2][2];
+	pid_t children[2];
+
+	printf("netplay test: %d frames, delay %d, window %d, latency %dms, jitter %dms, loss %d%%\n",
+		frames, config.input_delay, config.max_rollback, config.latency_ms, config.jitter_ms, config.loss_percent);
+	fflush(stdout);
+
+	for (int player = 0; player < 2; player++) {
+		pipe(pipes[player]);
+		children[player] = fork();
+		if (children[player] == 0) {
+			config.local_player = player;
+			config.local_port = ports[player];
+			config.remote_host = "127.0.0.1";
+			config.remote_port = ports[1 - player];
+			u64 checksum = run_netplay_peer(config, frames);
+			write(pipes[player][1], &checksum, sizeof(checksum));
+			fflush(stdout);
+			_exit(0);
+		}
+		close(pipes[player][1]);
+	}
+
+	u64 checksums[2] = {};
+	for (int player = 0; player < 2; player++) {
+		read(pipes[player][0], &checksums[player], sizeof(checksums[player]));
+		close(pipes[player][0]);
+		waitpid(children[player], 0, 0);
+	}
+
+	bool in_sync = checksums[0] && checksums[0] == checksums[1];
+	printf("checksums %016llx %016llx: %s\n", checksums[0], checksums[1], in_sync ? "in sync" : "DESYNC");
+	return in_sync ? 0 : 1;
+}
+
+// ---------------- Live Tuning ---------------------------------
+// The directory is watched rather than the file, since editors usually save by writing a new
+// file and renaming it over the old one. Reads and parses happen on the watcher thread, into
+// an arena of its own, and reach the game through the mailbox in tuning.cpp.
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#define TUNING_FILE_MAX_SIZE (64 * 1024)
+
+struct Tuning_Watch {
+	const char* path;
+	const char* file_name;
+	Memory_Arena arena;
+	int inotify_fd;
+	Tuning_Values values;
+};
+
+global_variable Tuning_Watch tuning_watch;
+
+internal bool
+read_tuning_file(Tuning_Watch* watch) {
+	watch->arena.used = 0;
+	String file = os_read_entire_file(&watch->arena, watch->path);
+	if (!file.data) return false;
+	parse_tuning(&watch->values, file.data);
+	if (watch->values.error_line) printf("%s:%d: not a tuning value\n", watch->path, watch->values.error_line);
+	return true;
+}
+
+internal void*
+tuning_watch_thread(void* param) {
+	Tuning_Watch* watch = (Tuning_Watch*)param;
+	alignas(inotify_event) char events[4096];
+	for (;;) {
+		ssize_t size = read(watch->inotify_fd, events, sizeof(events));
+		if (size <= 0) return 0;
+
+		bool changed = false;
+		for (char* at = events; at < events + size; at += sizeof(inotify_event) + ((inotify_event*)at)->len) {
+			inotify_event* event = (inotify_event*)at;
+			if (event->len && !strcmp(event->name, watch->file_name)) changed = true;
+		}
+		if (changed && read_tuning_file(watch)) {
+			publish_tuning(&watch->values);
+			printf("tuning: reloaded %s, %d values\n", watch->path, watch->values.present_count);
+
+			// A settled screen is waiting on stdin, wake it to apply the values
+			u64 wake = 1;
+			write(key_wait_wake_fd, &wake, sizeof(wake));
+		}
+	}
+}
+
+// Applies the file right away if there is one, then reloads it on every change
+internal void
+start_tuning_watch(Tuning_Watch* watch, const char* path) {
+	watch->path = path;
+	const char* slash = strrchr(path, '/');
+	watch->file_name = slash ? slash + 1 : path;
+	watch->arena.base = (u8*)push_size(&game_memory.permanent, TUNING_FILE_MAX_SIZE);
+	watch->arena.size = watch->arena.base ? TUNING_FILE_MAX_SIZE : 0;
+
+	// Watching starts before the first read so that no change can slip in between
+	char directory[256];
+	snprintf(directory, sizeof(directory), "%.*s", slash ? (int)(slash - path) + 1 : 1, slash ? path : ".");
+	watch->inotify_fd = inotify_init1(IN_CLOEXEC);
+	bool watching = watch->inotify_fd >= 0 && inotify_add_watch(watch->inotify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) >= 0;
+	key_wait_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	if (read_tuning_file(watch)) apply_tuning(&watch->values);
+
+	pthread_t thread;
+	if (!watching || pthread_create(&thread, 0, tuning_watch_thread, watch)) {
+		printf("tuning: cannot watch %s, changes need a restart\n", path);
+		return;
+	}
+	pthread_detach(thread);
+}
+
+// ---------------- Sound ---------------------------------------
+// There is no audio device headless: -sound file.wav mixes the match's sounds into a WAV file and
+// -sound null mixes them and throws them away. Neither sink has a clock, so the mixer thread keeps
+// one the way a device would: a block is due every SOUND_BLOCK_FRAMES samples, and one that is
+// finished after it was due is counted as an underrun.
+struct Sound_Output {
+	Sound_Mixer mixer;
+	Sound_Sink sink;
+	pthread_t thread;
+	std::atomic<bool> running;
+};
+
+global_variable Sound_Output sound_output;
+
+internal void*
+sound_mixer_thread(void* param) {
+	Sound_Output* output = (Sound_Output*)param;
+	s16 samples[SOUND_BLOCK_FRAMES * 2];
+	u64 block_time = os_get_time_frequency() * SOUND_BLOCK_FRAMES / SOUND_SAMPLE_RATE;
+	u64 due = os_get_time_counter() + block_time;
+	while (output->running.load(std::memory_order_relaxed)) {
+		// Not mixed before the block ahead of it is playing, which bounds how long an event waits
+		sleep_until(due - block_time);
+		mix_sound_block(&output->mixer, samples);
+		output->sink.write(&output->sink, samples, SOUND_BLOCK_FRAMES);
+
+		u64 now = os_get_time_counter();
+		if (now > due) {
+			output->mixer.underruns++;
+			due = now;
+		}
+		due += block_time;
+	}
+	return 0;
+}
+
+internal bool
+start_sound_output(Sound_Output* output, const char* sink_name) {
+	if (!strcmp(sink_name, "null")) output->sink = make_null_sound_sink();
+	else if (!make_wav_sound_sink(&output->sink, sink_name)) return false;
+
+	init_sound_mixer(&output->mixer, &game_memory.permanent);
+	output->running.store(true, std::memory_order_relaxed);
+	if (pthread_create(&output->thread, 0, sound_mixer_thread, output)) {
+		output->sink.close(&output->sink);
+		return false;
+	}
+	sound_enabled = true;
+	return true;
+}
+
+// Waits for the block being mixed, then finishes the sink (the WAV header gets its sizes)
+internal void
+stop_sound_output(Sound_Output* output) {
+	sound_enabled = false;
+	output->running.store(false, std::memory_order_relaxed);
+	pthread_join(output->thread, 0);
+	output->sink.close(&output->sink);
+}
+
+// ---------------- Present Pipeline ----------------------------
+// There is no screen headless, so a present costs nothing unless -present-ms stands in for a slow
+// display. -pipeline moves presents to a thread of their own with three framebuffers (see
+// present_pipeline.cpp), woken by a semaphore the game posts to and never waits on.
+#include <semaphore.h>
+#include "present_pipeline.cpp"
+
+struct Headless_Presenter {
+	bool pipelined;
+	int present_ms;
+	Present_Pipeline pipeline;
+	Present_Stats serial_stats;
+	sem_t wake;
+	pthread_t thread;
+	std::atomic<bool> running;
+};
+
+global_variable Headless_Presenter headless_presenter;
+
+internal void
+present_headless(Headless_Presenter* presenter) {
+	if (presenter->present_ms > 0) sleep_until(os_get_time_counter() + (u64)presenter->present_ms * os_get_time_frequency() / 1000);
+}
+
+internal void*
+present_thread(void* param) {
+	Headless_Presenter* presenter = (Headless_Presenter*)param;
+	while (presenter->running.load(std::memory_order_relaxed)) {
+		sem_wait(&presenter->wake);
+		Present_Frame* frame = take_present_frame(&presenter->pipeline);
+		if (!frame) continue;
+		u64 begin = os_get_time_counter();
+		present_headless(presenter);
+		u64 end = os_get_time_counter();
+		record_present(&presenter->pipeline.stats, frame->drawn_time, begin, end);
+		record_input_latency(&input_latency, frame->event_times, frame->event_count, end, os_get_time_frequency());
+	}
+	return 0;
+}
+
+// The game keeps drawing into render_state.memory, which becomes the first of the three buffers
+internal bool
+start_present_pipeline(Headless_Presenter* presenter, size_t framebuffer_size) {
+	if (!init_present_pipeline(&presenter->pipeline, render_state.memory, &game_memory.permanent, framebuffer_size)) return false;
+	if (sem_init(&presenter->wake, 0, 0)) return false;
+	presenter->running.store(true, std::memory_order_relaxed);
+	if (pthread_create(&presenter->thread, 0, present_thread, presenter)) return false;
+	presenter->pipelined = true;
+	return true;
+}
+
+internal void
+stop_present_pipeline(Headless_Presenter* presenter) {
+	presenter->running.store(false, std::memory_order_relaxed);
+	sem_post(&presenter->wake);
+	pthread_join(presenter->thread, 0);
+	sem_destroy(&presenter->wake);
+}
+
+// After every frame that changed the screen, input latency is recorded once the present returns
+internal void
+present_frame(Headless_Presenter* presenter, const Input* input) {
+	if (presenter->pipelined) {
+		render_state.memory = publish_present_frame(&presenter->pipeline, render_state.width, render_state.height, input);
+		sem_post(&presenter->wake);
+		return;
+	}
+	u64 begin = os_get_time_counter();
+	present_headless(presenter);
+	u64 end = os_get_time_counter();
+	record_present(&presenter->serial_stats, begin, begin, end);
+	record_input_latency(&input_latency, input->event_times, input->event_count, end, os_get_time_frequency());
+}
+
+// ---------------- Spectator Feed ------------------------------
+// -spectate name publishes every simulated tick to other processes through shared memory (see
+// spectator_feed.cpp and the sample reader in linux_spectator.cpp), -spectate-frames every presented
+// frame as well. The time it takes is measured, the game must not notice its viewers.
+#include "spectator_feed.cpp"
+
+static_assert(MAX_PADDLES <= SPECTATOR_MAX_PADDLES && MAX_BALLS <= SPECTATOR_MAX_BALLS, "the feed carries every paddle and ball");
+
+struct Spectator_Publisher {
+	const char* name;
+	Spectator_Header* header;
+	size_t size;
+	bool frames;
+	u64 total_time;                     // os_get_time_counter() units, ticks and frames together
+	u64 max_time;
+};
+
+global_variable Spectator_Publisher spectator_publisher;
+
+internal bool
+start_spectator_feed(Spectator_Publisher* publisher, const char* name, bool frames) {
+	int frame_width = frames ? render_state.width : 0;
+	int frame_height = frames ? render_state.height : 0;
+	publisher->name = name;
+	publisher->frames = frames;
+	publisher->size = spectator_feed_size(frame_width, frame_height);
+	publisher->header = (Spectator_Header*)os_create_shared_memory(name, publisher->size);
+	if (!publisher->header) return false;
+	init_spectator_feed(publisher->header, frame_width, frame_height);
+	return true;
+}
+
+// Readers see the flag and let go, the name is gone at once so a new run can take it
+internal void
+stop_spectator_feed(Spectator_Publisher* publisher) {
+	if (!publisher->header) return;
+	publisher->header->writer_closed.store(1, std::memory_order_release);
+	os_close_shared_memory(publisher->header, publisher->size);
+	os_remove_shared_memory(publisher->name);
+	publisher->header = 0;
+}
+
+// After every simulated frame
+internal void
+publish_spectator_state(Spectator_Publisher* publisher, bool presented) {
+	if (!publisher->header) return;
+	u64 begin = os_get_time_counter();
+
+	Spectator_Tick tick = {};
+	tick.time = begin;
+	tick.gamemode = current_gamemode;
+	tick.score[0] = game_state.score[SIDE_RIGHT];
+	tick.score[1] = game_state.score[SIDE_LEFT];
+	tick.which_player_won = game_state.which_player_won;
+	tick.paddle_count = game_state.paddles.count;
+	tick.ball_count = game_state.balls.count;
+	for (int i = 0; i < game_state.paddles.count; i++) {
+		tick.paddle_px[i] = (float)game_state.paddles.px[i];
+		tick.paddle_py[i] = (float)game_state.paddles.py[i];
+	}
+	for (int i = 0; i < game_state.balls.count; i++) {
+		tick.ball_px[i] = (float)game_state.balls.px[i];
+		tick.ball_py[i] = (float)game_state.balls.py[i];
+	}
+	publish_spectator_tick(publisher->header, &tick);
+	if (presented && publisher->frames) publish_spectator_frame(publisher->header, render_state.memory, tick.tick);
+
+	u64 elapsed = os_get_time_counter() - begin;
+	publisher->total_time += elapsed;
+	if (elapsed > publisher->max_time) publisher->max_time = elapsed;
+}
+
+internal int
+format_spectator_report(Spectator_Publisher* publisher, char* buffer, int size) {
+	u64 ticks = publisher->header ? publisher->header->ticks_published.load(std::memory_order_relaxed) : 0;
+	u64 frames = publisher->header ? publisher->header->frames_published.load(std::memory_order_relaxed) : 0;
+	double us_per_count = 1000000.0 / (double)os_get_time_frequency();
+	return snprintf(buffer, size, "spectator feed: %llu ticks, %llu frames, publish mean %.2fus, max %.0fus", ticks, frames,
+		ticks ? publisher->total_time * us_per_count / ticks : 0.0, publisher->max_time * us_per_count);
+}
+
+// ---------------- Spectator Feed Test -------------------------
+// Plays an AI match unpaced with ticks and frames published, first with nobody watching, then with
+// reader processes attached that poll at different speeds, one of them never reading again after it
+// attaches. Passes if the writer's median frame time held and no reader accepted a torn tick.
+// The writer's frame time is its own CPU time: on a machine with fewer cores than processes the
+// readers take turns with it, which the wall clock times (reported too) would count against the feed.
+#define SPECTATOR_TEST_FRAMES 3000
+
+struct Spectator_Test_Reader {
+	const char* label;
+	int poll_us;                        // Sleep between reads, < 0 reads once and then stalls
+	bool frames;
+};
+
+struct Spectator_Test_Result {
+	u64 ticks_read;
+	u64 ticks_missed;
+	u64 torn_reads;
+	u64 frames_read;
+};
+
+internal void
+run_spectator_test_reader(const char* name, Spectator_Test_Reader config, int result_pipe) {
+	Spectator_Test_Result result = {};
+	size_t size = 0;
+	const Spectator_Header* header = (const Spectator_Header*)os_open_shared_memory(name, &size);
+	if (header && is_spectator_feed_ready(header)) {
+		Spectator_Reader reader;
+		init_spectator_reader(&reader, header);
+		u32* pixels = config.frames ? (u32*)malloc((size_t)header->frame_width * header->frame_height * sizeof(u32)) : 0;
+		u64 frame_tick;
+		for (bool first = true; !header->writer_closed.load(std::memory_order_acquire); first = false) {
+			if (config.poll_us < 0 && !first) {
+				usleep(10000);
+				continue;
+			}
+			follow_spectator_feed(header, &reader);
+			if (pixels && read_latest_spectator_frame(header, pixels, &frame_tick)) result.frames_read++;
+			if (config.poll_us > 0) usleep(config.poll_us);
+		}
+		result.ticks_read = reader.ticks_read;
+		result.ticks_missed = reader.ticks_missed;
+		result.torn_reads = reader.torn_reads;
+	}
+	write(result_pipe, &result, sizeof(result));
+}
+
+internal int
+compare_floats(const void* a, const void* b) {
+	float x = *(const float*)a, y = *(const float*)b;
+	return (x > y) - (x < y);
+}
+
+internal u64
+thread_cpu_time() {
+	timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return time.tv_sec * 1000000000ull + time.tv_nsec;
+}
+
+// Frame times in microseconds, sorted
+internal void
+play_spectated_frames(float* cpu_us, float* wall_us, int frames) {
+	Input input = {};
+	for (int f = 0; f < frames; f++) {
+		u64 begin = os_get_time_counter(), cpu_begin = thread_cpu_time();
+		begin_frame_memory(&game_memory);
+		if (current_gamemode != GM_GAMEPLAY) {
+			init_match(&game_state);
+			current_gamemode = GM_GAMEPLAY;
+		}
+		simulate_game(&input, 1.f / 60.f);
+		publish_spectator_state(&spectator_publisher, true);
+		end_frame_memory(&game_memory);
+		cpu_us[f] = (float)(thread_cpu_time() - cpu_begin) / 1000.f;
+		wall_us[f] = (float)(os_get_time_counter() - begin) / 1000.f;
+	}
+	qsort(cpu_us, frames, sizeof(float), compare_floats);
+	qsort(wall_us, frames, sizeof(float), compare_floats);
+}
+
+internal int
+run_spectator_test() {
+	const char* name = "/pong_spectator_test";
+	Spectator_Test_Reader readers[] = {
+		{ "every tick", 100, false },
+		{ "1ms", 1000, false },
+		{ "16ms", 16000, false },
+		{ "250ms", 250000, false },
+		{ "frames 16ms", 16000, true },
+		{ "stalled", -1, false },
+	};
+	const int reader_count = (int)(sizeof(readers) / sizeof(readers[0]));
+
+	if (!start_spectator_feed(&spectator_publisher, name, true)) {
+		printf("could not create shared memory %s\n", name);
+		return 1;
+	}
+	is_player1_ai = true;
+	is_player2_ai = true;
+	printf("spectator test: %d frames at %dx%d, ticks and frames published\n", SPECTATOR_TEST_FRAMES, render_state.width, render_state.height);
+	fflush(stdout);
+
+	static float alone_us[SPECTATOR_TEST_FRAMES], watched_us[SPECTATOR_TEST_FRAMES];
+	static float alone_wall_us[SPECTATOR_TEST_FRAMES], watched_wall_us[SPECTATOR_TEST_FRAMES];
+	play_spectated_frames(alone_us, alone_wall_us, SPECTATOR_TEST_FRAMES);
+
+	int pipes[reader_count][2];
+	pid_t children[reader_count];
+	for (int r = 0; r < reader_count; r++) {
+		pipe(pipes[r]);
+		children[r] = fork();
+		if (children[r] == 0) {
+			run_spectator_test_reader(name, readers[r], pipes[r][1]);
+			_exit(0);
+		}
+		close(pipes[r][1]);
+	}
+	usleep(50000);                      // Let every reader attach
+	play_spectated_frames(watched_us, watched_wall_us, SPECTATOR_TEST_FRAMES);
+	stop_spectator_feed(&spectator_publisher);
+
+	bool torn = false, stuck = false;
+	printf("%-12s %12s %12s %6s %8s\n", "reader", "ticks read", "missed", "torn", "frames");
+	for (int r = 0; r < reader_count; r++) {
+		Spectator_Test_Result result = {};
+		read(pipes[r][0], &result, sizeof(result));
+		close(pipes[r][0]);
+		waitpid(children[r], 0, 0);
+		printf("%-12s %12llu %12llu %6llu %8llu\n", readers[r].label, result.ticks_read, result.ticks_missed, result.torn_reads, result.frames_read);
+		torn |= result.torn_reads != 0;
+		stuck |= readers[r].poll_us >= 0 && !result.ticks_read;
+	}
+
+	float alone_p50 = alone_us[SPECTATOR_TEST_FRAMES / 2], watched_p50 = watched_us[SPECTATOR_TEST_FRAMES / 2];
+	int p99 = SPECTATOR_TEST_FRAMES * 99 / 100;
+	printf("writer frame time alone:        p50 %.1fus, p99 %.1fus (wall clock p50 %.1fus, p99 %.1fus)\n",
+		alone_p50, alone_us[p99], alone_wall_us[SPECTATOR_TEST_FRAMES / 2], alone_wall_us[p99]);
+	printf("writer frame time with readers: p50 %.1fus, p99 %.1fus (wall clock p50 %.1fus, p99 %.1fus)\n",
+		watched_p50, watched_us[p99], watched_wall_us[SPECTATOR_TEST_FRAMES / 2], watched_wall_us[p99]);
+
+	// Some noise is allowed on top of the median, switching to a reader and back costs the writer cache
+	bool held = watched_p50 <= alone_p50 * 1.2f + 20.f;
+	printf("%s\n", !held ? "FAIL: the readers slowed the writer down" : torn ? "FAIL: a torn tick was accepted" :
+		stuck ? "FAIL: a reader read nothing" : "ok");
+	return held && !torn && !stuck ? 0 : 1;
+}
+
+// ---------------- Crash Suspend -------------------------------
+// A crash or a kill still writes the match in progress before the process dies
+#include <signal.h>
+
+internal void
+handle_fatal_signal(int signal_number) {
+	suspend_match();
+	if (spectator_publisher.header) spectator_publisher.header->writer_closed.store(1, std::memory_order_release);
+	signal(signal_number, SIG_DFL);
+	raise(signal_number);
+}
+
+internal void
+suspend_on_fatal_signals() {
+	int signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTERM, SIGINT, SIGHUP };
+	for (int i = 0; i < (int)(sizeof(signals) / sizeof(signals[0])); i++) {
+		signal(signals[i], handle_fatal_signal);
+	}
+}
+
+// Entry Point for the headless game
+int main(int argc, char** argv) {
+	int width = 1280, height = 720;
+	bool net_play = false, net_test = false;
+	const char* latency_csv_path = 0;
+	const char* tuning_path = "tuning.txt";
+	bool paced = true;
+	const char* spectate_name = 0;
+	const char* sound_sink = 0;
+	bool pipelined = false;
+	bool spectate_frames = false, spectator_test = false;
+	s32 net_frames = 1800;
+	Netplay_Config net_config = {};
+	net_config.seed = 0x1234567;
+	net_config.input_delay = 2;
+	net_config.max_rollback = 8;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-bench-stress")) {
+			run_stress_benchmark();
+			return 0;
+		}
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc) width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-h") && i + 1 < argc) height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-net") && i + 4 < argc) {
+			net_play = true;
+			net_config.local_port = (u16)atoi(argv[++i]);
+			net_config.remote_host = argv[++i];
+			net_config.remote_port = (u16)atoi(argv[++i]);
+			net_config.local_player = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-net-test")) {
+			net_test = true;
+			net_config.latency_ms = 40;
+			net_config.jitter_ms = 20;
+			net_config.loss_percent = 5;
+		}
+		else if (!strcmp(argv[i], "-seed") && i + 1 < argc) net_config.seed = (u32)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-delay") && i + 1 < argc) net_config.input_delay = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-rollback") && i + 1 < argc) net_config.max_rollback = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-latency") && i + 1 < argc) net_config.latency_ms = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-jitter") && i + 1 < argc) net_config.jitter_ms = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-loss") && i + 1 < argc) net_config.loss_percent = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-frames") && i + 1 < argc) net_frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-input-latency") && i + 1 < argc) latency_csv_path = argv[++i];
+		else if (!strcmp(argv[i], "-unpaced")) paced = false;
+		else if (!strcmp(argv[i], "-tuning") && i + 1 < argc) tuning_path = argv[++i];
+		else if (!strcmp(argv[i], "-suspend") && i + 1 < argc) os_set_suspend_file(argv[++i]);
+		else if (!strcmp(argv[i], "-profiles") && i + 1 < argc) os_set_profile_file(argv[++i]);
+		else if (!strcmp(argv[i], "-spectate") && i + 1 < argc) spectate_name = argv[++i];
+		else if (!strcmp(argv[i], "-spectate-frames")) spectate_frames = true;
+		else if (!strcmp(argv[i], "-spectator-test")) spectator_test = true;
+		else if (!strcmp(argv[i], "-sound") && i + 1 < argc) sound_sink = argv[++i];
+		else if (!strcmp(argv[i], "-pipeline")) pipelined = true;
+		else if (!strcmp(argv[i], "-present-ms") && i + 1 < argc) headless_presenter.present_ms = atoi(argv[++i]);
+	}
+
+	// All the memory the game uses, reserved once: the framebuffers (three when pipelined) and the
+	// profile index in the permanent arena, and a transient arena emptied every frame
+	size_t framebuffer_size = (size_t)width * height * sizeof(u32);
+	size_t permanent_size = (pipelined ? PRESENT_BUFFER_COUNT : 1) * framebuffer_size + 1024 * 1024 +
+		get_profile_store_memory_size(get_profile_store_capacity());
+	size_t transient_size = 1024 * 1024;
+	void* memory_block = os_reserve_memory(permanent_size + transient_size);
+	if (!memory_block) return 1;
+	init_game_memory(&game_memory, memory_block, permanent_size, transient_size);
+
+	if (net_test) return run_netplay_test(net_config, net_frames);
+
+	render_state.width = width;
+	render_state.height = height;
+	render_state.memory = push_size(&game_memory.permanent, framebuffer_size);
+	if (spectator_test) return run_spectator_test();
+	if (spectate_name && !start_spectator_feed(&spectator_publisher, spectate_name, spectate_frames)) {
+		printf("could not create shared memory %s\n", spectate_name);
+		return 1;
+	}
+	if (sound_sink && !start_sound_output(&sound_output, sound_sink)) {
+		printf("could not open sound output %s\n", sound_sink);
+		return 1;
+	}
+	if (pipelined && !start_present_pipeline(&headless_presenter, framebuffer_size)) {
+		printf("could not start the present thread\n");
+		return 1;
+	}
+	start_tuning_watch(&tuning_watch, tuning_path);
+	start_render_workers(-1);
+
+	// Raw keys without echo when driven from a terminal
+	termios original_termios;
+	bool is_terminal = isatty(STDIN_FILENO);
+	if (is_terminal) {
+		tcgetattr(STDIN_FILENO, &original_termios);
+		termios raw = original_termios;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+	}
+
+	if (net_play) {
+		if (!start_netplay(&netplay_session, &game_state, net_config)) {
+			printf("could not open port %u\n", net_config.local_port);
+			return 1;
+		}
+		current_gamemode = GM_NETPLAY;
+	}
+	else resume_match();
+	suspend_on_fatal_signals();
+
+	Input input = {};
+	bool force_present = true;
+	bool screen_settled = false;
+	u64 frames_simulated = 0, frames_presented = 0;
+
+	const float target_frame_time = 1.f / 60.f;  // No vsync when headless, so pace gameplay to 60 FPS
+	float delta_time = target_frame_time;
+	bool stdin_open = true;
+	u64 start_time = os_get_time_counter();
+	u64 frame_begin_time = start_time;
+
+	while (running) {
+		begin_frame_memory(&game_memory);
+
+		// ------------ (1) Take Input -------------------------
+		bool release_pending = false;
+		for (int i = 0; i < BUTTON_COUNT; i++) {
+			release_pending |= release_next_frame[i];
+		}
+
+		// The input script is over once stdin is closed and every key in it has been played
+		if (!stdin_open && !pending_key_count && !release_pending) break;
+
+		// Block on stdin: with no limit on a settled screen with no keys left to process (a tuning reload
+		// also ends the wait), otherwise just for the rest of the frame (not at all when unpaced)
+		int timeout_ms = paced ? (int)((target_frame_time - seconds_since(frame_begin_time)) * 1000.f) : 0;
+		if (timeout_ms < 0) timeout_ms = 0;
+		if (screen_settled && !pending_key_count && !release_pending) timeout_ms = -1;
+
+		wait_for_keys(&stdin_open, timeout_ms);
+		begin_headless_input_frame(&input);
+
+		// ------------ (2) Simulate stuff ---------------------
+		if (!screen_settled || any_button_changed(&input) || has_published_tuning() || force_present) {
+			bool frame_changed = simulate_game(&input, delta_time);
+			screen_settled = is_idle_gamemode() && !frame_changed;
+			frames_simulated++;
+
+			// ------------ (3) Present -----------------------------
+			// Headless presents are free, but count them so idle skipping can be checked
+			bool presented = frame_changed || force_present;
+			if (presented) {
+				force_present = false;
+				frames_presented++;
+			}
+			publish_spectator_state(&spectator_publisher, presented);
+			if (presented) present_frame(&headless_presenter, &input);
+			else record_unpresented_input(&input_latency, &input);
+		}
+
+		// ----------- End of Frame - Time Delta Calculation -----------------
+		// Unpaced runs (scripted workloads) step the game by a fixed 60 FPS frame however fast they go
+		u64 frame_end_time = os_get_time_counter();
+		delta_time = paced ? (float)(frame_end_time - frame_begin_time) / 1000000000.f : target_frame_time;
+		frame_begin_time = frame_end_time;
+
+		end_frame_memory(&game_memory);
+	}
+
+	if (is_terminal) tcsetattr(STDIN_FILENO, TCSANOW, &original_termios);
+	suspend_match();
+	if (headless_presenter.pipelined) stop_present_pipeline(&headless_presenter);
+	stop_render_workers();
+
+	// CPU used vs wall time, the pause screen should stay well under 1%
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	float cpu_seconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+		(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.f;
+	float wall_seconds = seconds_since(start_time);
+	printf("frames simulated: %llu\nframes presented: %llu\ncpu: %.3fs of %.3fs (%.2f%%)\n",
+		frames_simulated, frames_presented, cpu_seconds, wall_seconds, 100.f * cpu_seconds / wall_seconds);
+
+	// Key read to present latency, with the full histogram written out on request
+	printf("input latency: %llu events, mean %.0fus, p50 %dus, p99 %dus, max %.0fus\n",
+		input_latency.count, input_latency.count ? input_latency.total_us / input_latency.count : 0.0,
+		latency_percentile_us(&input_latency, .5f), latency_percentile_us(&input_latency, .99f), input_latency.max_us);
+	if (latency_csv_path) {
+		static char latency_text[16 * 1024];
+		String latency_csv = { latency_text, (unsigned int)format_latency_histogram(&input_latency, latency_text, sizeof(latency_text)) };
+		os_write_entire_file(latency_csv_path, latency_csv);
+	}
+
+	char report[256];
+	format_memory_report(&game_memory, report, sizeof(report));
+	printf("%s\n", report);
+	format_suspend_report(report, sizeof(report));
+	printf("%s\n", report);
+	format_rewind_report(report, sizeof(report));
+	printf("%s\n", report);
+	format_profile_report(report, sizeof(report));
+	printf("%s\n", report);
+	Headless_Presenter* presenter = &headless_presenter;
+	format_present_report(presenter->pipelined ? &presenter->pipeline.stats : &presenter->serial_stats,
+		presenter->pipelined ? &presenter->pipeline : 0, wall_seconds, report, sizeof(report));
+	printf("%s\n", report);
+	if (spectator_publisher.header) {
+		format_spectator_report(&spectator_publisher, report, sizeof(report));
+		printf("%s\n", report);
+		stop_spectator_feed(&spectator_publisher);
+	}
+	if (sound_enabled) {
+		stop_sound_output(&sound_output);
+		format_sound_report(&sound_output.mixer, report, sizeof(report));
+		printf("%s\n", report);
+	}
+	return 0;
+}
@@ -0,0 +1,455 @@
+// Headless match server: hosts up to -matches independent matches for players over UDP, see
+// match_server.cpp for the protocol.
+// Build: g++ -O2 -pthread -o pong_server linux_server.cpp
+// Usage: ./pong_server [-port 47100] [-matches 4096] [-threads n] [-seconds n]
+// Players are seated in pairs as they join. One thread waits on the socket and the tick timer with
+// epoll and reads input packets between ticks; every tick it and -threads - 1 others (one per core by
+// default) each step a fixed shard of the matches and send their players' states. Runs until SIGINT
+// or SIGTERM (or -seconds) and prints the tick times and traffic at exit.
+#include "linux_os.cpp"
+#include "game.cpp"
+#include "match_server.cpp"
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define SERVER_BATCH 64                     // Packets per recvmmsg and sendmmsg
+#define SERVER_MAX_PACKET 128
+
+struct Match_Server;
+
+// A thread's shard of the matches, with its own send batch
+struct Server_Worker {
+	Match_Server* server;
+	pthread_t thread;
+	int first_match, end_match;
+	u64 tick_time;                          // os_get_time_counter() units this thread's last tick took
+	u32 matches_playing;
+	u64 packets_sent, bytes_sent;
+
+	int pending;
+	mmsghdr messages[SERVER_BATCH];
+	iovec vectors[SERVER_BATCH];
+	Server_State packets[SERVER_BATCH];
+};
+
+struct Join_Entry {
+	u32 nonce;
+	int seat;                               // 2 * match + player, -1 when the entry was never used
+};
+
+struct Match_Server {
+	int socket;
+	Server_Match* matches;
+	sockaddr_in* addresses;                 // Two per match, where each player's packets came from
+	int match_count;
+	int open_match;                         // Seated one player and waiting for the other, -1 when none
+	int next_free;                          // Where the search for an empty match starts
+	u32 next_seed;
+
+	// Seats by join nonce, so a repeated join gets the same seat. Entries are never removed: one
+	// whose seat has been given up is stale, skipped by lookups and reused by the next join
+	Join_Entry* join_table;
+	u32 join_table_mask;
+
+	Server_Worker* workers;
+	int worker_count;
+	pthread_barrier_t tick_start, tick_end;
+	bool stopping;
+
+	Tick_Time_Stats tick_times;
+	u64 ticks, late_ticks;
+	u64 total_cpu_time;
+	u64 packets_received, bad_packets;
+	u64 joins_refused, timeouts;
+};
+
+global_variable volatile sig_atomic_t server_stop_requested;
+
+internal void
+handle_server_signal(int signal_number) {
+	server_stop_requested = 1;
+}
+
+internal bool
+same_address(const sockaddr_in* a, const sockaddr_in* b) {
+	return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+// ---------------- Ticks -------------------------------------------
+internal void
+flush_server_sends(Match_Server* server, Server_Worker* worker) {
+	for (int sent = 0; sent < worker->pending;) {
+		int count = sendmmsg(server->socket, worker->messages + sent, worker->pending - sent, 0);
+		if (count <= 0) break;              // Socket buffer full: the rest are lost like any other datagram
+		sent += count;
+	}
+	worker->pending = 0;
+}
+
+internal void
+queue_server_state(Match_Server* server, Server_Worker* worker, int m, int player) {
+	Server_State* packet = &worker->packets[worker->pending];
+	int size = encode_server_state(&server->matches[m], (u32)m, player, packet);
+	worker->vectors[worker->pending] = { packet, (size_t)size };
+	msghdr* message = &worker->messages[worker->pending].msg_hdr;
+	*message = {};
+	message->msg_name = &server->addresses[2 * m + player];
+	message->msg_namelen = sizeof(sockaddr_in);
+	message->msg_iov = &worker->vectors[worker->pending];
+	message->msg_iovlen = 1;
+	worker->packets_sent++;
+	worker->bytes_sent += size;
+	if (++worker->pending == SERVER_BATCH) flush_server_sends(server, worker);
+}
+
+internal void
+run_server_shard(Match_Server* server, Server_Worker* worker) {
+	u64 begin = os_get_time_counter();
+	worker->matches_playing = 0;
+	for (int m = worker->first_match; m < worker->end_match; m++) {
+		Server_Match* match = &server->matches[m];
+		if (match->players_joined < 2) continue;
+		step_server_match(match);
+		queue_server_state(server, worker, m, 0);
+		queue_server_state(server, worker, m, 1);
+		worker->matches_playing++;
+	}
+	flush_server_sends(server, worker);
+	worker->tick_time = os_get_time_counter() - begin;
+}
+
+internal void*
+server_worker_thread(void* data) {
+	Server_Worker* worker = (Server_Worker*)data;
+	Match_Server* server = worker->server;
+	for (;;) {
+		pthread_barrier_wait(&server->tick_start);
+		if (server->stopping) return 0;
+		run_server_shard(server, worker);
+		pthread_barrier_wait(&server->tick_end);
+	}
+}
+
+// The calling thread steps the first shard, the workers the others
+internal void
+run_server_tick(Match_Server* server) {
+	u64 begin = os_get_time_counter();
+	pthread_barrier_wait(&server->tick_start);
+	run_server_shard(server, &server->workers[0]);
+	pthread_barrier_wait(&server->tick_end);
+	u64 end = os_get_time_counter();
+
+	server->ticks++;
+	record_tick_time(&server->tick_times, (end - begin) * 1000000 / os_get_time_frequency());
+	for (int w = 0; w < server->worker_count; w++) server->total_cpu_time += server->workers[w].tick_time;
+}
+
+// ---------------- Seats -------------------------------------------
+internal bool
+is_join_entry_live(const Match_Server* server, const Join_Entry* entry) {
+	const Server_Match* match = &server->matches[entry->seat / 2];
+	return match->players_joined > entry->seat % 2 && match->nonce[entry->seat % 2] == entry->nonce;
+}
+
+// The live entry for nonce when insert is false, otherwise the first entry free to take it
+internal Join_Entry*
+find_join_entry(Match_Server* server, u32 nonce, bool insert) {
+	for (u32 i = (nonce * 2654435761u) & server->join_table_mask;; i = (i + 1) & server->join_table_mask) {
+		Join_Entry* entry = &server->join_table[i];
+		if (entry->seat < 0) return insert ? entry : 0;
+		bool live = is_join_entry_live(server, entry);
+		if (insert ? !live : live && entry->nonce == nonce) return entry;
+	}
+}
+
+internal int
+find_free_match(Match_Server* server) {
+	for (int i = 0; i < server->match_count; i++) {
+		int m = (server->next_free + i) % server->match_count;
+		if (!server->matches[m].players_joined) {
+			server->next_free = (m + 1) % server->match_count;
+			return m;
+		}
+	}
+	return -1;
+}
+
+internal void
+send_server_welcome(Match_Server* server, const sockaddr_in* to, u32 match, int player, u32 nonce) {
+	Server_Welcome welcome = { { SERVER_MAGIC, SERVER_WELCOME, (u8)player, 0, match }, nonce };
+	sendto(server->socket, &welcome, sizeof(welcome), 0, (const sockaddr*)to, sizeof(*to));
+}
+
+internal void
+seat_server_player(Match_Server* server, const Server_Join* join, const sockaddr_in* from) {
+	Join_Entry* entry = find_join_entry(server, join->nonce, false);
+	if (entry) {
+		send_server_welcome(server, from, entry->seat / 2, entry->seat % 2, join->nonce);
+		return;
+	}
+
+	int m = server->open_match;
+	if (m < 0 && (m = find_free_match(server)) < 0) {
+		server->joins_refused++;
+		send_server_welcome(server, from, SERVER_FULL, 0, join->nonce);
+		return;
+	}
+
+	Server_Match* match = &server->matches[m];
+	int player = match->players_joined;
+	if (!player) *match = {};
+	match->nonce[player] = join->nonce;
+	match->acked_tick[player] = SERVER_NO_BASE;
+	match->last_heard[player] = os_get_time_counter();
+	match->players_joined++;
+	server->addresses[2 * m + player] = *from;
+	*find_join_entry(server, join->nonce, true) = { join->nonce, 2 * m + player };
+
+	if (player == 0) server->open_match = m;
+	else {
+		start_server_match(match, server->next_seed);
+		server->next_seed = server->next_seed * 2654435761u + 12345;
+		server->open_match = -1;
+	}
+	send_server_welcome(server, from, m, player, join->nonce);
+}
+
+// Frees the matches a player has gone quiet in, the other player has to join again
+internal void
+expire_server_matches(Match_Server* server) {
+	u64 now = os_get_time_counter();
+	u64 timeout = SERVER_TIMEOUT_SECONDS * os_get_time_frequency();
+	for (int m = 0; m < server->match_count; m++) {
+		Server_Match* match = &server->matches[m];
+		for (int p = 0; p < match->players_joined; p++) {
+			if (now - match->last_heard[p] < timeout) continue;
+			if (server->open_match == m) server->open_match = -1;
+			match->players_joined = 0;
+			server->timeouts++;
+			break;
+		}
+	}
+}
+
+// ---------------- Packets -----------------------------------------
+internal void
+fill_server_stats(Match_Server* server, Server_Stats* stats) {
+	*stats = {};
+	stats->header = { SERVER_MAGIC, SERVER_STATS, 0, 0, 0 };
+	stats->threads = server->worker_count;
+	stats->tick_rate = (u32)(1.f / netplay_dt + .5f);
+	stats->ticks = server->ticks;
+	stats->late_ticks = server->late_ticks;
+	stats->tick_p50_us = tick_time_percentile_us(&server->tick_times, .5f);
+	stats->tick_p99_us = tick_time_percentile_us(&server->tick_times, .99f);
+	stats->tick_max_us = (u32)server->tick_times.max_us;
+	stats->cpu_us_per_tick = server->ticks ? (float)(server->total_cpu_time * 1000000.0 / os_get_time_frequency() / server->ticks) : 0.f;
+	stats->packets_received = server->packets_received;
+	stats->joins_refused = server->joins_refused;
+	stats->timeouts = server->timeouts;
+	for (int w = 0; w < server->worker_count; w++) {
+		stats->matches_playing += server->workers[w].matches_playing;
+		stats->packets_sent += server->workers[w].packets_sent;
+		stats->bytes_sent += server->workers[w].bytes_sent;
+	}
+	for (int m = 0; m < server->match_count; m++) stats->players += server->matches[m].players_joined;
+}
+
+internal void
+handle_server_packet(Match_Server* server, const u8* data, int size, const sockaddr_in* from) {
+	Server_Header header;
+	if (size < (int)sizeof(header)) {
+		server->bad_packets++;
+		return;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != SERVER_MAGIC) {
+		server->bad_packets++;
+		return;
+	}
+
+	if (header.type == SERVER_JOIN && size == (int)sizeof(Server_Join)) {
+		Server_Join join;
+		memcpy(&join, data, sizeof(join));
+		seat_server_player(server, &join, from);
+	}
+	else if (header.type == SERVER_INPUT && size == (int)sizeof(Server_Input)) {
+		Server_Input input;
+		memcpy(&input, data, sizeof(input));
+		Server_Match* match = header.match < (u32)server->match_count ? &server->matches[header.match] : 0;
+		int player = header.player;
+		if (!match || player > 1 || player >= match->players_joined || !same_address(&server->addresses[2 * header.match + player], from)) {
+			server->bad_packets++;
+			return;
+		}
+		match->input_bits[player] = input.bits;
+		match->last_heard[player] = os_get_time_counter();
+		u32 acked = match->acked_tick[player];
+		if (input.ack_tick != SERVER_NO_BASE && input.ack_tick <= match->tick &&
+			(acked == SERVER_NO_BASE || input.ack_tick > acked)) match->acked_tick[player] = input.ack_tick;
+	}
+	else if (header.type == SERVER_STATS_REQUEST) {
+		Server_Stats stats;
+		fill_server_stats(server, &stats);
+		sendto(server->socket, &stats, sizeof(stats), 0, (const sockaddr*)from, sizeof(*from));
+	}
+	else server->bad_packets++;
+}
+
+// Reads everything waiting on the socket, a batch per call
+internal void
+receive_server_packets(Match_Server* server) {
+	static u8 buffers[SERVER_BATCH][SERVER_MAX_PACKET];
+	static sockaddr_in from[SERVER_BATCH];
+	static iovec vectors[SERVER_BATCH];
+	static mmsghdr messages[SERVER_BATCH];
+	for (;;) {
+		for (int i = 0; i < SERVER_BATCH; i++) {
+			vectors[i] = { buffers[i], SERVER_MAX_PACKET };
+			messages[i].msg_hdr = {};
+			messages[i].msg_hdr.msg_name = &from[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(from[i]);
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		int count = recvmmsg(server->socket, messages, SERVER_BATCH, MSG_DONTWAIT, 0);
+		if (count <= 0) return;
+		server->packets_received += count;
+		for (int i = 0; i < count; i++) handle_server_packet(server, buffers[i], (int)messages[i].msg_len, &from[i]);
+		if (count < SERVER_BATCH) return;
+	}
+}
+
+// ---------------- Setup -------------------------------------------
+internal bool
+start_match_server(Match_Server* server, Memory_Arena* arena, u16 port, int match_count, int worker_count) {
+	*server = {};
+	server->match_count = match_count;
+	server->open_match = -1;
+	server->next_seed = (u32)os_get_time_counter() | 1;
+	server->matches = push_array(arena, Server_Match, match_count);
+	server->addresses = push_array(arena, sockaddr_in, 2 * match_count);
+	server->join_table_mask = 1;
+	while (server->join_table_mask + 1 < 4u * match_count) server->join_table_mask = 2 * server->join_table_mask + 1;
+	server->join_table = push_array(arena, Join_Entry, server->join_table_mask + 1);
+	server->worker_count = worker_count;
+	server->workers = push_array(arena, Server_Worker, worker_count);
+	if (!server->matches || !server->addresses || !server->join_table || !server->workers) return false;
+	memset(server->matches, 0, sizeof(Server_Match) * match_count);
+	for (u32 i = 0; i <= server->join_table_mask; i++) server->join_table[i] = { 0, -1 };
+
+	server->socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (server->socket < 0) return false;
+	int buffer_size = 8 * 1024 * 1024;      // Room for a whole tick of states, and for inputs while a tick runs
+	setsockopt(server->socket, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+	setsockopt(server->socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+	sockaddr_in local = {};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(port);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(server->socket, (sockaddr*)&local, sizeof(local)) < 0) return false;
+
+	pthread_barrier_init(&server->tick_start, 0, worker_count);
+	pthread_barrier_init(&server->tick_end, 0, worker_count);
+	for (int w = 0; w < worker_count; w++) {
+		Server_Worker* worker = &server->workers[w];
+		*worker = {};
+		worker->first_match = (int)((s64)match_count * w / worker_count);
+		worker->end_match = (int)((s64)match_count * (w + 1) / worker_count);
+		if (w == 0) continue;
+		worker->server = server;
+		if (pthread_create(&worker->thread, 0, server_worker_thread, worker)) return false;
+	}
+	return true;
+}
+
+internal void
+stop_match_server(Match_Server* server) {
+	server->stopping = true;
+	pthread_barrier_wait(&server->tick_start);
+	for (int w = 1; w < server->worker_count; w++) pthread_join(server->workers[w].thread, 0);
+	close(server->socket);
+}
+
+int main(int argc, char** argv) {
+	u16 port = 47100;
+	int match_count = 4096;
+	int thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	float seconds = 0.f;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-port") && i + 1 < argc) port = (u16)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-matches") && i + 1 < argc) match_count = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc) thread_count = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seconds") && i + 1 < argc) seconds = (float)atof(argv[++i]);
+	}
+	match_count = clamp(1, match_count, SERVER_MAX_MATCHES);
+	thread_count = clamp(1, thread_count, 64);
+
+	// Both sides of every match are human, and no match plays sounds or keeps stats
+	is_player1_ai = false;
+	is_player2_ai = false;
+
+	size_t permanent_size = match_count * (sizeof(Server_Match) + 2 * sizeof(sockaddr_in) + 8 * sizeof(Join_Entry)) + thread_count * sizeof(Server_Worker) + 1024 * 1024;
+	void* memory_block = os_reserve_memory(permanent_size);
+	if (!memory_block) return 1;
+	init_game_memory(&game_memory, memory_block, permanent_size, 0);
+	static Match_Server server;
+	if (!start_match_server(&server, &game_memory.permanent, port, match_count, thread_count)) {
+		printf("could not start the server on port %u\n", port);
+		return 1;
+	}
+
+	struct sigaction action = {};
+	action.sa_handler = handle_server_signal;
+	sigaction(SIGINT, &action, 0);
+	sigaction(SIGTERM, &action, 0);
+
+	// The tick timer and the socket are the only things waited on
+	int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	long tick_ns = (long)(netplay_dt * 1000000000.0);
+	itimerspec period = { { 0, tick_ns }, { 0, tick_ns } };
+	timerfd_settime(timer, 0, &period, 0);
+	int epoll = epoll_create1(EPOLL_CLOEXEC);
+	epoll_event socket_event = {}, timer_event = {};
+	socket_event.events = timer_event.events = EPOLLIN;
+	socket_event.data.fd = server.socket;
+	timer_event.data.fd = timer;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, server.socket, &socket_event);
+	epoll_ctl(epoll, EPOLL_CTL_ADD, timer, &timer_event);
+	printf("serving %d matches on port %u with %d threads\n", match_count, port, thread_count);
+	fflush(stdout);
+
+	u64 start_time = os_get_time_counter();
+	u64 end_time = seconds > 0 ? start_time + (u64)(seconds * os_get_time_frequency()) : ~0ull;
+	u64 next_expiry = start_time + os_get_time_frequency();
+	while (!server_stop_requested && os_get_time_counter() < end_time) {
+		epoll_event events[2];
+		int count = epoll_wait(epoll, events, 2, 100);
+		for (int e = 0; e < count; e++) {
+			if (events[e].data.fd == server.socket) receive_server_packets(&server);
+			else {
+				// A tick that overran loses the periods it covered, matches are never stepped twice to catch up
+				u64 expirations = 0;
+				if (read(timer, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+				server.late_ticks += expirations - 1;
+				run_server_tick(&server);
+			}
+		}
+		if (os_get_time_counter() >= next_expiry) {
+			expire_server_matches(&server);
+			next_expiry += os_get_time_frequency();
+		}
+	}
+	stop_match_server(&server);
+
+	Server_Stats stats;
+	fill_server_stats(&server, &stats);
+	char report[512];
+	format_server_stats(&stats, report, sizeof(report));
+	printf("%s\n", report);
+	format_memory_report(&game_memory, report, sizeof(report));
+	printf("%s\n", report);
+	return 0;
+}
@@ -0,0 +1,96 @@
+// Spectator feed reader: follows a game run with pong_linux -spectate and prints the match as it goes,
+// the starting point for an overlay, a stats display or a recorder. See spectator_feed.cpp.
+// Build: g++ -O2 -o pong_spectator linux_spectator.cpp
+// Usage: ./pong_spectator name [-poll ms] [-seconds n] [-ppm file]
+// -poll is the sleep between reads (a slow reader skips the ticks it was too late for), -seconds stops
+// early, and -ppm writes the last frame seen when the game publishes frames. It waits for the game to
+// start and stops when the game exits.
+#include "linux_os.cpp"
+#include "spectator_feed.cpp"
+
+internal bool
+write_frame_ppm(const char* path, const u32* pixels, int width, int height) {
+	int header_size = 32;
+	char* text = (char*)push_size(&game_memory.transient, header_size + width * height * 3);
+	if (!text) return false;
+	int length = snprintf(text, header_size, "P6\n%d %d\n255\n", width, height);
+
+	// The framebuffer is bottom up
+	for (int y = height - 1; y >= 0; y--) {
+		for (int x = 0; x < width; x++) {
+			u32 color = pixels[x + y * width];
+			text[length++] = (char)(color >> 16);
+			text[length++] = (char)(color >> 8);
+			text[length++] = (char)color;
+		}
+	}
+
+	String data = { text, (unsigned int)length };
+	return os_write_entire_file(path, data);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argv[1][0] == '-') {
+		printf("usage: pong_spectator name [-poll ms] [-seconds n] [-ppm file]\n");
+		return 1;
+	}
+	const char* name = argv[1];
+	int poll_ms = 16;
+	float seconds = 0.f;
+	const char* ppm_path = 0;
+	for (int i = 2; i < argc; i++) {
+		if (!strcmp(argv[i], "-poll") && i + 1 < argc) poll_ms = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seconds") && i + 1 < argc) seconds = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "-ppm") && i + 1 < argc) ppm_path = argv[++i];
+	}
+
+	u64 start_time = os_get_time_counter();
+	u64 end_time = seconds > 0 ? start_time + (u64)(seconds * os_get_time_frequency()) : ~0ull;
+	const Spectator_Header* header = 0;
+	size_t size = 0;
+	while (!header || !is_spectator_feed_ready(header)) {
+		if (os_get_time_counter() > end_time) return 1;
+		if (!header) header = (const Spectator_Header*)os_open_shared_memory(name, &size);
+		usleep(10000);
+	}
+	printf("following %s: %u tick slots, frames %s\n", name, header->tick_slot_count,
+		header->frame_slot_count ? "on" : "off");
+
+	// Frames are only copied when one is asked for at the end, the reader keeps the latest
+	u32* pixels = 0;
+	if (ppm_path && header->frame_slot_count) {
+		size_t frame_size = (size_t)header->frame_width * header->frame_height * sizeof(u32);
+		void* memory_block = os_reserve_memory(2 * frame_size + 1024);
+		if (!memory_block) return 1;
+		init_game_memory(&game_memory, memory_block, frame_size, frame_size + 1024);
+		pixels = (u32*)push_size(&game_memory.permanent, frame_size);
+	}
+
+	Spectator_Reader reader;
+	init_spectator_reader(&reader, header);
+	u64 frame_tick = 0;
+	bool have_frame = false;
+	u64 next_print = start_time;
+	while (!header->writer_closed.load(std::memory_order_acquire) && os_get_time_counter() < end_time) {
+		follow_spectator_feed(header, &reader);
+		if (pixels) have_frame |= read_latest_spectator_frame(header, pixels, &frame_tick);
+
+		u64 now = os_get_time_counter();
+		if (reader.ticks_read && now >= next_print) {
+			const Spectator_Tick* tick = &reader.latest;
+			printf("tick %llu: mode %d, score %d - %d", tick->tick, tick->gamemode, tick->score[0], tick->score[1]);
+			if (tick->ball_count) printf(", ball at (%.1f, %.1f)", tick->ball_px[0], tick->ball_py[0]);
+			printf(", %.1fms behind\n", (now - tick->time) / 1000000.0);
+			next_print = now + os_get_time_frequency();
+		}
+		usleep(poll_ms * 1000);
+	}
+
+	follow_spectator_feed(header, &reader);        // The last ticks before the game closed the feed
+	printf("ticks read %llu, missed %llu, torn %llu\n", reader.ticks_read, reader.ticks_missed, reader.torn_reads);
+	if (have_frame && write_frame_ppm(ppm_path, pixels, header->frame_width, header->frame_height)) {
+		printf("frame of tick %llu written to %s\n", frame_tick, ppm_path);
+	}
+	os_close_shared_memory(header, size);
+	return 0;
+}
@@ -0,0 +1,454 @@
+// X11 platform layer: the game in a window on a Linux desktop, keys from the X server
+// Build: g++ -O2 -pthread -o pong_x11 linux_x11.cpp -lX11 -lXext
+// Usage: ./pong_x11 [-w width] [-h height] [-no-shm] [-suspend file] [-profiles file]
+//        ./pong_x11 -bench-present [-frames n]
+// Frames are presented from a MIT-SHM shared XImage when the server is local: the game draws straight
+// into the segment and a present only sends the server small requests to copy from it. Without the
+// extension (or with -no-shm) each present sends the pixels through the socket with XPutImage.
+// -bench-present times both at 1080p and 4K and checks the window shows what was drawn; against
+// a virtual server: xvfb-run -s "-screen 0 3840x2160x24" ./pong_x11 -bench-present
+// Exit code of -bench-present: 0 when both paths showed every frame right, 1 when one did not
+// or there is no display with a 32 bit TrueColor visual
+#include "linux_os.cpp"
+#include "game.cpp"
+#include "present_pipeline.cpp"
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
+#undef internal                             // XKBlib.h has a struct member by that name
+#include <X11/XKBlib.h>
+#define internal static
+
+internal void
+sleep_until(u64 time) {
+	u64 now = os_get_time_counter();
+	if (now >= time) return;
+	timespec ts = { (time_t)((time - now) / 1000000000ull), (long)((time - now) % 1000000000ull) };
+	nanosleep(&ts, 0);
+}
+
+// ---------------- Window ---------------------------------------
+struct X11_Window {
+	Display* display;
+	Window window;
+	GC gc;
+	Visual* visual;
+	int depth;
+	Atom delete_window;
+	int max_width, max_height;              // The framebuffer is reserved for the whole screen
+
+	// MIT-SHM: one segment for the biggest framebuffer, the images over it are remade on a resize
+	bool use_shm;
+	XShmSegmentInfo shm_info;
+	int shm_completion_event;
+	bool shm_pending;                       // The server may still be reading the segment
+	XImage* image;
+	Present_Stats present_stats;
+};
+
+global_variable X11_Window x11_window;
+
+// A failed XShmAttach (a remote display) arrives as an error, not a return value
+global_variable bool x11_shm_failed;
+
+internal int
+handle_shm_attach_error(Display* display, XErrorEvent* error) {
+	x11_shm_failed = true;
+	return 0;
+}
+
+// Pixels are u32 0x00RRGGBB, what a 24 bit TrueColor visual at 32 bits per pixel takes as is
+internal bool
+has_framebuffer_visual(Display* display, Visual* visual, int depth) {
+	if (ImageByteOrder(display) != LSBFirst) return false;
+	if (depth != 24 || visual->red_mask != 0xff0000 || visual->green_mask != 0x00ff00 || visual->blue_mask != 0x0000ff) return false;
+	int count;
+	XPixmapFormatValues* formats = XListPixmapFormats(display, &count);
+	bool found = false;
+	for (int i = 0; i < count; i++) {
+		if (formats[i].depth == 24 && formats[i].bits_per_pixel == 32) found = true;
+	}
+	XFree(formats);
+	return found;
+}
+
+// The segment becomes the framebuffer, false to fall back to XPutImage
+internal bool
+attach_shm_framebuffer(X11_Window* x11, size_t framebuffer_size) {
+	int major, minor;
+	Bool shared_pixmaps;
+	if (!XShmQueryVersion(x11->display, &major, &minor, &shared_pixmaps)) return false;
+
+	x11->shm_info.shmid = shmget(IPC_PRIVATE, framebuffer_size, IPC_CREAT | 0600);
+	if (x11->shm_info.shmid < 0) return false;
+	x11->shm_info.shmaddr = (char*)shmat(x11->shm_info.shmid, 0, 0);
+	x11->shm_info.readOnly = True;
+	if (x11->shm_info.shmaddr == (char*)-1) {
+		shmctl(x11->shm_info.shmid, IPC_RMID, 0);
+		return false;
+	}
+
+	x11_shm_failed = false;
+	XErrorHandler previous = XSetErrorHandler(handle_shm_attach_error);
+	XShmAttach(x11->display, &x11->shm_info);
+	XSync(x11->display, False);
+	XSetErrorHandler(previous);
+
+	// Both sides are attached (or the server never will be), the segment goes away with the last detach
+	shmctl(x11->shm_info.shmid, IPC_RMID, 0);
+	if (x11_shm_failed) {
+		shmdt(x11->shm_info.shmaddr);
+		return false;
+	}
+	os_allocation_count++;
+	x11->shm_completion_event = XShmGetEventBase(x11->display) + ShmCompletion;
+	x11->use_shm = true;
+	return true;
+}
+
+internal void
+detach_shm_framebuffer(X11_Window* x11) {
+	if (!x11->use_shm) return;
+	XShmDetach(x11->display, &x11->shm_info);
+	XSync(x11->display, False);
+	shmdt(x11->shm_info.shmaddr);
+	x11->use_shm = false;
+}
+
+// The image describes render_state at its current size. Its pixels are ours, only the struct is Xlib's.
+internal void
+make_framebuffer_image(X11_Window* x11) {
+	if (x11->image) XFree(x11->image);
+	if (x11->use_shm) {
+		x11->image = XShmCreateImage(x11->display, x11->visual, x11->depth, ZPixmap, x11->shm_info.shmaddr, &x11->shm_info,
+			render_state.width, render_state.height);
+	}
+	else {
+		x11->image = XCreateImage(x11->display, x11->visual, x11->depth, ZPixmap, 0, (char*)render_state.memory,
+			render_state.width, render_state.height, 32, render_state.width * sizeof(u32));
+	}
+}
+
+internal Bool
+is_shm_completion(Display* display, XEvent* event, XPointer x11) {
+	return event->type == ((X11_Window*)x11)->shm_completion_event;
+}
+
+// Drawing has to wait while the server still copies out of the segment. Other events stay queued.
+internal void
+wait_for_shm_completion(X11_Window* x11) {
+	if (!x11->shm_pending) return;
+	XEvent event;
+	XIfEvent(x11->display, &event, is_shm_completion, (XPointer)x11);
+	x11->shm_pending = false;
+}
+
+// The game draws top down here (render_top_down), the way X images are, so the whole frame is one
+// request. With MIT-SHM that request is only where to copy from instead of 33 MB of pixels at 4K.
+internal void
+present_framebuffer(X11_Window* x11) {
+	int width = render_state.width, height = render_state.height;
+	if (x11->use_shm) XShmPutImage(x11->display, x11->window, x11->gc, x11->image, 0, 0, 0, 0, width, height, True);
+	else XPutImage(x11->display, x11->window, x11->gc, x11->image, 0, 0, 0, 0, width, height);
+	x11->shm_pending = x11->use_shm;
+	XFlush(x11->display);
+}
+
+internal bool
+open_x11_window(X11_Window* x11, int width, int height, bool allow_shm) {
+	x11->display = XOpenDisplay(0);
+	if (!x11->display) return false;
+	int screen = DefaultScreen(x11->display);
+	x11->visual = DefaultVisual(x11->display, screen);
+	x11->depth = DefaultDepth(x11->display, screen);
+	if (!has_framebuffer_visual(x11->display, x11->visual, x11->depth)) return false;
+
+	// All the memory the game uses, reserved once: the framebuffer (big enough for a window over the whole
+	// screen) in the permanent arena or the shared segment, the profile index in the permanent arena, and
+	// a transient arena emptied every frame
+	x11->max_width = DisplayWidth(x11->display, screen);
+	x11->max_height = DisplayHeight(x11->display, screen);
+	if (width > x11->max_width) x11->max_width = width;
+	if (height > x11->max_height) x11->max_height = height;
+	size_t framebuffer_size = (size_t)x11->max_width * x11->max_height * sizeof(u32);
+	bool shared = allow_shm && attach_shm_framebuffer(x11, framebuffer_size);
+	size_t permanent_size = (shared ? 0 : framebuffer_size) + 1024 * 1024 + get_profile_store_memory_size(get_profile_store_capacity());
+	size_t transient_size = 1024 * 1024;
+	void* memory_block = os_reserve_memory(permanent_size + transient_size);
+	if (!memory_block) return false;
+	init_game_memory(&game_memory, memory_block, permanent_size, transient_size);
+	render_state.memory = shared ? x11->shm_info.shmaddr : push_size(&game_memory.permanent, framebuffer_size);
+	render_state.width = width;
+	render_state.height = height;
+	render_top_down = true;
+
+	x11->window = XCreateSimpleWindow(x11->display, RootWindow(x11->display, screen), 0, 0, width, height, 0, 0, 0);
+	XStoreName(x11->display, x11->window, "My Pong Game");
+	XSelectInput(x11->display, x11->window, KeyPressMask | KeyReleaseMask | ExposureMask | StructureNotifyMask);
+	x11->delete_window = XInternAtom(x11->display, "WM_DELETE_WINDOW", False);
+	XSetWMProtocols(x11->display, x11->window, &x11->delete_window, 1);
+	XkbSetDetectableAutoRepeat(x11->display, True, 0);        // A held key is one press, not a press per repeat
+	x11->gc = XCreateGC(x11->display, x11->window, 0, 0);
+	make_framebuffer_image(x11);
+	XMapWindow(x11->display, x11->window);
+
+	// Nothing drawn before the window is up would be seen
+	XEvent event;
+	do XNextEvent(x11->display, &event); while (event.type != MapNotify);
+	return true;
+}
+
+internal void
+close_x11_window(X11_Window* x11) {
+	wait_for_shm_completion(x11);
+	if (x11->image) XFree(x11->image);
+	x11->image = 0;
+	detach_shm_framebuffer(x11);
+	XFreeGC(x11->display, x11->gc);
+	XDestroyWindow(x11->display, x11->window);
+	XCloseDisplay(x11->display);
+}
+
+// The framebuffer only ever shrinks below the size reserved for the screen
+internal void
+resize_framebuffer(X11_Window* x11, int width, int height) {
+	if (width > x11->max_width) width = x11->max_width;
+	if (height > x11->max_height) height = x11->max_height;
+	if (width == render_state.width && height == render_state.height) return;
+	wait_for_shm_completion(x11);
+	render_state.width = width;
+	render_state.height = height;
+	make_framebuffer_image(x11);
+}
+
+// ---------------- Keyboard -------------------------------------
+internal int
+get_key_button(KeySym key) {
+	switch (key) {
+		case XK_Up: return BUTTON_UP;
+		case XK_Down: return BUTTON_DOWN;
+		case XK_Left: return BUTTON_LEFT;
+		case XK_Right: return BUTTON_RIGHT;
+		case XK_w: return BUTTON_W;
+		case XK_s: return BUTTON_S;
+		case XK_a: return BUTTON_A;
+		case XK_d: return BUTTON_D;
+		case XK_p: return BUTTON_P;
+		case XK_Return:
+		case XK_KP_Enter: return BUTTON_ENTER;
+		case XK_Escape: return BUTTON_ESC;
+	}
+	return -1;
+}
+
+// Drains the queue into input, returns whether the window needs presenting again
+internal bool
+process_x11_events(X11_Window* x11, Input* input) {
+	bool exposed = false;
+	while (XPending(x11->display)) {
+		XEvent event;
+		XNextEvent(x11->display, &event);
+		switch (event.type) {
+			case KeyPress:
+			case KeyRelease: {
+				// Unshifted, so a held Shift or Caps Lock does not change what the key is
+				int button = get_key_button(XLookupKeysym(&event.xkey, 0));
+				if (button >= 0) process_button_transition(input, button, event.type == KeyPress, os_get_time_counter());
+			} break;
+
+			case ConfigureNotify: {
+				resize_framebuffer(x11, event.xconfigure.width, event.xconfigure.height);
+				exposed = true;
+			} break;
+
+			case Expose: exposed = true; break;
+
+			case ClientMessage: {
+				if ((Atom)event.xclient.data.l[0] == x11->delete_window) running = false;
+			} break;
+
+			default: {
+				if (event.type == x11->shm_completion_event) x11->shm_pending = false;
+			}
+		}
+	}
+	return exposed;
+}
+
+// Waits up to timeout_ms for the server to send something
+internal void
+wait_for_x11_events(X11_Window* x11, int timeout_ms) {
+	if (XPending(x11->display)) return;
+	pollfd connection = { ConnectionNumber(x11->display), POLLIN, 0 };
+	poll(&connection, 1, timeout_ms);
+}
+
+// ---------------- Present Benchmark ----------------------------
+// Every present is timed until the server has finished with it: the completion event with MIT-SHM,
+// a round trip after XPutImage. Then the window is read back and compared with the framebuffer.
+#define BENCH_PRESENT_MAX_FRAMES 1000
+
+internal int
+compare_present_times(const void* a, const void* b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+internal bool
+window_shows_framebuffer(X11_Window* x11) {
+	int width = render_state.width, height = render_state.height;
+	XImage* shown = XGetImage(x11->display, x11->window, 0, 0, width, height, AllPlanes, ZPixmap);
+	if (!shown) return false;
+	bool same = true;
+	const u32* pixels = (const u32*)render_state.memory;
+	for (int y = 0; y < height && same; y++) {
+		for (int x = 0; x < width && same; x++) {
+			same = (XGetPixel(shown, x, y) & 0xffffff) == (pixels[y * width + x] & 0xffffff);
+		}
+	}
+	XDestroyImage(shown);
+	return same;
+}
+
+// Returns whether every frame showed up right
+internal bool
+bench_present_path(X11_Window* x11, const char* label, int frames) {
+	static double present_ms[BENCH_PRESENT_MAX_FRAMES];
+	double ms_per_count = 1000.0 / (double)os_get_time_frequency();
+	for (int f = 0; f < frames; f++) {
+		// A menu screen, with the frame number in it so no two presents are the same
+		clear_screen(0x006400);
+		draw_text("PING PONG", -50, 40, 2, 0xffffff);
+		draw_number(f, 40, -20, 2.f, 0xff0000);
+		u64 begin = os_get_time_counter();
+		present_framebuffer(x11);
+		if (x11->use_shm) wait_for_shm_completion(x11);
+		else XSync(x11->display, False);
+		present_ms[f] = (os_get_time_counter() - begin) * ms_per_count;
+	}
+	bool shown = window_shows_framebuffer(x11);
+
+	double total_ms = 0;
+	for (int f = 0; f < frames; f++) total_ms += present_ms[f];
+	qsort(present_ms, frames, sizeof(double), compare_present_times);
+	double mean_ms = total_ms / frames;
+	double megabytes = (double)render_state.width * render_state.height * sizeof(u32) / (1024.0 * 1024.0);
+	printf("%-10s %4dx%-4d  mean %6.2fms  p50 %6.2fms  p99 %6.2fms  %7.0f MB/s%s\n", label, render_state.width, render_state.height,
+		mean_ms, present_ms[frames / 2], present_ms[frames * 99 / 100], megabytes * 1000.0 / mean_ms, shown ? "" : "  FAIL: window differs");
+	return shown;
+}
+
+internal int
+run_present_benchmark(int frames) {
+	const int resolutions[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+	bool all_shown = true;
+	for (int r = 0; r < (int)(sizeof(resolutions) / sizeof(resolutions[0])); r++) {
+		int width = resolutions[r][0], height = resolutions[r][1];
+		for (int shm = 1; shm >= 0; shm--) {
+			X11_Window* x11 = &x11_window;
+			*x11 = {};
+			if (!open_x11_window(x11, width, height, shm)) {
+				printf("could not open a %dx%d window with a 32 bit TrueColor visual\n", width, height);
+				return 1;
+			}
+
+			// Read back only works for the part of a window that is on screen
+			int screen = DefaultScreen(x11->display);
+			if (width > DisplayWidth(x11->display, screen) || height > DisplayHeight(x11->display, screen)) {
+				printf("%-10s %4dx%-4d  skipped, the screen is only %dx%d\n", shm ? "MIT-SHM" : "XPutImage", width, height,
+					DisplayWidth(x11->display, screen), DisplayHeight(x11->display, screen));
+			}
+			else if (shm && !x11->use_shm) printf("%-10s %4dx%-4d  skipped, no MIT-SHM on this display\n", "MIT-SHM", width, height);
+			else all_shown &= bench_present_path(x11, shm ? "MIT-SHM" : "XPutImage", frames);
+			close_x11_window(x11);
+		}
+	}
+	return all_shown ? 0 : 1;
+}
+
+// Entry Point for the X11 game
+int main(int argc, char** argv) {
+	int width = 1280, height = 720;
+	bool allow_shm = true;
+	bool bench_present = false;
+	int bench_frames = 120;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-w") && i + 1 < argc) width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-h") && i + 1 < argc) height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-no-shm")) allow_shm = false;
+		else if (!strcmp(argv[i], "-suspend") && i + 1 < argc) os_set_suspend_file(argv[++i]);
+		else if (!strcmp(argv[i], "-profiles") && i + 1 < argc) os_set_profile_file(argv[++i]);
+		else if (!strcmp(argv[i], "-bench-present")) bench_present = true;
+		else if (!strcmp(argv[i], "-frames") && i + 1 < argc) bench_frames = atoi(argv[++i]);
+	}
+	if (bench_frames < 1) bench_frames = 1;
+	if (bench_frames > BENCH_PRESENT_MAX_FRAMES) bench_frames = BENCH_PRESENT_MAX_FRAMES;
+	if (bench_present) return run_present_benchmark(bench_frames);
+
+	X11_Window* x11 = &x11_window;
+	if (!open_x11_window(x11, width, height, allow_shm)) {
+		printf("could not open a window: no display, or no 32 bit TrueColor visual\n");
+		return 1;
+	}
+	start_render_workers(-1);
+	resume_match();
+
+	Input input = {};
+	bool force_present = true;
+	bool screen_settled = false;
+	const float target_frame_time = 1.f / 60.f;  // No vsync through Xlib, so pace gameplay to 60 FPS
+	float delta_time = target_frame_time;
+	u64 start_time = os_get_time_counter();
+	u64 frame_begin_time = start_time;
+
+	while (running) {
+		// Nothing animates on a settled screen, so sleep until the server sends something
+		if (screen_settled) wait_for_x11_events(x11, -1);
+
+		begin_frame_memory(&game_memory);
+		begin_input_frame(&input);
+		force_present |= process_x11_events(x11, &input);
+
+		if (!screen_settled || any_button_changed(&input) || force_present) {
+			wait_for_shm_completion(x11);
+			bool frame_changed = simulate_game(&input, delta_time);
+			screen_settled = is_idle_gamemode() && !frame_changed;
+
+			bool presented = frame_changed || force_present;
+			if (presented) {
+				force_present = false;
+				u64 present_begin = os_get_time_counter();
+				present_framebuffer(x11);
+				u64 present_end = os_get_time_counter();
+				record_present(&x11->present_stats, present_begin, present_begin, present_end);
+				record_input_latency(&input_latency, input.event_times, input.event_count, present_end, os_get_time_frequency());
+			}
+			else record_unpresented_input(&input_latency, &input);
+		}
+
+		if (!screen_settled) sleep_until(frame_begin_time + (u64)(target_frame_time * os_get_time_frequency()));
+		u64 frame_end_time = os_get_time_counter();
+		delta_time = (float)(frame_end_time - frame_begin_time) / (float)os_get_time_frequency();
+		frame_begin_time = frame_end_time;
+
+		end_frame_memory(&game_memory);
+	}
+
+	// Closing the window mid-match keeps it for the next run
+	suspend_match();
+	stop_render_workers();
+	double wall_seconds = (double)(os_get_time_counter() - start_time) / (double)os_get_time_frequency();
+	char report[256];
+	format_memory_report(&game_memory, report, sizeof(report));
+	printf("%s\n", report);
+	format_profile_report(report, sizeof(report));
+	printf("%s\n", report);
+	format_present_report(&x11->present_stats, 0, wall_seconds, report, sizeof(report));
+	printf("%s (%s)\n", report, x11->use_shm ? "MIT-SHM" : "XPutImage");
+	close_x11_window(x11);
+	return 0;
+}
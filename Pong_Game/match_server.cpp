@@ -0,0 +1,259 @@
+// <------------------------- Match Server ---------------------------------------------->
+// A headless server hosts many matches at once, each its own Game_State stepped every netplay_dt with
+// the input its two players sent last. Players send one small input packet per tick and get back the
+// match as a snapshot delta against the newest state they acknowledged: the snapshot is quantized to
+// what a client draws, and the delta is XOR run length encoded like the rewind history, so a resting
+// paddle or an unchanged score costs nothing. A client that has acknowledged nothing recent gets the
+// whole snapshot. Shared by the server (linux_server.cpp) and its load generator (linux_loadgen.cpp).
+
+#define SERVER_MAGIC 0x50535256             // "PSRV"
+#define SERVER_MAX_MATCHES 65536
+#define SERVER_SNAPSHOT_RING 32             // Ticks of snapshots each side keeps to take deltas against, power of two
+#define SERVER_NO_BASE 0xffffffffu          // Base tick of a snapshot sent whole, and the ack before any state
+#define SERVER_FULL 0xffffffffu             // Match of a welcome when every match is taken
+#define SERVER_TIMEOUT_SECONDS 5            // A player not heard from for this long gives up their match
+
+enum Server_Message_Type {
+	SERVER_JOIN,
+	SERVER_WELCOME,
+	SERVER_INPUT,
+	SERVER_STATE,
+	SERVER_STATS_REQUEST,
+	SERVER_STATS,
+};
+
+struct Server_Header {
+	u32 magic;
+	u8 type;
+	u8 player;                              // 0 plays the right paddle, 1 the left one
+	u16 reserved;
+	u32 match;
+};
+
+// Sent until a welcome comes back, the nonce tells a repeated join from a new player
+struct Server_Join {
+	Server_Header header;
+	u32 nonce;
+};
+
+struct Server_Welcome {
+	Server_Header header;                   // The seat given, match SERVER_FULL when there was none
+	u32 nonce;
+};
+
+struct Server_Input {
+	Server_Header header;
+	u32 ack_tick;                           // Newest state decoded, deltas are taken against it
+	u8 bits;                                // Net_Input_Bits
+	u8 reserved[3];
+};
+
+// What a client needs to draw a tick, positions in 1/256 units and speeds in 1/64 units per second
+struct Match_Snapshot {
+	s16 paddle_px[2], paddle_py[2];
+	s16 ball_px, ball_py;
+	s16 ball_dpx, ball_dpy;
+	u8 score[2];
+	u8 matches_won[2];                      // Matches played to the end since the pair sat down
+};
+
+#define SERVER_MAX_DELTA (2 * sizeof(Match_Snapshot) + 2)     // Worst case of the run length encoding
+
+struct Server_State {
+	Server_Header header;
+	u32 tick;
+	u32 base_tick;                          // The snapshot the delta is against, SERVER_NO_BASE for zeros
+	u32 checksum;                           // Of the whole snapshot, so a client knows it decoded it right
+	u16 delta_size;
+	u8 delta[SERVER_MAX_DELTA];
+};
+
+#define SERVER_STATE_HEADER_SIZE offsetof(Server_State, delta)
+
+// ---------------- Tick Times -------------------------------------
+#define TICK_BUCKET_US 5
+#define TICK_BUCKETS 4000                   // Up to 20ms, anything slower lands in the last bucket
+
+struct Tick_Time_Stats {
+	u64 histogram[TICK_BUCKETS];
+	u64 count;
+	u64 max_us;
+};
+
+internal void
+record_tick_time(Tick_Time_Stats* stats, u64 us) {
+	stats->histogram[us / TICK_BUCKET_US < TICK_BUCKETS ? us / TICK_BUCKET_US : TICK_BUCKETS - 1]++;
+	stats->count++;
+	if (us > stats->max_us) stats->max_us = us;
+}
+
+// Upper edge of the bucket holding the given fraction of ticks, in microseconds
+internal u32
+tick_time_percentile_us(const Tick_Time_Stats* stats, float fraction) {
+	u64 target = (u64)(fraction * stats->count);
+	u64 seen = 0;
+	for (int b = 0; b < TICK_BUCKETS; b++) {
+		seen += stats->histogram[b];
+		if (seen > target) return (b + 1) * TICK_BUCKET_US;
+	}
+	return TICK_BUCKETS * TICK_BUCKET_US;
+}
+
+// Answer to a stats request, what the load generator reports
+struct Server_Stats {
+	Server_Header header;
+	u32 matches_playing;
+	u32 players;
+	u32 threads;
+	u32 tick_rate;
+	u64 ticks;
+	u64 late_ticks;                         // Ticks that started a whole period late
+	u32 tick_p50_us, tick_p99_us, tick_max_us;
+	float cpu_us_per_tick;                  // Summed over the threads, for the matches per core estimate
+	u64 packets_received, packets_sent;
+	u64 bytes_sent;
+	u64 joins_refused;
+	u64 timeouts;
+};
+
+// ---------------- Matches ----------------------------------------
+struct Server_Match {
+	Game_State state;
+	u32 tick;
+	u32 seed;
+	int players_joined;                     // The match is stepped once both are in
+	u32 nonce[2];
+	u8 input_bits[2];
+	u32 acked_tick[2];
+	u64 last_heard[2];                      // os_get_time_counter()
+	u8 matches_won[2];
+	Match_Snapshot snapshots[SERVER_SNAPSHOT_RING];     // Tick t at t % SERVER_SNAPSHOT_RING
+};
+
+internal s16
+quantize_snapshot_value(real value, float scale) {
+	float scaled = (float)value * scale;
+	return (s16)(scaled > 32767.f ? 32767.f : scaled < -32768.f ? -32768.f : scaled);
+}
+
+internal Match_Snapshot
+take_match_snapshot(const Server_Match* match) {
+	const Game_State* state = &match->state;
+	Match_Snapshot snapshot = {};
+	for (int p = 0; p < 2; p++) {
+		snapshot.paddle_px[p] = quantize_snapshot_value(state->paddles.px[p], 256.f);
+		snapshot.paddle_py[p] = quantize_snapshot_value(state->paddles.py[p], 256.f);
+		snapshot.score[p] = (u8)state->score[p];
+		snapshot.matches_won[p] = match->matches_won[p];
+	}
+	snapshot.ball_px = quantize_snapshot_value(state->balls.px[0], 256.f);
+	snapshot.ball_py = quantize_snapshot_value(state->balls.py[0], 256.f);
+	snapshot.ball_dpx = quantize_snapshot_value(state->balls.dpx[0], 64.f);
+	snapshot.ball_dpy = quantize_snapshot_value(state->balls.dpy[0], 64.f);
+	return snapshot;
+}
+
+internal u32
+checksum_match_snapshot(const Match_Snapshot* snapshot) {
+	u32 hash = 2166136261u;
+	const u8* bytes = (const u8*)snapshot;
+	for (u32 i = 0; i < sizeof(*snapshot); i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// A new match for the two seated players, the same as a netplay match: both human, no stats kept
+internal void
+start_server_match(Server_Match* match, u32 seed) {
+	init_match(&match->state);
+	match->state.random_state = seed | 1;
+	match->state.keeps_stats = false;
+	match->seed = seed;
+	match->snapshots[match->tick % SERVER_SNAPSHOT_RING] = take_match_snapshot(match);
+}
+
+// One tick with the players' latest inputs. A finished match is followed straight away by the next one
+internal void
+step_server_match(Server_Match* match) {
+	netplay_simulate_frame(&match->state, match->input_bits[0], match->input_bits[1]);
+	match->tick++;
+	if (match->state.which_player_won) {
+		match->matches_won[match->state.which_player_won == PLAYER_ONE ? 0 : 1]++;
+		start_server_match(match, match->seed * 2654435761u + 1);
+	}
+	else match->snapshots[match->tick % SERVER_SNAPSHOT_RING] = take_match_snapshot(match);
+}
+
+// Player's state packet for the current tick, returns its size
+internal int
+encode_server_state(const Server_Match* match, u32 match_index, int player, Server_State* packet) {
+	static const Match_Snapshot zero_snapshot = {};
+	const Match_Snapshot* current = &match->snapshots[match->tick % SERVER_SNAPSHOT_RING];
+	u32 acked = match->acked_tick[player];
+	bool has_base = acked != SERVER_NO_BASE && acked <= match->tick && match->tick - acked < SERVER_SNAPSHOT_RING;
+
+	packet->header = { SERVER_MAGIC, SERVER_STATE, (u8)player, 0, match_index };
+	packet->tick = match->tick;
+	packet->base_tick = has_base ? acked : SERVER_NO_BASE;
+	packet->checksum = checksum_match_snapshot(current);
+	const Match_Snapshot* base = has_base ? &match->snapshots[acked % SERVER_SNAPSHOT_RING] : &zero_snapshot;
+	packet->delta_size = (u16)encode_rewind_delta(packet->delta, (const u8*)current, (const u8*)base, sizeof(Match_Snapshot));
+	return (int)(SERVER_STATE_HEADER_SIZE + packet->delta_size);
+}
+
+// ---------------- Client View ------------------------------------
+// The client keeps the snapshots it decoded for as long as the server keeps them to delta against
+struct Server_View {
+	Match_Snapshot snapshots[SERVER_SNAPSHOT_RING];
+	u32 ticks[SERVER_SNAPSHOT_RING];        // Tick held by each slot, SERVER_NO_BASE when empty
+	u32 latest_tick;                        // SERVER_NO_BASE before the first state
+};
+
+internal void
+init_server_view(Server_View* view) {
+	for (int i = 0; i < SERVER_SNAPSHOT_RING; i++) view->ticks[i] = SERVER_NO_BASE;
+	view->latest_tick = SERVER_NO_BASE;
+}
+
+// False when the base is gone or the result does not match the checksum; a late (older) state is
+// decoded but does not become the latest
+internal bool
+decode_server_state(Server_View* view, const Server_State* packet, int size) {
+	if (size < (int)SERVER_STATE_HEADER_SIZE || packet->delta_size > SERVER_MAX_DELTA ||
+		size != (int)(SERVER_STATE_HEADER_SIZE + packet->delta_size)) return false;
+
+	Match_Snapshot snapshot = {};
+	if (packet->base_tick != SERVER_NO_BASE) {
+		int base_slot = packet->base_tick % SERVER_SNAPSHOT_RING;
+		if (view->ticks[base_slot] != packet->base_tick) return false;
+		snapshot = view->snapshots[base_slot];
+	}
+	apply_rewind_delta((u8*)&snapshot, packet->delta, packet->delta_size);
+	if (checksum_match_snapshot(&snapshot) != packet->checksum) return false;
+
+	int slot = packet->tick % SERVER_SNAPSHOT_RING;
+	view->snapshots[slot] = snapshot;
+	view->ticks[slot] = packet->tick;
+	if (view->latest_tick == SERVER_NO_BASE || (s32)(packet->tick - view->latest_tick) > 0) view->latest_tick = packet->tick;
+	return true;
+}
+
+internal const Match_Snapshot*
+latest_server_snapshot(const Server_View* view) {
+	return view->latest_tick == SERVER_NO_BASE ? 0 : &view->snapshots[view->latest_tick % SERVER_SNAPSHOT_RING];
+}
+
+// One line summary of a server's stats, printed by the server at exit and by the load generator
+internal int
+format_server_stats(const Server_Stats* stats, char* buffer, int size) {
+	float tick_us = 1000000.f / stats->tick_rate;
+	float matches_per_core = stats->cpu_us_per_tick > 0 ? stats->matches_playing * tick_us / stats->cpu_us_per_tick : 0.f;
+	return snprintf(buffer, size, "server: %u matches playing, %u players, %u threads, %llu ticks at %u Hz (%llu late), tick p50 %uus, p99 %uus, max %uus, "
+		"cpu %.1fus per tick, about %.0f matches per core, %llu packets in, %llu out (%.1f bytes each), %llu joins refused, %llu timeouts",
+		stats->matches_playing, stats->players, stats->threads, stats->ticks, stats->tick_rate, stats->late_ticks,
+		stats->tick_p50_us, stats->tick_p99_us, stats->tick_max_us, stats->cpu_us_per_tick, matches_per_core,
+		stats->packets_received, stats->packets_sent, stats->packets_sent ? (double)stats->bytes_sent / stats->packets_sent : 0.0,
+		stats->joins_refused, stats->timeouts);
+}
@@ -17,9 +17,25 @@ move_hot_button(Input* input, int num_of_options, int& hot_menu_button, Button_K
 	}
 }
 
+#define LEADERBOARD_ROWS 5
+#define LEADERBOARD_NAME_LENGTH 14
+
+// A profile's name as the font can draw it: upper case letters, dots and spaces, cut to fit a row
+internal void
+get_leaderboard_name(const Profile_Record* record, char* name) {
+	int length = 0;
+	for (; length < LEADERBOARD_NAME_LENGTH && length < PROFILE_NAME_SIZE && record->name[length]; length++) {
+		char c = record->name[length];
+		if (c >= 'a' && c <= 'z') c += 'A' - 'a';
+		name[length] = (c >= 'A' && c <= 'Z') || c == '.' ? c : ' ';
+	}
+	name[length] = 0;
+}
+
 internal void
 manage_menu(Input* input) {
-	clear_screen(0x006400);
+	if (animated_menu_background) draw_procedural_background(menu_background_time);
+	else clear_screen(0x006400);
 
 	// Main Menu
 	if (current_menumode == MN_MAIN) {
@@ -71,15 +87,23 @@ manage_menu(Input* input) {
 			current_menumode = MN_MAIN;
 		}
 
-		// Navigation between the two options
-		move_hot_button(input, 2, hot_gameplay_button, BUTTON_LEFT, BUTTON_RIGHT);
+		// Navigation between the three options
+		move_hot_button(input, 3, hot_gameplay_button, BUTTON_LEFT, BUTTON_RIGHT);
 
 		// Select gamemode to enter gameplay
 		if (pressed(BUTTON_ENTER)) {
-			current_gamemode = GM_GAMEPLAY;
-			save_data.stats[NUM_OF_MATCHES1]++;                      // Entry point for GM_GAMEPLAY so increase stats here
 			is_player2_ai = hot_gameplay_button ? 0 : 1;
-			if (!is_player2_ai) save_data.stats[NUM_OF_MATCHES2]++;  // If Player 2 is not AI, increase the stats here
+			init_match(&game_state);                                     // Paddles pick up the AI choice above
+			start_fade(.3f);
+
+			if (hot_gameplay_button == 2) {
+				current_gamemode = GM_STRESS;                            // Stress test keeps no stats
+			}
+			else {
+				current_gamemode = GM_GAMEPLAY;
+				save_data.stats[NUM_OF_MATCHES1]++;                      // Entry point for GM_GAMEPLAY so increase stats here
+				if (!is_player2_ai) save_data.stats[NUM_OF_MATCHES2]++;  // If Player 2 is not AI, increase the stats here
+			}
 		}
 
 		// Single Player Selected
@@ -88,13 +112,24 @@ manage_menu(Input* input) {
 			draw_text("SINGLE PLAYER", -80, -9, 1, 0xff0000);
 
 			draw_text("MULTIPLAYER", 20, -10, 1, 0xffffff);
+			draw_text("STRESS TEST", -33, -30, 1, 0xffffff);
 		}
 		// Multiplayer Selected
-		else {
+		else if (hot_gameplay_button == 1) {
 			draw_text("SINGLE PLAYER", -80, -10, 1, 0xffffff);
 
 			draw_rect(52, -12, 37, 8, 0x000000);
 			draw_text("MULTIPLAYER", 20, -9, 1, 0xff0000);
+
+			draw_text("STRESS TEST", -33, -30, 1, 0xffffff);
+		}
+		// Stress Test Selected
+		else {
+			draw_text("SINGLE PLAYER", -80, -10, 1, 0xffffff);
+			draw_text("MULTIPLAYER", 20, -10, 1, 0xffffff);
+
+			draw_rect(-1, -32, 37, 8, 0x000000);
+			draw_text("STRESS TEST", -33, -29, 1, 0xff0000);
 		}
 	}
 
@@ -109,11 +144,11 @@ manage_menu(Input* input) {
 		// Stats Menu Header
 		draw_rect(0, 37, 48, 8, 0x000000);
 
-		// Navigate between Player 1 stats and Player 2 stats
-		move_hot_button(input, 2, view_stats_menu, BUTTON_UP, BUTTON_DOWN);
+		// Navigate between Player 1 stats, Player 2 stats and the leaderboard
+		move_hot_button(input, 3, view_stats_menu, BUTTON_UP, BUTTON_DOWN);
 
 		// Common Text to be rendered
-		{
+		if (view_stats_menu < 2) {
 			draw_text("MATCHES PLAYED", -80, 20, 0.75, 0xffffff);
 			draw_text("MATCHES WON", -80, 5, 0.75, 0xffffff);
 			draw_text("MATCHES LOST", -80, -10, 0.75, 0xffffff);
@@ -142,7 +177,7 @@ manage_menu(Input* input) {
 		}
 
 		// View Stats for Player 2
-		else {
+		else if (view_stats_menu == 1) {
 			draw_text("PLAYER II STATS", -43, 40, 1, 0xffffff);
 
 			// Matches played by Player 2
@@ -160,6 +195,43 @@ manage_menu(Input* input) {
 			// Points lost by Player 2
 			draw_number(save_data.stats[POINTS_LOST2], 0, -42, 1.2, 0xff0000);
 		}
+
+		// Leaderboard of every profile: Enter changes what it ranks by, Left and Right turn its pages
+		else {
+			const char* ranking_names[RANKING_COUNT] = { "BY WINS", "BY WIN RATE", "BY POINTS" };
+			draw_text("LEADERBOARD", -33, 40, 1, 0xffffff);
+			const char* ranking_name = ranking_names[leaderboard_ranking];
+			draw_text(ranking_name, -1.5f * strlen(ranking_name), 27, 0.5, 0xffff00);
+
+			if (pressed(BUTTON_ENTER)) {
+				leaderboard_ranking = (Profile_Ranking)((leaderboard_ranking + 1) % RANKING_COUNT);
+				leaderboard_first = 0;
+			}
+
+			Profile_Store* store = get_profile_store();
+			if (!store) draw_text(profile_store_error, -2.25f * strlen(profile_store_error), 0, 0.75, 0xff0000);
+			else if (!store->count) draw_text("NO PROFILES", -33, 0, 1, 0xffffff);
+			else {
+				if (pressed(BUTTON_RIGHT) && leaderboard_first + LEADERBOARD_ROWS < store->count) leaderboard_first += LEADERBOARD_ROWS;
+				if (pressed(BUTTON_LEFT) && leaderboard_first >= LEADERBOARD_ROWS) leaderboard_first -= LEADERBOARD_ROWS;
+
+				Leaderboard_Row rows[LEADERBOARD_ROWS];
+				int row_count = query_leaderboard(store, leaderboard_ranking, leaderboard_first, rows, LEADERBOARD_ROWS);
+				for (int i = 0; i < row_count; i++) {
+					float y = 20.f - 15.f * i;
+					const u32* stats = rows[i].record.stats;
+					int value = stats[PROFILE_POINTS_SCORED];
+					if (leaderboard_ranking == RANK_BY_WINS) value = stats[PROFILE_WON];
+					else if (leaderboard_ranking == RANK_BY_WIN_RATE) value = stats[PROFILE_MATCHES] ? 100 * stats[PROFILE_WON] / stats[PROFILE_MATCHES] : 0;
+
+					char name[LEADERBOARD_NAME_LENGTH + 1];
+					get_leaderboard_name(&rows[i].record, name);
+					draw_number(rows[i].rank + 1, -65, y - 2, 1.2, 0xffffff);
+					draw_text(name, -55, y, 0.75, 0xffffff);
+					draw_number(value, 80, y - 2, 1.2, 0xff0000);
+				}
+			}
+		}
 	}
 
 	// Quit Menu
@@ -0,0 +1,332 @@
+// <------------------------- Rollback Netplay ---------------------------------------->
+// Two peers each own one paddle and only exchange their inputs over UDP. A remote input that has
+// not arrived yet is predicted (the remote player keeps doing what they last did) so the game never
+// waits on the network. The state is snapshotted before every tick, and when a late input shows a
+// prediction was wrong the game rolls back to that frame's snapshot and re-simulates to the present.
+
+#define NETPLAY_MAX_ROLLBACK 16         // Hard cap on the configurable rollback window
+#define NETPLAY_MAX_INPUT_DELAY 8
+#define NETPLAY_RING 128                // Frames of inputs and snapshots kept, well over a rollback window plus input delay on both peers
+#define NETPLAY_PACKET_INPUTS 56        // Unacked inputs are resent, enough to cover 2 * (delay + window + 1) frames of ack lag
+#define NETPLAY_DELAY_QUEUE 128
+#define NETPLAY_MAGIC 0x504f4e47        // "PONG"
+
+const float netplay_dt = 1.f / 60.f;   // Both peers must tick with the same fixed step
+
+// One byte per player per frame
+enum Net_Input_Bits {
+	NET_UP = 1,
+	NET_DOWN = 2,
+	NET_LEFT = 4,
+	NET_RIGHT = 8,
+};
+
+struct Netplay_Config {
+	u16 local_port;
+	const char* remote_host;
+	u16 remote_port;
+	int local_player;                   // 0 plays the right paddle (player 1), 1 the left one
+	u32 seed;                           // Both peers must agree on it
+	int input_delay;                    // Frames between sampling a local input and simulating it
+	int max_rollback;                   // Furthest the simulation may run ahead of confirmed remote input
+
+	// Injected network conditions on our outgoing packets
+	int latency_ms;
+	int jitter_ms;
+	int loss_percent;
+};
+
+struct Net_Packet {
+	u32 magic;
+	u32 send_time_ms;                   // Sender's clock, echoed back for the round trip time
+	u32 echo_time_ms;
+	s32 ack_frame;                      // Sender has all of our inputs up to this frame
+	s32 first_frame;                    // Frame of inputs[0]
+	u8 input_count;
+	u8 inputs[NETPLAY_PACKET_INPUTS];
+};
+
+struct Delayed_Packet {
+	bool used;
+	u64 release_time;
+	Net_Packet packet;
+};
+
+struct Netplay_Session {
+	bool active;
+	Netplay_Config config;
+
+	s32 current_frame;                  // Next frame to simulate
+	s32 local_input_frame;              // Latest frame we have a local input for
+	s32 remote_confirmed_frame;         // All remote inputs up to this frame have arrived
+	s32 remote_ack_frame;               // Remote has all of our inputs up to this frame
+	s32 rollback_frame;                 // Earliest mispredicted frame, current_frame when there is none
+
+	u8 local_inputs[NETPLAY_RING];
+	u8 remote_inputs[NETPLAY_RING];
+	s32 remote_input_frame[NETPLAY_RING];   // Frame held by each remote_inputs slot, -1 when empty
+	u8 used_remote_inputs[NETPLAY_RING];    // Input (actual or predicted) the frame was last simulated with
+	Game_State snapshots[NETPLAY_RING];     // State before simulating the frame
+
+	float time_accumulator;             // Frame time not yet consumed by fixed ticks
+
+	Delayed_Packet delay_queue[NETPLAY_DELAY_QUEUE];
+	u32 random_state;
+	u32 last_remote_send_time_ms;
+	float rtt_ms;
+
+	// Rollback stats
+	u64 rollbacks;
+	u64 frames_resimulated;
+	u64 resimulation_time;              // os_get_time_counter() units
+	s32 max_rollback_frames;
+	u64 max_rollback_time;
+	u64 stalled_ticks;
+	u64 packets_sent, packets_dropped, packets_received;
+};
+
+Netplay_Session netplay_session = {};
+
+internal u32
+netplay_time_ms() {
+	return (u32)(os_get_time_counter() * 1000 / os_get_time_frequency());
+}
+
+internal u8
+net_input_bits(Input* input, Button_Key up, Button_Key down, Button_Key left, Button_Key right) {
+	u8 bits = 0;
+	if (is_down(up)) bits |= NET_UP;
+	if (is_down(down)) bits |= NET_DOWN;
+	if (is_down(left)) bits |= NET_LEFT;
+	if (is_down(right)) bits |= NET_RIGHT;
+	return bits;
+}
+
+// The local player may use either the arrow keys or WASD, whichever paddle they own
+internal u8
+sample_local_net_input(Input* input) {
+	return net_input_bits(input, BUTTON_UP, BUTTON_DOWN, BUTTON_LEFT, BUTTON_RIGHT) |
+		net_input_bits(input, BUTTON_W, BUTTON_S, BUTTON_A, BUTTON_D);
+}
+
+// One fixed tick of the match with both players' inputs
+internal void
+netplay_simulate_frame(Game_State* state, u8 player1_bits, u8 player2_bits) {
+	Input frame_input = {};
+	u8 bits[2] = { player1_bits, player2_bits };
+	for (int p = 0; p < 2; p++) {
+		frame_input.buttons[state->paddle_traits.key_up[p]].is_down = bits[p] & NET_UP;
+		frame_input.buttons[state->paddle_traits.key_down[p]].is_down = bits[p] & NET_DOWN;
+		frame_input.buttons[state->paddle_traits.key_left[p]].is_down = bits[p] & NET_LEFT;
+		frame_input.buttons[state->paddle_traits.key_right[p]].is_down = bits[p] & NET_RIGHT;
+	}
+	simulate_gameplay(state, &frame_input, netplay_dt);
+}
+
+// Remote input to simulate frame with: the real one if it arrived, otherwise the last confirmed one
+internal u8
+netplay_remote_input(Netplay_Session* session, s32 frame) {
+	int slot = frame % NETPLAY_RING;
+	if (session->remote_input_frame[slot] == frame) return session->remote_inputs[slot];
+	if (session->remote_confirmed_frame < 0) return 0;
+	return session->remote_inputs[session->remote_confirmed_frame % NETPLAY_RING];
+}
+
+internal void
+netplay_advance_frame(Netplay_Session* session, Game_State* state) {
+	s32 frame = session->current_frame;
+	int slot = frame % NETPLAY_RING;
+	u8 local = session->local_inputs[slot];
+	u8 remote = netplay_remote_input(session, frame);
+
+	session->snapshots[slot] = *state;
+	session->used_remote_inputs[slot] = remote;
+	if (session->config.local_player == 0) netplay_simulate_frame(state, local, remote);
+	else netplay_simulate_frame(state, remote, local);
+	session->current_frame++;
+}
+
+internal bool
+start_netplay(Netplay_Session* session, Game_State* state, Netplay_Config config) {
+	*session = {};
+	config.input_delay = clamp(0, config.input_delay, NETPLAY_MAX_INPUT_DELAY);
+	config.max_rollback = clamp(1, config.max_rollback, NETPLAY_MAX_ROLLBACK);
+	session->config = config;
+	if (!os_udp_open(config.local_port, config.remote_host, config.remote_port)) return false;
+
+	session->active = true;
+	session->local_input_frame = config.input_delay - 1;    // Frames before the delay run with no input
+	session->remote_confirmed_frame = -1;
+	session->remote_ack_frame = -1;
+	session->random_state = (u32)os_get_time_counter() | 1;
+	for (int i = 0; i < NETPLAY_RING; i++) {
+		session->remote_input_frame[i] = -1;
+	}
+
+	// Both sides human, same serves on both peers, and predicted points must not reach save_data
+	is_player1_ai = false;
+	is_player2_ai = false;
+	init_match(state);
+	state->random_state = config.seed | 1;
+	state->keeps_stats = false;
+	return true;
+}
+
+internal void
+stop_netplay(Netplay_Session* session) {
+	if (session->active) os_udp_close();
+	session->active = false;
+}
+
+// Sends (or holds back to fake latency, or drops) a packet with our unacknowledged inputs
+internal void
+netplay_send_inputs(Netplay_Session* session) {
+	Net_Packet packet = {};
+	packet.magic = NETPLAY_MAGIC;
+	packet.send_time_ms = netplay_time_ms();
+	packet.echo_time_ms = session->last_remote_send_time_ms;
+	packet.ack_frame = session->remote_confirmed_frame;
+
+	s32 first = session->remote_ack_frame + 1;
+	if (first < session->local_input_frame - NETPLAY_PACKET_INPUTS + 1) first = session->local_input_frame - NETPLAY_PACKET_INPUTS + 1;
+	if (first < 0) first = 0;
+	packet.first_frame = first;
+	for (s32 f = first; f <= session->local_input_frame; f++) {
+		packet.inputs[packet.input_count++] = session->local_inputs[f % NETPLAY_RING];
+	}
+
+	session->packets_sent++;
+	const Netplay_Config* config = &session->config;
+	if ((int)(random_u32(&session->random_state) % 100) < config->loss_percent) {
+		session->packets_dropped++;
+		return;
+	}
+
+	int delay_ms = config->latency_ms;
+	if (config->jitter_ms > 0) delay_ms += random_u32(&session->random_state) % (config->jitter_ms + 1);
+	if (delay_ms <= 0) {
+		os_udp_send(&packet, sizeof(packet));
+		return;
+	}
+
+	for (int i = 0; i < NETPLAY_DELAY_QUEUE; i++) {
+		Delayed_Packet* delayed = &session->delay_queue[i];
+		if (!delayed->used) {
+			delayed->used = true;
+			delayed->release_time = os_get_time_counter() + os_get_time_frequency() * delay_ms / 1000;
+			delayed->packet = packet;
+			return;
+		}
+	}
+	os_udp_send(&packet, sizeof(packet));     // Queue full, send it now
+}
+
+internal void
+netplay_receive_inputs(Netplay_Session* session) {
+	// Release held back packets whose fake latency has passed
+	u64 now = os_get_time_counter();
+	for (int i = 0; i < NETPLAY_DELAY_QUEUE; i++) {
+		Delayed_Packet* delayed = &session->delay_queue[i];
+		if (delayed->used && delayed->release_time <= now) {
+			os_udp_send(&delayed->packet, sizeof(delayed->packet));
+			delayed->used = false;
+		}
+	}
+
+	Net_Packet packet;
+	while (os_udp_receive(&packet, sizeof(packet)) == (int)sizeof(packet)) {
+		if (packet.magic != NETPLAY_MAGIC || packet.input_count > NETPLAY_PACKET_INPUTS) continue;
+		session->packets_received++;
+
+		if (packet.ack_frame > session->remote_ack_frame) session->remote_ack_frame = packet.ack_frame;
+		session->last_remote_send_time_ms = packet.send_time_ms;
+		if (packet.echo_time_ms) session->rtt_ms = (float)(netplay_time_ms() - packet.echo_time_ms);
+
+		for (int i = 0; i < packet.input_count; i++) {
+			s32 frame = packet.first_frame + i;
+			if (frame <= session->remote_confirmed_frame) continue;           // Already have it
+			if (frame > session->remote_confirmed_frame + NETPLAY_RING / 2) continue;   // Too far ahead to hold, it gets resent
+
+			int slot = frame % NETPLAY_RING;
+			session->remote_inputs[slot] = packet.inputs[i];
+			session->remote_input_frame[slot] = frame;
+
+			// Already simulated with a prediction that turned out wrong
+			if (frame < session->current_frame && session->used_remote_inputs[slot] != packet.inputs[i] &&
+				frame < session->rollback_frame) {
+				session->rollback_frame = frame;
+			}
+		}
+
+		while (session->remote_input_frame[(session->remote_confirmed_frame + 1) % NETPLAY_RING] == session->remote_confirmed_frame + 1) {
+			session->remote_confirmed_frame++;
+		}
+	}
+}
+
+// Restores the snapshot of the earliest mispredicted frame and re-simulates up to the present
+internal void
+netplay_rollback(Netplay_Session* session, Game_State* state) {
+	s32 target = session->current_frame;
+	s32 frame = session->rollback_frame;
+	if (frame >= target) return;
+
+	u64 begin = os_get_time_counter();
+	*state = session->snapshots[frame % NETPLAY_RING];
+	session->current_frame = frame;
+	sound_muted++;                      // These frames were heard the first time round
+	while (session->current_frame < target) {
+		netplay_advance_frame(session, state);
+	}
+	sound_muted--;
+	u64 elapsed = os_get_time_counter() - begin;
+
+	session->rollbacks++;
+	session->frames_resimulated += target - frame;
+	session->resimulation_time += elapsed;
+	if (target - frame > session->max_rollback_frames) session->max_rollback_frames = target - frame;
+	if (elapsed > session->max_rollback_time) session->max_rollback_time = elapsed;
+}
+
+// One fixed tick: exchange inputs, fix mispredictions, then simulate the next frame unless the
+// remote is too far behind (or advance is false, which only keeps the connection serviced)
+internal void
+netplay_tick(Netplay_Session* session, Game_State* state, u8 local_bits, bool advance) {
+	session->rollback_frame = session->current_frame;
+	netplay_receive_inputs(session);
+	netplay_rollback(session, state);
+
+	if (advance) {
+		if (session->current_frame - session->remote_confirmed_frame > session->config.max_rollback) {
+			session->stalled_ticks++;
+		}
+		else {
+			session->local_input_frame = session->current_frame + session->config.input_delay;
+			session->local_inputs[session->local_input_frame % NETPLAY_RING] = local_bits;
+			netplay_advance_frame(session, state);
+		}
+	}
+
+	netplay_send_inputs(session);
+}
+
+// The state is final once every remote input before the current frame has arrived
+internal bool
+netplay_is_confirmed(Netplay_Session* session) {
+	return session->remote_confirmed_frame >= session->current_frame - 1;
+}
+
+// FNV-1a over the simulated fields, equal on both peers when they are in sync
+internal u64
+checksum_game_state(const Game_State* state) {
+	u64 hash = 14695981039346656037ull;
+	const u8* parts[] = { (const u8*)&state->paddles, (const u8*)&state->balls, (const u8*)state->score, (const u8*)&state->random_state };
+	const int sizes[] = { sizeof(state->paddles), sizeof(state->balls), sizeof(state->score), sizeof(state->random_state) };
+	for (int part = 0; part < 4; part++) {
+		for (int i = 0; i < sizes[part]; i++) {
+			hash ^= parts[part][i];
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
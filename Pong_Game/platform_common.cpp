@@ -1,8 +1,11 @@
 
 // ---------------- Key State Management --------------------------------
+// Every transition within a frame is counted, so a tap shorter than a frame still shows up as
+// a press and a release (half_transition_count == 2) instead of being lost
 struct Button_State {
 	bool is_down;
-	bool changed;
+	int half_transition_count;          // Downs and ups since the start of the frame
+	u64 transition_time;                // os_get_time_counter() when the last transition arrived
 };
 
 // ----------------- Keyboard Controls ----------------------------------
@@ -27,10 +30,44 @@ enum Button_Key {
 
 // ---------------- Key State Storage -----------------------------------
 // Struct to keep track of the inputs using an array of type Button_State
+#define MAX_INPUT_EVENTS 64
+
 struct Input {
 	Button_State buttons[BUTTON_COUNT];
+
+	// Arrival times of this frame's transitions, for the input-to-present latency stats
+	u64 event_times[MAX_INPUT_EVENTS];
+	int event_count;
 };
 
+// Start of a frame: keep the held state, forget last frame's transitions
+internal void
+begin_input_frame(Input* input) {
+	for (int i = 0; i < BUTTON_COUNT; i++) {
+		input->buttons[i].half_transition_count = 0;
+	}
+	input->event_count = 0;
+}
+
+// Records a key going down or up at time; repeats of the current state are not transitions
+internal void
+process_button_transition(Input* input, int b, bool is_down, u64 time) {
+	Button_State* button = &input->buttons[b];
+	if (button->is_down == is_down) return;
+	button->is_down = is_down;
+	button->half_transition_count++;
+	button->transition_time = time;
+	if (input->event_count < MAX_INPUT_EVENTS) input->event_times[input->event_count++] = time;
+}
+
+internal bool
+any_button_changed(Input* input) {
+	for (int i = 0; i < BUTTON_COUNT; i++) {
+		if (input->buttons[i].half_transition_count) return true;
+	}
+	return false;
+}
+
 // <------------------------- Key State Checker Macros -------------------------------->
 
 // Button b is down if the Button_State in buttons array at index b has is_down == true
@@ -38,11 +75,127 @@ struct Input {
 // is_down() can be used to check if the key is being pressed continuously
 #define is_down(b) input->buttons[b].is_down
 
-// Button b is pressed if it is currently down and has changed from the previous frame
+// Button b is pressed if it went down at some point in the current frame: it ends the frame down after
+// a transition, or it went down and back up within the frame (two or more half transitions)
 // pressed() can be used to check if the key was pressed in the current frame or not
-#define pressed(b) (input->buttons[b].is_down && input->buttons[b].changed)
+#define pressed(b) (input->buttons[b].half_transition_count > 1 || (input->buttons[b].half_transition_count == 1 && input->buttons[b].is_down))
 
-// Button b is released if it is currently up (not down) and has changed from the previous frame
+// Button b is released if it went up at some point in the current frame, the mirror of pressed()
 // released() can be used to check if the key was released in the current frame or not
-#define released(b) (!input->buttons[b].is_down && input->buttons[b].changed)
+#define released(b) (input->buttons[b].half_transition_count > 1 || (input->buttons[b].half_transition_count == 1 && !input->buttons[b].is_down))
 // <----------------------------------------------------------------------------------->
+
+// ---------------- Platform File Data ----------------------------------
+// Buffer returned by the os_ file helpers that each platform layer implements
+struct {
+	char* data;
+	unsigned int size;
+} typedef String;
+
+// ---------------- Memory Arenas ---------------------------------------
+// The platform reserves one block at startup and splits it in two: the permanent arena holds what
+// lives as long as the program (the framebuffer), the transient arena is emptied at the start of
+// every frame (file reads). Nothing is freed piece by piece, so frames never call the OS allocator.
+#include <assert.h>
+#include <stddef.h>
+
+struct Memory_Arena {
+	u8* base;
+	size_t size;
+	size_t used;
+	size_t high_water;                  // Most ever used at once
+};
+
+struct Game_Memory {
+	Memory_Arena permanent;
+	Memory_Arena transient;
+	u64 frame_allocation_start;         // os_allocation_count when the frame began
+	u64 allocating_frames;              // Frames that called the OS allocator, counted in release builds too
+};
+
+global_variable Game_Memory game_memory;
+global_variable u64 os_allocation_count;    // Calls into the OS allocator, counted by each platform's os_ functions
+
+internal void
+init_game_memory(Game_Memory* memory, void* block, size_t permanent_size, size_t transient_size) {
+	*memory = {};
+	memory->permanent.base = (u8*)block;
+	memory->permanent.size = permanent_size;
+	memory->transient.base = (u8*)block + permanent_size;
+	memory->transient.size = transient_size;
+}
+
+// 16 byte aligned for the SIMD kernels, 0 when the arena is full
+internal void*
+push_size(Memory_Arena* arena, size_t size) {
+	size_t start = (arena->used + 15) & ~(size_t)15;
+	if (start + size > arena->size) {
+		assert(!"memory arena is full");
+		return 0;
+	}
+	arena->used = start + size;
+	if (arena->used > arena->high_water) arena->high_water = arena->used;
+	return arena->base + start;
+}
+
+#define push_array(arena, type, count) (type*)push_size(arena, sizeof(type) * (count))
+
+// Frames bracket their work with these: the transient arena starts empty, and debug builds check
+// that the frame made no OS allocations
+internal void
+begin_frame_memory(Game_Memory* memory) {
+	memory->transient.used = 0;
+	memory->frame_allocation_start = os_allocation_count;
+}
+
+internal void
+end_frame_memory(Game_Memory* memory) {
+	if (os_allocation_count != memory->frame_allocation_start) memory->allocating_frames++;
+	assert(!memory->allocating_frames && "a steady state frame allocated from the OS");
+}
+
+// One line summary for the platform to print at exit
+internal int
+format_memory_report(const Game_Memory* memory, char* buffer, int size) {
+	return snprintf(buffer, size, "memory: permanent %zu KB of %zu KB, transient peak %zu KB of %zu KB, %llu OS allocations, %llu frames allocated",
+		memory->permanent.high_water / 1024, memory->permanent.size / 1024,
+		memory->transient.high_water / 1024, memory->transient.size / 1024, (unsigned long long)os_allocation_count,
+		(unsigned long long)memory->allocating_frames);
+}
+
+// ---------------- Game Module Interface -------------------------------
+// Hot-reload builds put the game in a shared library (game_module.cpp) that a host (linux_host.cpp)
+// loads and calls through these entry points. The os_ services the game needs go the other way,
+// through the Platform_Api the host attaches.
+struct Framebuffer {
+	int width, height;
+	void* memory;
+};
+
+struct Platform_Api {
+	String (*read_save_file)(Memory_Arena* arena);
+	int (*write_save_file)(String data);
+	String (*read_suspend_file)(Memory_Arena* arena);
+	int (*write_suspend_file)(String data);
+	int (*read_profile_file)(void* buffer, u64 offset, u32 size);
+	int (*write_profile_file)(const void* data, u64 offset, u32 size);
+	u64 (*get_time_counter)();
+	u64 (*get_time_frequency)();
+	bool (*udp_open)(u16 local_port, const char* remote_host, u16 remote_port);
+	void (*udp_close)();
+	void (*udp_send)(const void* data, int size);
+	int (*udp_receive)(void* buffer, int max_size);
+};
+
+// Called after every load, state holds what detach_game() saved from the previous module (size 0 on
+// the first load). Returns how many pieces of saved state did not fit the new module and were reset.
+#define ATTACH_GAME(name) int name(Platform_Api* api, const void* state, size_t state_size)
+typedef ATTACH_GAME(Attach_Game);
+
+// Called before unloading, saves the game's state for the next module, returns its size (0 if it does not fit)
+#define DETACH_GAME(name) size_t name(void* state, size_t capacity)
+typedef DETACH_GAME(Detach_Game);
+
+// One frame, returns false once the player has quit
+#define UPDATE_AND_RENDER(name) bool name(Game_Memory* memory, Input* input, float dt, Framebuffer* framebuffer)
+typedef UPDATE_AND_RENDER(Update_And_Render);
@@ -0,0 +1,109 @@
+// <------------------------- Present Pipeline ----------------------------------------->
+// In pipelined mode the game thread no longer presents. It draws frame N + 1 into one of three
+// framebuffers while a present thread shows frame N from another, and the third holds the newest
+// finished frame between them. A buffer changes hands with one atomic exchange of buffer indices,
+// so neither thread waits for the other: a slow present means some frames are never shown, never
+// that the next tick is simulated late. Shared by the platform layers, which own the present thread,
+// its wake-up signal and how a frame gets on screen.
+#include <atomic>
+
+#define PRESENT_BUFFER_COUNT 3
+#define PRESENT_FRESH 0x4                   // In ready while it holds a frame not taken yet
+
+struct Present_Frame {
+	u32* pixels;
+	int width, height;
+	u64 drawn_time;                         // os_get_time_counter() when the game finished it
+	u64 event_times[MAX_INPUT_EVENTS];      // Arrival of the key transitions it is the first to show
+	int event_count;
+};
+
+// Kept the same way by the serial loop, so the two modes can be compared
+struct Present_Stats {
+	u64 frames;
+	u64 total_present_time;                 // os_get_time_counter() units
+	u64 max_present_time;
+	u64 total_latency;                      // From drawn to presented
+	u64 max_latency;
+};
+
+struct Present_Pipeline {
+	Present_Frame frames[PRESENT_BUFFER_COUNT];
+	int drawing;                            // Game thread's buffer
+	int showing;                            // Present thread's buffer
+	alignas(64) std::atomic<u32> ready;     // The buffer in between
+	u64 frames_published;                   // Game thread
+	u64 frames_replaced;                    // Game thread, published over a frame that was never taken
+	alignas(64) Present_Stats stats;        // Present thread
+};
+
+// first is the framebuffer the game already draws into, the other two come from the arena
+internal bool
+init_present_pipeline(Present_Pipeline* pipeline, void* first, Memory_Arena* arena, size_t framebuffer_size) {
+	pipeline->frames[0].pixels = (u32*)first;
+	for (int i = 1; i < PRESENT_BUFFER_COUNT; i++) {
+		pipeline->frames[i].pixels = (u32*)push_size(arena, framebuffer_size);
+		if (!pipeline->frames[i].pixels) return false;
+	}
+	pipeline->drawing = 0;
+	pipeline->ready.store(1, std::memory_order_relaxed);
+	pipeline->showing = 2;
+	return true;
+}
+
+// Game thread: hands over the frame just drawn with the key transitions it simulated, returns the
+// buffer to draw the next one into. A frame replaced before it was shown keeps its transitions, and
+// the next frame published in its buffer carries them on to the screen.
+internal u32*
+publish_present_frame(Present_Pipeline* pipeline, int width, int height, const Input* input) {
+	Present_Frame* frame = &pipeline->frames[pipeline->drawing];
+	frame->width = width;
+	frame->height = height;
+	frame->drawn_time = os_get_time_counter();
+	for (int e = 0; e < input->event_count && frame->event_count < MAX_INPUT_EVENTS; e++) {
+		frame->event_times[frame->event_count++] = input->event_times[e];
+	}
+
+	u32 previous = pipeline->ready.exchange(pipeline->drawing | PRESENT_FRESH, std::memory_order_acq_rel);
+	pipeline->drawing = previous & ~PRESENT_FRESH;
+	pipeline->frames_published++;
+	if (previous & PRESENT_FRESH) pipeline->frames_replaced++;
+	else pipeline->frames[pipeline->drawing].event_count = 0;
+	return pipeline->frames[pipeline->drawing].pixels;
+}
+
+// Present thread: the newest frame it has not shown, 0 when there is none
+internal Present_Frame*
+take_present_frame(Present_Pipeline* pipeline) {
+	if (!(pipeline->ready.load(std::memory_order_acquire) & PRESENT_FRESH)) return 0;
+	u32 previous = pipeline->ready.exchange(pipeline->showing, std::memory_order_acq_rel);
+	pipeline->showing = previous & ~PRESENT_FRESH;
+	return &pipeline->frames[pipeline->showing];
+}
+
+internal void
+record_present(Present_Stats* stats, u64 drawn_time, u64 present_begin, u64 present_end) {
+	u64 present_time = present_end - present_begin;
+	u64 latency = present_end - drawn_time;
+	stats->frames++;
+	stats->total_present_time += present_time;
+	stats->total_latency += latency;
+	if (present_time > stats->max_present_time) stats->max_present_time = present_time;
+	if (latency > stats->max_latency) stats->max_latency = latency;
+}
+
+// One line summary for the platform to print at exit, pipeline 0 for the serial loop
+internal int
+format_present_report(const Present_Stats* stats, const Present_Pipeline* pipeline, double wall_seconds, char* buffer, int size) {
+	double ms_per_count = 1000.0 / (double)os_get_time_frequency();
+	u64 frames = stats->frames ? stats->frames : 1;
+	int length = snprintf(buffer, size, "present (%s): %llu frames, %.1f per second, present mean %.2fms, max %.2fms, drawn to presented mean %.2fms, max %.2fms",
+		pipeline ? "pipelined" : "serial", stats->frames, wall_seconds > 0 ? stats->frames / wall_seconds : 0.0,
+		stats->total_present_time * ms_per_count / frames, stats->max_present_time * ms_per_count,
+		stats->total_latency * ms_per_count / frames, stats->max_latency * ms_per_count);
+	if (pipeline && length < size) {
+		length += snprintf(buffer + length, size - length, ", %llu of %llu published frames replaced before they were shown",
+			pipeline->frames_replaced, pipeline->frames_published);
+	}
+	return length;
+}
@@ -0,0 +1,450 @@
+// <------------------------- Profile Store --------------------------------------------->
+// Stats for any number of named players in a paged file (os_read_profile_file). Page 0 holds the header
+// and the pages after it fixed size records in the order the players were first seen, so a profile's
+// page is its index / PROFILE_RECORDS_PER_PAGE. Only what lookups and rankings need stays in memory: a
+// hash of each name and the counters the leaderboards sort by. Names and the other counters are read a
+// page at a time through a small cache. Each leaderboard is a treap with subtree sizes over the same
+// profile indices, so a match end updates it in O(log n), any rank is found in O(log n), and a page of
+// the leaderboard only reads the few file pages its rows are on.
+
+#define PROFILE_MAGIC 0x46525050            // "PPRF"
+#define PROFILE_VERSION 1
+#define PROFILE_PAGE_SIZE 4096
+#define PROFILE_NAME_SIZE 24
+#define PROFILE_CACHE_PAGES 8
+#define PROFILE_SCAN_PAGES 64               // Pages read at once while building the index
+#define PROFILE_NONE 0xffffffffu
+#define PROFILE_STORE_HEADROOM 1024         // New profiles a session can add on top of the file's
+#define PROFILE_STORE_MAX_CAPACITY (1u << 22)
+
+// One side's block of Player_Stats, in the same order
+enum Profile_Stat {
+	PROFILE_MATCHES,
+	PROFILE_WON,
+	PROFILE_LOST,
+	PROFILE_POINTS_SCORED,
+	PROFILE_POINTS_LOST,
+
+	PROFILE_STAT_COUNT,
+};
+
+struct Profile_Record {
+	char name[PROFILE_NAME_SIZE];           // Zero padded, always terminated
+	u32 stats[PROFILE_STAT_COUNT];
+};
+
+#define PROFILE_RECORDS_PER_PAGE (PROFILE_PAGE_SIZE / sizeof(Profile_Record))
+
+struct Profile_File_Header {
+	u32 magic;
+	u32 version;
+	u32 page_size;
+	u32 profile_count;
+};
+
+enum Profile_Ranking {
+	RANK_BY_WINS,
+	RANK_BY_WIN_RATE,
+	RANK_BY_POINTS,
+
+	RANKING_COUNT,
+};
+
+// Treap links by profile index, PROFILE_NONE for no child. A node's links share a cache line, a walk
+// down the tree misses once per level for them and once for the keys it compares.
+struct Profile_Node {
+	u32 left, right;
+	u32 size;                               // Profiles in the subtree
+};
+
+struct Profile_Tree {
+	u32 root;
+	Profile_Node* nodes;
+};
+
+// What lookups and rankings need of a profile, kept in memory
+struct Profile_Keys {
+	u32 name_hash;
+	u32 wins, played, points;
+};
+
+struct Profile_Store {
+	bool opened;
+	u32 count, capacity;
+
+	Profile_Keys* keys;                     // By profile
+
+	u32* lookup;                            // Profile by name hash, open addressing
+	u32 lookup_mask;
+	Profile_Tree trees[RANKING_COUNT];
+
+	u8* cache;                              // PROFILE_CACHE_PAGES pages
+	u32 cached_page[PROFILE_CACHE_PAGES];   // File page in each cache slot, PROFILE_NONE when empty
+	u64 cache_last_used[PROFILE_CACHE_PAGES];
+	u64 cache_clock;
+	u64 page_reads;
+};
+
+internal u32
+hash_profile_name(const char* name) {
+	u32 hash = 2166136261u;
+	for (int i = 0; i < PROFILE_NAME_SIZE - 1 && name[i]; i++) {      // As much of the name as a record keeps
+		hash ^= (u8)name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// ---------------- Pages ------------------------------------------
+internal u64
+profile_record_offset(u32 profile) {
+	return (u64)(1 + profile / PROFILE_RECORDS_PER_PAGE) * PROFILE_PAGE_SIZE + (profile % PROFILE_RECORDS_PER_PAGE) * sizeof(Profile_Record);
+}
+
+// The record through the page cache, the least recently used page makes room
+internal Profile_Record*
+get_profile_record(Profile_Store* store, u32 profile) {
+	u32 page = 1 + profile / (u32)PROFILE_RECORDS_PER_PAGE;
+	int slot = -1, oldest = 0;
+	for (int i = 0; i < PROFILE_CACHE_PAGES && slot < 0; i++) {
+		if (store->cached_page[i] == page) slot = i;
+		else if (store->cache_last_used[i] < store->cache_last_used[oldest]) oldest = i;
+	}
+
+	if (slot < 0) {
+		slot = oldest;
+		u8* data = store->cache + slot * PROFILE_PAGE_SIZE;
+		int size = os_read_profile_file(data, (u64)page * PROFILE_PAGE_SIZE, PROFILE_PAGE_SIZE);
+		if (size < 0) size = 0;
+		memset(data + size, 0, PROFILE_PAGE_SIZE - size);      // Past the end of the file
+		store->cached_page[slot] = page;
+		store->page_reads++;
+	}
+	store->cache_last_used[slot] = ++store->cache_clock;
+	return (Profile_Record*)(store->cache + slot * PROFILE_PAGE_SIZE) + profile % PROFILE_RECORDS_PER_PAGE;
+}
+
+// ---------------- Rankings ---------------------------------------
+internal u32
+profile_priority(u32 profile) {
+	u32 x = profile * 0x9e3779b9u;
+	x ^= x >> 16;
+	x *= 0x85ebca6bu;
+	x ^= x >> 13;
+	return x;
+}
+
+// Whether profile a is ranked above b: higher first, the profile seen first on a tie
+internal bool
+ranks_above(const Profile_Store* store, Profile_Ranking ranking, u32 a, u32 b) {
+	u64 key_a, key_b;
+	if (ranking == RANK_BY_WINS) key_a = store->keys[a].wins, key_b = store->keys[b].wins;
+	else if (ranking == RANK_BY_POINTS) key_a = store->keys[a].points, key_b = store->keys[b].points;
+	else {
+		// Compares wins / played without dividing, no matches counts as a rate of 0
+		key_a = (u64)store->keys[a].wins * (store->keys[b].played ? store->keys[b].played : 1);
+		key_b = (u64)store->keys[b].wins * (store->keys[a].played ? store->keys[a].played : 1);
+	}
+	return key_a != key_b ? key_a > key_b : a < b;
+}
+
+internal u32
+profile_tree_size(const Profile_Tree* tree, u32 node) {
+	return node == PROFILE_NONE ? 0 : tree->nodes[node].size;
+}
+
+internal void
+update_profile_tree_size(Profile_Tree* tree, u32 node) {
+	tree->nodes[node].size = 1 + profile_tree_size(tree, tree->nodes[node].left) + profile_tree_size(tree, tree->nodes[node].right);
+}
+
+internal u32
+insert_profile_node(Profile_Store* store, Profile_Ranking ranking, u32 node, u32 profile) {
+	Profile_Tree* tree = &store->trees[ranking];
+	if (node == PROFILE_NONE) {
+		tree->nodes[profile].left = tree->nodes[profile].right = PROFILE_NONE;
+		tree->nodes[profile].size = 1;
+		return profile;
+	}
+
+	// Rotates the new node up while it has the higher priority
+	if (ranks_above(store, ranking, profile, node)) {
+		u32 child = tree->nodes[node].left = insert_profile_node(store, ranking, tree->nodes[node].left, profile);
+		if (profile_priority(child) > profile_priority(node)) {
+			tree->nodes[node].left = tree->nodes[child].right;
+			tree->nodes[child].right = node;
+			update_profile_tree_size(tree, node);
+			update_profile_tree_size(tree, child);
+			return child;
+		}
+	}
+	else {
+		u32 child = tree->nodes[node].right = insert_profile_node(store, ranking, tree->nodes[node].right, profile);
+		if (profile_priority(child) > profile_priority(node)) {
+			tree->nodes[node].right = tree->nodes[child].left;
+			tree->nodes[child].left = node;
+			update_profile_tree_size(tree, node);
+			update_profile_tree_size(tree, child);
+			return child;
+		}
+	}
+	update_profile_tree_size(tree, node);
+	return node;
+}
+
+internal u32
+merge_profile_trees(Profile_Tree* tree, u32 a, u32 b) {
+	if (a == PROFILE_NONE) return b;
+	if (b == PROFILE_NONE) return a;
+	if (profile_priority(a) > profile_priority(b)) {
+		tree->nodes[a].right = merge_profile_trees(tree, tree->nodes[a].right, b);
+		update_profile_tree_size(tree, a);
+		return a;
+	}
+	tree->nodes[b].left = merge_profile_trees(tree, a, tree->nodes[b].left);
+	update_profile_tree_size(tree, b);
+	return b;
+}
+
+// The profile has to be in the tree, under the counters it was inserted with
+internal u32
+remove_profile_node(Profile_Store* store, Profile_Ranking ranking, u32 node, u32 profile) {
+	Profile_Tree* tree = &store->trees[ranking];
+	if (node == profile) return merge_profile_trees(tree, tree->nodes[node].left, tree->nodes[node].right);
+	if (ranks_above(store, ranking, profile, node)) tree->nodes[node].left = remove_profile_node(store, ranking, tree->nodes[node].left, profile);
+	else tree->nodes[node].right = remove_profile_node(store, ranking, tree->nodes[node].right, profile);
+	tree->nodes[node].size--;
+	return node;
+}
+
+// Profile at a rank (0 is the top), PROFILE_NONE past the end
+internal u32
+profile_at_rank(const Profile_Store* store, Profile_Ranking ranking, u32 rank) {
+	const Profile_Tree* tree = &store->trees[ranking];
+	u32 node = tree->root;
+	while (node != PROFILE_NONE) {
+		u32 above = profile_tree_size(tree, tree->nodes[node].left);
+		if (rank == above) return node;
+		if (rank < above) node = tree->nodes[node].left;
+		else {
+			rank -= above + 1;
+			node = tree->nodes[node].right;
+		}
+	}
+	return PROFILE_NONE;
+}
+
+internal u32
+compute_profile_tree_sizes(Profile_Tree* tree, u32 node) {
+	if (node == PROFILE_NONE) return 0;
+	tree->nodes[node].size = 1 + compute_profile_tree_sizes(tree, tree->nodes[node].left) + compute_profile_tree_sizes(tree, tree->nodes[node].right);
+	return tree->nodes[node].size;
+}
+
+// qsort has no context argument, the ranking being sorted by is passed here
+global_variable const Profile_Store* profile_sort_store;
+global_variable Profile_Ranking profile_sort_ranking;
+
+internal int
+compare_profile_ranks(const void* a, const void* b) {
+	u32 profile_a = *(const u32*)a, profile_b = *(const u32*)b;
+	if (profile_a == profile_b) return 0;
+	return ranks_above(profile_sort_store, profile_sort_ranking, profile_a, profile_b) ? -1 : 1;
+}
+
+// Every profile at once: sorted by rank, then made into a treap in one pass with a stack of its
+// right spine, much faster than a million inserts
+internal void
+build_profile_tree(Profile_Store* store, Profile_Ranking ranking, u32* order, u32* stack) {
+	Profile_Tree* tree = &store->trees[ranking];
+	for (u32 i = 0; i < store->count; i++) order[i] = i;
+	profile_sort_store = store;
+	profile_sort_ranking = ranking;
+	qsort(order, store->count, sizeof(u32), compare_profile_ranks);
+
+	u32 depth = 0;
+	for (u32 i = 0; i < store->count; i++) {
+		u32 profile = order[i];
+		u32 last = PROFILE_NONE;
+		while (depth && profile_priority(stack[depth - 1]) < profile_priority(profile)) last = stack[--depth];
+		tree->nodes[profile].left = last;
+		tree->nodes[profile].right = PROFILE_NONE;
+		if (depth) tree->nodes[stack[depth - 1]].right = profile;
+		stack[depth++] = profile;
+	}
+	tree->root = depth ? stack[0] : PROFILE_NONE;
+	compute_profile_tree_sizes(tree, tree->root);
+}
+
+// ---------------- Store ------------------------------------------
+internal void
+add_profile_lookup(Profile_Store* store, u32 profile) {
+	u32 i = store->keys[profile].name_hash & store->lookup_mask;
+	while (store->lookup[i] != PROFILE_NONE) i = (i + 1) & store->lookup_mask;
+	store->lookup[i] = profile;
+}
+
+internal void
+index_profile(Profile_Store* store, u32 profile, const Profile_Record* record) {
+	store->keys[profile].name_hash = hash_profile_name(record->name);
+	store->keys[profile].wins = record->stats[PROFILE_WON];
+	store->keys[profile].played = record->stats[PROFILE_MATCHES];
+	store->keys[profile].points = record->stats[PROFILE_POINTS_SCORED];
+	add_profile_lookup(store, profile);
+}
+
+// Profiles to size the store for: every one in the file and PROFILE_STORE_HEADROOM more. A file that is
+// not a profile file counts as empty here, load_profile_store() turns it down.
+internal u32
+get_profile_store_capacity() {
+	Profile_File_Header header;
+	u32 count = 0;
+	if (os_read_profile_file(&header, 0, sizeof(header)) == (int)sizeof(header) && header.magic == PROFILE_MAGIC) count = header.profile_count;
+	if (count > PROFILE_STORE_MAX_CAPACITY - PROFILE_STORE_HEADROOM) count = PROFILE_STORE_MAX_CAPACITY - PROFILE_STORE_HEADROOM;
+	return count + PROFILE_STORE_HEADROOM;
+}
+
+// Arena space init_profile_store() and then load_profile_store() take for capacity profiles, when both
+// are given the same arena. The platform reserves it with the rest of the game's memory.
+internal size_t
+get_profile_store_memory_size(u32 capacity) {
+	size_t lookup_size = 2;
+	while (lookup_size < 2 * (size_t)capacity) lookup_size *= 2;
+	size_t index_size = (sizeof(Profile_Keys) + RANKING_COUNT * sizeof(Profile_Node)) * capacity + sizeof(u32) * lookup_size +
+		PROFILE_CACHE_PAGES * PROFILE_PAGE_SIZE;
+	size_t scratch_size = PROFILE_SCAN_PAGES * PROFILE_PAGE_SIZE + 2 * sizeof(u32) * ((size_t)capacity + 1);
+	return index_size + scratch_size + 16 * 16;                // Each push rounds up to 16 bytes
+}
+
+// Index arrays for capacity profiles, from arena once, the file is read by load_profile_store()
+internal bool
+init_profile_store(Profile_Store* store, Memory_Arena* arena, u32 capacity) {
+	*store = {};
+	store->capacity = capacity;
+	store->lookup_mask = 1;
+	while (store->lookup_mask + 1 < 2 * capacity) store->lookup_mask = 2 * store->lookup_mask + 1;
+	store->keys = push_array(arena, Profile_Keys, capacity);
+	store->lookup = push_array(arena, u32, store->lookup_mask + 1);
+	for (int r = 0; r < RANKING_COUNT; r++) {
+		store->trees[r].nodes = push_array(arena, Profile_Node, capacity);
+		if (!store->trees[r].nodes) return false;
+	}
+	store->cache = (u8*)push_size(arena, PROFILE_CACHE_PAGES * PROFILE_PAGE_SIZE);
+	return store->keys && store->lookup && store->cache;
+}
+
+// Reads every record once to build the index, scratch is only used meanwhile. False when the file
+// is not a profile file or holds more profiles than the store has room for.
+internal bool
+load_profile_store(Profile_Store* store, Memory_Arena* scratch) {
+	store->opened = false;
+	store->count = 0;
+	memset(store->lookup, 0xff, sizeof(u32) * (store->lookup_mask + 1));
+	for (int i = 0; i < PROFILE_CACHE_PAGES; i++) {
+		store->cached_page[i] = PROFILE_NONE;
+		store->cache_last_used[i] = 0;
+	}
+
+	// No file yet is an empty store, the header is written with the first profile
+	Profile_File_Header header;
+	if (os_read_profile_file(&header, 0, sizeof(header)) == (int)sizeof(header)) {
+		if (header.magic != PROFILE_MAGIC || header.version != PROFILE_VERSION || header.page_size != PROFILE_PAGE_SIZE ||
+			header.profile_count > store->capacity) return false;
+		store->count = header.profile_count;
+	}
+
+	size_t scratch_used = scratch->used;
+	u8* pages = (u8*)push_size(scratch, PROFILE_SCAN_PAGES * PROFILE_PAGE_SIZE);
+	u32* order = push_array(scratch, u32, store->count + 1);
+	u32* stack = push_array(scratch, u32, store->count + 1);
+	if (!pages || !order || !stack) return false;
+	u32 page_count = (u32)((store->count + PROFILE_RECORDS_PER_PAGE - 1) / PROFILE_RECORDS_PER_PAGE);
+	for (u32 page = 0; page < page_count; page += PROFILE_SCAN_PAGES) {
+		u32 pages_read = page_count - page < PROFILE_SCAN_PAGES ? page_count - page : PROFILE_SCAN_PAGES;
+		int size = os_read_profile_file(pages, (u64)(1 + page) * PROFILE_PAGE_SIZE, pages_read * PROFILE_PAGE_SIZE);
+		if (size < 0) size = 0;
+		memset(pages + size, 0, pages_read * PROFILE_PAGE_SIZE - size);
+		for (u32 p = 0; p < pages_read; p++) {
+			const Profile_Record* records = (const Profile_Record*)(pages + p * PROFILE_PAGE_SIZE);
+			for (u32 r = 0; r < PROFILE_RECORDS_PER_PAGE; r++) {
+				u32 profile = (page + p) * (u32)PROFILE_RECORDS_PER_PAGE + r;
+				if (profile < store->count) index_profile(store, profile, &records[r]);
+			}
+		}
+	}
+	for (int r = 0; r < RANKING_COUNT; r++) build_profile_tree(store, (Profile_Ranking)r, order, stack);
+	scratch->used = scratch_used;
+	store->opened = true;
+	return true;
+}
+
+// PROFILE_NONE when there is no profile by that name
+internal u32
+find_profile(Profile_Store* store, const char* name) {
+	u32 hash = hash_profile_name(name);
+	for (u32 i = hash & store->lookup_mask; store->lookup[i] != PROFILE_NONE; i = (i + 1) & store->lookup_mask) {
+		u32 profile = store->lookup[i];
+		if (store->keys[profile].name_hash == hash && !strncmp(get_profile_record(store, profile)->name, name, PROFILE_NAME_SIZE - 1)) return profile;
+	}
+	return PROFILE_NONE;
+}
+
+// Adds a match to a player's profile, creating it the first time. One record is rewritten in the file.
+internal bool
+record_profile_match(Profile_Store* store, const char* name, bool won, int points_scored, int points_lost) {
+	if (!store->opened) return false;
+	u32 profile = find_profile(store, name);
+	bool created = profile == PROFILE_NONE;
+	if (created) {
+		if (store->count == store->capacity) return false;
+		profile = store->count++;
+		Profile_Record* record = get_profile_record(store, profile);
+		*record = {};
+		snprintf(record->name, sizeof(record->name), "%s", name);
+		index_profile(store, profile, record);
+	}
+	else {
+		for (int r = 0; r < RANKING_COUNT; r++) {
+			store->trees[r].root = remove_profile_node(store, (Profile_Ranking)r, store->trees[r].root, profile);
+		}
+	}
+
+	Profile_Record* record = get_profile_record(store, profile);
+	record->stats[PROFILE_MATCHES]++;
+	record->stats[won ? PROFILE_WON : PROFILE_LOST]++;
+	record->stats[PROFILE_POINTS_SCORED] += points_scored;
+	record->stats[PROFILE_POINTS_LOST] += points_lost;
+	store->keys[profile].wins = record->stats[PROFILE_WON];
+	store->keys[profile].played = record->stats[PROFILE_MATCHES];
+	store->keys[profile].points = record->stats[PROFILE_POINTS_SCORED];
+	for (int r = 0; r < RANKING_COUNT; r++) {
+		store->trees[r].root = insert_profile_node(store, (Profile_Ranking)r, store->trees[r].root, profile);
+	}
+	if (!os_write_profile_file(record, profile_record_offset(profile), sizeof(*record))) return false;
+
+	// The header counts a new profile only once its record is in the file, a crash in between
+	// leaves the file as it was
+	if (created) {
+		Profile_File_Header header = { PROFILE_MAGIC, PROFILE_VERSION, PROFILE_PAGE_SIZE, store->count };
+		return os_write_profile_file(&header, 0, sizeof(header));
+	}
+	return true;
+}
+
+struct Leaderboard_Row {
+	u32 rank;                               // 0 is the top
+	Profile_Record record;
+};
+
+// Up to count rows from rank first down, returns how many there were. Reads only the rows' pages.
+internal int
+query_leaderboard(Profile_Store* store, Profile_Ranking ranking, u32 first, Leaderboard_Row* rows, int count) {
+	int found = 0;
+	for (; found < count; found++) {
+		u32 profile = profile_at_rank(store, ranking, first + found);
+		if (profile == PROFILE_NONE) break;
+		rows[found].rank = first + found;
+		rows[found].record = *get_profile_record(store, profile);
+	}
+	return found;
+}
@@ -1,86 +1,332 @@
 internal void
-render_background() {
+clear_screen(u32 color) {
 	u32* pixel = (u32*)render_state.memory;
 	for (int y = 0; y < render_state.height; y++) {
 		for (int x = 0; x < render_state.width; x++) {
-			*pixel++ = (y * y) / 4 + (x * x) / 3 - (x * y);
+			*pixel++ = color;
+		}
+	}
+}
+
+// ---------------------------- Blending --------------------------------------------------
+// Overlays and fades blend a color into the framebuffer instead of overwriting it. The mode is a
+// template parameter, so each mode gets its own kernel and the opaque path stays a plain fill.
+// All modes work per 8-bit channel with alpha 0..255, rounding x/255 the same way in the SSE2
+// kernels and the scalar loop that finishes each row, so a frame is identical either way.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDERER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+enum Blend_Mode {
+	BLEND_OPAQUE,                           // color
+	BLEND_ALPHA,                            // color * alpha + dest * (1 - alpha)
+	BLEND_ADD,                              // dest + color * alpha, saturating
+	BLEND_MULTIPLY,                         // dest * lerp(white, color, alpha)
+};
+
+// x / 255 rounded to nearest, exact for x <= 255 * 255
+inline u32
+div_255(u32 x) {
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+// One channel of a blend, for the scalar path
+template <Blend_Mode mode>
+inline u32
+blend_channel(u32 dest, u32 source, u32 alpha) {
+	switch (mode) {
+		case BLEND_ALPHA: return div_255(dest * (255 - alpha) + source * alpha);
+		case BLEND_ADD: {
+			u32 sum = dest + div_255(source * alpha);
+			return sum > 255 ? 255 : sum;
 		}
+		case BLEND_MULTIPLY: return div_255(dest * (255 - alpha + div_255(source * alpha)));
+		default: return source;
 	}
 }
 
+template <Blend_Mode mode>
+inline u32
+blend_pixel(u32 dest, u32 color, u32 alpha) {
+	u32 result = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		result |= blend_channel<mode>((dest >> shift) & 0xff, (color >> shift) & 0xff, alpha) << shift;
+	}
+	return result;
+}
+
+// Blends count pixels starting at pixel, 4 per SSE2 instruction
+template <Blend_Mode mode>
 internal void
-clear_screen(u32 color) {
-	u32* pixel = (u32*)render_state.memory;
-	for (int y = 0; y < render_state.height; y++) {
-		for (int x = 0; x < render_state.width; x++) {
-			*pixel++ = color;
+blend_span(u32* pixel, int count, u32 color, u32 alpha) {
+	if (mode == BLEND_OPAQUE) {
+		int x = 0;
+#if RENDERER_SSE2
+		__m128i fill = _mm_set1_epi32((int)color);
+		for (; x + 4 <= count; x += 4) _mm_storeu_si128((__m128i*)(pixel + x), fill);
+#endif
+		for (; x < count; x++) pixel[x] = color;
+		return;
+	}
+
+	int x = 0;
+#if RENDERER_SSE2
+	__m128i zero = _mm_setzero_si128();
+	__m128i source = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);     // 16 bits per channel, 2 pixels
+	__m128i alpha16 = _mm_set1_epi16((short)alpha);
+	__m128i rounding = _mm_set1_epi16(128);
+
+	// Per channel constants: alpha adds source * alpha, add adds the premultiplied color,
+	// multiply scales by the color faded towards white
+	__m128i factor = _mm_set1_epi16((short)(255 - alpha));
+	__m128i offset = _mm_add_epi16(_mm_mullo_epi16(source, alpha16), rounding);
+	__m128i premultiplied = _mm_srli_epi16(_mm_add_epi16(offset, _mm_srli_epi16(offset, 8)), 8);
+	if (mode == BLEND_ADD) premultiplied = _mm_packus_epi16(premultiplied, premultiplied);
+	if (mode == BLEND_MULTIPLY) {
+		factor = _mm_add_epi16(factor, premultiplied);
+		offset = rounding;
+	}
+
+	for (; x + 4 <= count; x += 4) {
+		__m128i dest = _mm_loadu_si128((__m128i*)(pixel + x));
+		if (mode == BLEND_ADD) {
+			dest = _mm_adds_epu8(dest, premultiplied);
+		}
+		else {
+			__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dest, zero), factor), offset);
+			__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dest, zero), factor), offset);
+			lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+			hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+			dest = _mm_packus_epi16(lo, hi);
 		}
+		_mm_storeu_si128((__m128i*)(pixel + x), dest);
 	}
+#endif
+	for (; x < count; x++) pixel[x] = blend_pixel<mode>(pixel[x], color, alpha);
 }
 
+// Fill a rect already clamped to the framebuffer, every rect and overlay is drawn through here
+template <Blend_Mode mode>
 internal void
-draw_rect_in_pixels(int x0, int y0, int x1, int y1, u32 color) {
-	// Clamp the rectangle coordinates to avoid memory access errors
-	x0 = clamp(0, x0, render_state.width);
-	x1 = clamp(0, x1, render_state.width);
-	y0 = clamp(0, y0, render_state.height);
-	y1 = clamp(0, y1, render_state.height);
+fill_clamped_rect(int x0, int y0, int x1, int y1, u32 color, u32 alpha) {
+	if (x1 <= x0) return;
 
 	for (int y = y0; y < y1; y++) {
-		u32* pixel = (u32*)render_state.memory + x0 + y*render_state.width;
-		for (int x = x0; x < x1; x++) {
-			*pixel++ = color;
-		}
+		blend_span<mode>((u32*)render_state.memory + x0 + y*render_state.width, x1 - x0, color, alpha);
 	}
 }
 
+// A rect in framebuffer pixels, clamped to it
+internal void
+draw_rect_in_pixels(int x0, int y0, int x1, int y1, u32 color) {
+	fill_clamped_rect<BLEND_OPAQUE>(clamp(0, x0, render_state.width), clamp(0, y0, render_state.height),
+									clamp(0, x1, render_state.width), clamp(0, y1, render_state.height), color, 255);
+}
+
+// Full screen overlay, for dimming and fades
+template <Blend_Mode mode>
+internal void
+blend_screen(u32 color, u32 alpha) {
+	fill_clamped_rect<mode>(0, 0, render_state.width, render_state.height, color, alpha);
+}
+
 global_variable float render_scale = 0.01f;
+global_variable bool render_top_down = false;  // Row 0 is the top of the screen, for platforms with top down images
+
+// ---------------------------- Screen Transform ------------------------------------------
+// Game units to pixels. Platforms resize by writing render_state directly, so the transform is
+// rebuilt the first time a rect is drawn at a new size rather than worked out again per rect.
+// Top down, the rows a rect covers are mirrored after clamping, so it lands on the same pixels
+// of the picture either way.
+
+struct Screen_Transform {
+	int width, height;     // Framebuffer size the transform was built for
+	float scale;           // Pixels per game unit
+	float center_x;        // Pixel position of the game origin
+	float center_y;
+	bool top_down;         // Rows are counted from the top
+};
+
+global_variable Screen_Transform screen_transform;
+
+internal const Screen_Transform*
+get_screen_transform() {
+	if (screen_transform.width != render_state.width || screen_transform.height != render_state.height ||
+		screen_transform.top_down != render_top_down) {
+		// Choose size scaler - width or height
+		// Heigth allows for wider screens to view more of the buffer frame
+		// Width allows for longer screens to view more of the buffer frame
+		int size_scaler = render_state.height*render_scale;
+
+		screen_transform.width = render_state.width;
+		screen_transform.height = render_state.height;
+		screen_transform.scale = (float)size_scaler;
+		screen_transform.center_x = render_state.width / 2.f;  // x = 0 is the center of the screen
+		screen_transform.center_y = render_state.height / 2.f;
+		screen_transform.top_down = render_top_down;
+	}
+	return &screen_transform;
+}
+
+// Scale, center, truncate and clamp one rect. The SSE2 batch path does the same float operations
+// in the same order, so a rect lands on the same pixels whichever way it is drawn.
+inline void
+transform_rect(const Screen_Transform* transform, float x, float y, float half_size_x, float half_size_y,
+			   int* x0, int* y0, int* x1, int* y1) {
+	x = x*transform->scale + transform->center_x;
+	y = y*transform->scale + transform->center_y;
+	half_size_x *= transform->scale;
+	half_size_y *= transform->scale;
+
+	*x0 = clamp(0, (int)(x - half_size_x), transform->width);
+	*x1 = clamp(0, (int)(x + half_size_x), transform->width);
+	*y0 = clamp(0, (int)(y - half_size_y), transform->height);
+	*y1 = clamp(0, (int)(y + half_size_y), transform->height);
+	if (transform->top_down) {
+		int bottom = *y0;
+		*y0 = transform->height - *y1;
+		*y1 = transform->height - bottom;
+	}
+}
+
+template <Blend_Mode mode>
+internal void
+draw_rect_blended(float x, float y, float half_size_x, float half_size_y, u32 color, u32 alpha) {
+	int x0, y0, x1, y1;
+	transform_rect(get_screen_transform(), x, y, half_size_x, half_size_y, &x0, &y0, &x1, &y1);
+	fill_clamped_rect<mode>(x0, y0, x1, y1, color, alpha);
+}
 
 internal void
 draw_rect(float x, float y, float half_size_x, float half_size_y, u32 color) {
-	// Choose size scaler - width or height
-	// Heigth allows for wider screens to view more of the buffer frame
-	// Width allows for longer screens to view more of the buffer frame
-	int size_scaler = render_state.height*render_scale;
-
-	// Scale percentages to full screen size
-	x *= size_scaler;
-	y *= size_scaler;
-	half_size_x *= size_scaler;
-	half_size_y *= size_scaler;
-
-	// Center the x and y coordinates
-	x += render_state.width / 2.f;  // Shift x = 0 to center of screen horizontally
-	y += render_state.height / 2.f; // Shift y = 0 to center of screen vertically
-
-	// Get coordinates from floating points
-	int x0 = x - half_size_x;
-	int x1 = x + half_size_x;
-	int y0 = y - half_size_y;
-	int y1 = y + half_size_y;
-
-	// Change to pixels and draw it
-	draw_rect_in_pixels(x0, y0, x1, y1, color);
+	draw_rect_blended<BLEND_OPAQUE>(x, y, half_size_x, half_size_y, color, 255);
+}
+
+// ---------------------------- Rect Batches ----------------------------------------------
+// Rects queued in game units and drawn together: the transform runs over the whole batch four rects
+// at a time, then the spans are filled in the order the rects were pushed. A batch is drawn in one
+// blend mode, push and draw it with the same one.
+
+#define RECT_BATCH_CAPACITY 64
+
+struct Rect_Batch {
+	alignas(16) float x[RECT_BATCH_CAPACITY];
+	alignas(16) float y[RECT_BATCH_CAPACITY];
+	alignas(16) float half_size_x[RECT_BATCH_CAPACITY];
+	alignas(16) float half_size_y[RECT_BATCH_CAPACITY];
+	u32 color[RECT_BATCH_CAPACITY];
+	u32 alpha[RECT_BATCH_CAPACITY];
+	int count;
+};
+
+#if RENDERER_SSE2
+// SSE2 has no min/max for 32-bit ints, select through compare masks instead
+inline __m128i
+clamp_epi32(__m128i min, __m128i value, __m128i max) {
+	__m128i below = _mm_cmplt_epi32(value, min);
+	value = _mm_or_si128(_mm_and_si128(below, min), _mm_andnot_si128(below, value));
+	__m128i above = _mm_cmpgt_epi32(value, max);
+	return _mm_or_si128(_mm_and_si128(above, max), _mm_andnot_si128(above, value));
+}
+#endif
+
+template <Blend_Mode mode>
+internal void
+draw_rect_batch_blended(Rect_Batch* batch) {
+	const Screen_Transform* transform = get_screen_transform();
+	alignas(16) int x0[RECT_BATCH_CAPACITY];
+	alignas(16) int y0[RECT_BATCH_CAPACITY];
+	alignas(16) int x1[RECT_BATCH_CAPACITY];
+	alignas(16) int y1[RECT_BATCH_CAPACITY];
+
+	int i = 0;
+#if RENDERER_SSE2
+	__m128 scale = _mm_set1_ps(transform->scale);
+	__m128 center_x = _mm_set1_ps(transform->center_x);
+	__m128 center_y = _mm_set1_ps(transform->center_y);
+	__m128i zero = _mm_setzero_si128();
+	__m128i width = _mm_set1_epi32(transform->width);
+	__m128i height = _mm_set1_epi32(transform->height);
+	for (; i + 4 <= batch->count; i += 4) {
+		__m128 x = _mm_add_ps(_mm_mul_ps(_mm_load_ps(batch->x + i), scale), center_x);
+		__m128 y = _mm_add_ps(_mm_mul_ps(_mm_load_ps(batch->y + i), scale), center_y);
+		__m128 half_size_x = _mm_mul_ps(_mm_load_ps(batch->half_size_x + i), scale);
+		__m128 half_size_y = _mm_mul_ps(_mm_load_ps(batch->half_size_y + i), scale);
+
+		// Truncate toward zero like the scalar int conversion
+		_mm_store_si128((__m128i*)(x0 + i), clamp_epi32(zero, _mm_cvttps_epi32(_mm_sub_ps(x, half_size_x)), width));
+		_mm_store_si128((__m128i*)(x1 + i), clamp_epi32(zero, _mm_cvttps_epi32(_mm_add_ps(x, half_size_x)), width));
+		__m128i bottom = clamp_epi32(zero, _mm_cvttps_epi32(_mm_sub_ps(y, half_size_y)), height);
+		__m128i top = clamp_epi32(zero, _mm_cvttps_epi32(_mm_add_ps(y, half_size_y)), height);
+		if (transform->top_down) {
+			__m128i flipped_top = _mm_sub_epi32(height, bottom);
+			bottom = _mm_sub_epi32(height, top);
+			top = flipped_top;
+		}
+		_mm_store_si128((__m128i*)(y0 + i), bottom);
+		_mm_store_si128((__m128i*)(y1 + i), top);
+	}
+#endif
+	for (; i < batch->count; i++) {
+		transform_rect(transform, batch->x[i], batch->y[i], batch->half_size_x[i], batch->half_size_y[i],
+					   x0 + i, y0 + i, x1 + i, y1 + i);
+	}
+
+	for (i = 0; i < batch->count; i++) {
+		fill_clamped_rect<mode>(x0[i], y0[i], x1[i], y1[i], batch->color[i], batch->alpha[i]);
+	}
+	batch->count = 0;
+}
+
+internal void
+draw_rect_batch(Rect_Batch* batch) {
+	draw_rect_batch_blended<BLEND_OPAQUE>(batch);
+}
+
+// Queue a rect, drawing the batch first when it is full
+template <Blend_Mode mode>
+inline void
+push_rect_blended(Rect_Batch* batch, float x, float y, float half_size_x, float half_size_y, u32 color, u32 alpha) {
+	if (batch->count == RECT_BATCH_CAPACITY) draw_rect_batch_blended<mode>(batch);
+
+	int i = batch->count++;
+	batch->x[i] = x;
+	batch->y[i] = y;
+	batch->half_size_x[i] = half_size_x;
+	batch->half_size_y[i] = half_size_y;
+	batch->color[i] = color;
+	batch->alpha[i] = alpha;
+}
+
+inline void
+push_rect(Rect_Batch* batch, float x, float y, float half_size_x, float half_size_y, u32 color) {
+	push_rect_blended<BLEND_OPAQUE>(batch, x, y, half_size_x, half_size_y, color, 255);
 }
 
 internal void
 draw_bounds(float arena_hsx, float arena_hsy, float line_hsx, float line_hsy, float player_hsx, float arena_cvg, u32 color) {
 	int gap = 2;
+	Rect_Batch batch;
+	batch.count = 0;
 
 	// Central Line
 	for (int y = -(int)arena_hsy + (int)line_hsy; y < (int)arena_hsy - (int)line_hsy; y += 2*line_hsy + gap) {
-		draw_rect(0, y + gap, line_hsx, line_hsy, color);
+		push_rect(&batch, 0, y + gap, line_hsx, line_hsy, color);
 	}
 
 	// Right-arena player boundary
 	for (int y = -(int)arena_hsy + (int)line_hsy; y < (int)arena_hsy - (int)line_hsy; y += line_hsy + .5f * gap) {
-		draw_rect((1.f - arena_cvg)*arena_hsx - 2*player_hsx, y + gap, .5f*line_hsx, .5f*line_hsy, color);
+		push_rect(&batch, (1.f - arena_cvg)*arena_hsx - 2*player_hsx, y + gap, .5f*line_hsx, .5f*line_hsy, color);
 	}
 
 	// Left-arena player boundary
 	for (int y = -(int)arena_hsy + (int)line_hsy; y < (int)arena_hsy - (int)line_hsy; y += line_hsy + .5f * gap) {
-		draw_rect(-(1.f - arena_cvg) * arena_hsx + 2*player_hsx, y + gap, .5f * line_hsx, .5f * line_hsy, color);
+		push_rect(&batch, -(1.f - arena_cvg) * arena_hsx + 2*player_hsx, y + gap, .5f * line_hsx, .5f * line_hsy, color);
 	}
+
+	draw_rect_batch(&batch);
 }
 
 internal void
@@ -89,6 +335,142 @@ draw_arena(float arena_hsx, float arena_hsy, u32 arena_color, u32 outer_color) {
 	draw_rect(0, 0, arena_hsx, arena_hsy, arena_color);
 }
 
+// ---------------------------- Row Bands -------------------------------------------------
+// A full frame fill that is bound by arithmetic rather than memory can be drawn in bands of rows
+// at the same time. A platform with worker threads points run_row_bands at a function that runs
+// draw_rows over every row on them (and the calling thread) and returns when all are drawn.
+// Without one the caller draws all the rows itself.
+
+typedef void Draw_Rows(void* data, int y_begin, int y_end);
+typedef void Run_Row_Bands(Draw_Rows* draw_rows, void* data, int height);
+
+global_variable Run_Row_Bands* run_row_bands;
+
+internal void
+draw_row_bands(Draw_Rows* draw_rows, void* data, int height) {
+	if (run_row_bands) run_row_bands(draw_rows, data, height);
+	else draw_rows(data, 0, height);
+}
+
+// ---------------------------- Procedural Background -------------------------------------
+// The animated menu background: the pattern of (y*y)/4 + (x*x)/3 - x*y, times 12 so that it is an
+// integer quadratic, around an origin that drifts over time and with a colour phase that cycles.
+// Along a row a quadratic's second difference is constant, so instead of multiplying per pixel
+// each pixel is two additions: v(x + 1) = v(x) + d(x), d(x + 1) = d(x) + 8. The SSE2 path keeps 16
+// pixels in flight (4 registers of 4), each lane stepping 16 pixels at a time. Everything wraps
+// mod 2^32 the same way the per-pixel formula does, so both give the same frame.
+#include <math.h>
+
+struct Background_Field {
+	s32 origin_x, origin_y;
+	u32 phase;
+};
+
+internal Background_Field
+background_field_at(float time) {
+	Background_Field field;
+	field.origin_x = (s32)(render_state.width * (.5f + .25f * sinf(time * .31f)));
+	field.origin_y = (s32)(render_state.height * (.5f + .25f * cosf(time * .23f)));
+	field.phase = (u32)(time * 2048.f) << 5;
+	return field;
+}
+
+inline u32
+background_value(const Background_Field* field, s32 x, s32 y) {
+	u32 dx = (u32)(x - field->origin_x), dy = (u32)(y - field->origin_y);
+	return 3 * dy * dy + 4 * dx * dx - 12 * dx * dy + field->phase;
+}
+
+// Half brightness, so the menu stays readable over it
+inline u32
+background_color(u32 value) {
+	return (value >> 5) & 0x7f7f7f;
+}
+
+// Where row y of the pattern (counted from the bottom) is in the framebuffer
+inline int
+background_row(int y) {
+	return render_top_down ? render_state.height - 1 - y : y;
+}
+
+// The reference: the formula evaluated at every pixel, what the incremental version is measured against
+internal void
+draw_procedural_background_naive(float time) {
+	Background_Field field = background_field_at(time);
+	for (int y = 0; y < render_state.height; y++) {
+		u32* pixel = (u32*)render_state.memory + background_row(y) * render_state.width;
+		for (int x = 0; x < render_state.width; x++) {
+			*pixel++ = background_color(background_value(&field, x, y));
+		}
+	}
+}
+
+// Rows y_begin to y_end, so a frame can be split into bands
+internal void
+draw_procedural_background_rows(float time, int y_begin, int y_end) {
+	Background_Field field = background_field_at(time);
+	int width = render_state.width;
+	for (int y = y_begin; y < y_end; y++) {
+		u32* row = (u32*)render_state.memory + background_row(y) * width;
+		u32 dy = (u32)(y - field.origin_y);
+		int x = 0;
+#if RENDERER_SSE2
+		// Lane i holds pixel x + i, which moves 16 pixels a step: v(x + 16) - v(x) = 128x' + 1024 - 192y'
+		// (x' and y' from the origin), and that grows by 2048 each step
+		if (width >= 16) {
+			alignas(16) u32 start[16], step[16];
+			for (int i = 0; i < 16; i++) {
+				u32 dx = (u32)(i - field.origin_x);
+				start[i] = background_value(&field, i, y);
+				step[i] = 128 * dx + 1024 - 192 * dy;
+			}
+			__m128i v[4], d[4];
+			for (int r = 0; r < 4; r++) {
+				v[r] = _mm_load_si128((__m128i*)start + r);
+				d[r] = _mm_load_si128((__m128i*)step + r);
+			}
+			__m128i step_growth = _mm_set1_epi32(2048);
+			__m128i mask = _mm_set1_epi32(0x7f7f7f);
+			if (((size_t)row & 15) == 0) {
+				for (; x + 16 <= width; x += 16) {
+					for (int r = 0; r < 4; r++) {
+						_mm_stream_si128((__m128i*)(row + x) + r, _mm_and_si128(_mm_srli_epi32(v[r], 5), mask));
+						v[r] = _mm_add_epi32(v[r], d[r]);
+						d[r] = _mm_add_epi32(d[r], step_growth);
+					}
+				}
+			}
+			for (; x + 16 <= width; x += 16) {
+				for (int r = 0; r < 4; r++) {
+					_mm_storeu_si128((__m128i*)(row + x) + r, _mm_and_si128(_mm_srli_epi32(v[r], 5), mask));
+					v[r] = _mm_add_epi32(v[r], d[r]);
+					d[r] = _mm_add_epi32(d[r], step_growth);
+				}
+			}
+		}
+#endif
+		// The rest of the row, one pixel a step: d(x) = v(x + 1) - v(x) = 8x' + 4 - 12y'
+		u32 value = background_value(&field, x, y);
+		u32 difference = 8 * (u32)(x - field.origin_x) + 4 - 12 * dy;
+		for (; x < width; x++) {
+			row[x] = background_color(value);
+			value += difference;
+			difference += 8;
+		}
+	}
+}
+
+internal void
+draw_background_band(void* time, int y_begin, int y_end) {
+	draw_procedural_background_rows(*(float*)time, y_begin, y_end);
+}
+
+// Split into bands over the platform's render workers when it has them
+internal void
+draw_procedural_background(float time) {
+	draw_row_bands(draw_background_band, &time, render_state.height);
+}
+
 // ---------------------------- Text Rendering --------------------------------------------
 
 // Primitive number rendering
@@ -96,6 +478,8 @@ internal void
 draw_number(int number, float x, float y, float size, u32 color) {
 
 	float half_size = size * .5f;
+	Rect_Batch batch;            // Every segment of every digit goes in one batch
+	batch.count = 0;
 	bool drew_zero = false;      // To account for sole zero
 	while (number || !drew_zero) {
 		drew_zero = true;        // Set to true to prevent first place zero
@@ -106,70 +490,70 @@ draw_number(int number, float x, float y, float size, u32 color) {
 		switch (digit) {
 			case 0: {
 				// Left side of zero
-				draw_rect(x - size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x - size, y, half_size, 2.5f * size, color);
 
 				// Right side of zero
-				draw_rect(x + size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x + size, y, half_size, 2.5f * size, color);
 
 				// Top side of zero
-				draw_rect(x, y + size * 2.f, half_size, half_size, color);
+				push_rect(&batch, x, y + size * 2.f, half_size, half_size, color);
 
 				// Bottom side of zero
-				draw_rect(x, y - size * 2.f, half_size, half_size, color);
+				push_rect(&batch, x, y - size * 2.f, half_size, half_size, color);
 
 				// Reduce x by 4 * size to allow for next ten's/hundred's digit to be printed
 				x -= size * 4.f;
 			} break;
 
 			case 1: {
-				draw_rect(x + size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x + size, y, half_size, 2.5f * size, color);
 				x -= size * 2.f;
 			} break;
 
 			case 2: {
 				// Top side of two
-				draw_rect(x, y + size * 2.f, 1.5f * size, half_size, color);
+				push_rect(&batch, x, y + size * 2.f, 1.5f * size, half_size, color);
 
 				// Middle rectangle of two
-				draw_rect(x, y, 1.5f * size, half_size, color);
+				push_rect(&batch, x, y, 1.5f * size, half_size, color);
 
 				// Bottom rectangle of two
-				draw_rect(x, y - size * 2.f, 1.5f * size, half_size, color);
+				push_rect(&batch, x, y - size * 2.f, 1.5f * size, half_size, color);
 
 				// Top right rectangle of two
-				draw_rect(x + size, y + size, half_size, half_size, color);
+				push_rect(&batch, x + size, y + size, half_size, half_size, color);
 
 				// Bottom left rectange of two
-				draw_rect(x - size, y - size, half_size, half_size, color);
+				push_rect(&batch, x - size, y - size, half_size, half_size, color);
 
 				x -= size * 4.f;
 			} break;
 
 			case 3: {
 				// Top rectangle of three
-				draw_rect(x - half_size, y + size * 2.f, size, half_size, color);
+				push_rect(&batch, x - half_size, y + size * 2.f, size, half_size, color);
 
 				// Middle rectangle of three
-				draw_rect(x - half_size, y, size, half_size, color);
+				push_rect(&batch, x - half_size, y, size, half_size, color);
 
 				// Bottom rectangle of three
-				draw_rect(x - half_size, y - size * 2.f, size, half_size, color);
+				push_rect(&batch, x - half_size, y - size * 2.f, size, half_size, color);
 
 				// Vertical rectangle of three
-				draw_rect(x + size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x + size, y, half_size, 2.5f * size, color);
 
 				x -= size * 4.f;
 			} break;
 
 			case 4: {
 				// Right Vertical rectangle of four
-				draw_rect(x + size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x + size, y, half_size, 2.5f * size, color);
 
 				// Left Vertical rectangle of four (smaller)
-				draw_rect(x - size, y + size, half_size, 1.5f * size, color);
+				push_rect(&batch, x - size, y + size, half_size, 1.5f * size, color);
 
 				// Horizontal rectangle of four
-				draw_rect(x, y, half_size, half_size, color);
+				push_rect(&batch, x, y, half_size, half_size, color);
 
 				x -= size * 4.f;
 			} break;
@@ -178,82 +562,84 @@ draw_number(int number, float x, float y, float size, u32 color) {
 				// Five is horizontally flipped two
 
 				// Horizontal rectangles are same as two
-				draw_rect(x, y + size * 2.f, 1.5f * size, half_size, color);
-				draw_rect(x, y, 1.5f * size, half_size, color);
-				draw_rect(x, y - size * 2.f, 1.5f * size, half_size, color);
+				push_rect(&batch, x, y + size * 2.f, 1.5f * size, half_size, color);
+				push_rect(&batch, x, y, 1.5f * size, half_size, color);
+				push_rect(&batch, x, y - size * 2.f, 1.5f * size, half_size, color);
 
 				// Vertical rectangles have been flipped horizontally
-				draw_rect(x - size, y + size, half_size, half_size, color);
-				draw_rect(x + size, y - size, half_size, half_size, color);
+				push_rect(&batch, x - size, y + size, half_size, half_size, color);
+				push_rect(&batch, x + size, y - size, half_size, half_size, color);
 
 				x -= size * 4.f;
 			} break;
 
 			case 6: {
 				// Top rectangle of six
-				draw_rect(x + half_size, y + size * 2.f, size, half_size, color);
+				push_rect(&batch, x + half_size, y + size * 2.f, size, half_size, color);
 
 				// Middle rectangle of six
-				draw_rect(x + half_size, y, size, half_size, color);
+				push_rect(&batch, x + half_size, y, size, half_size, color);
 
 				// Bottom rectangle of six
-				draw_rect(x + half_size, y - size * 2.f, size, half_size, color);
+				push_rect(&batch, x + half_size, y - size * 2.f, size, half_size, color);
 
 				// Left vertical rectangle of six (large)
-				draw_rect(x - size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x - size, y, half_size, 2.5f * size, color);
 
 				// Right vertical rectangle of six (small)
-				draw_rect(x + size, y - size, half_size, half_size, color);
+				push_rect(&batch, x + size, y - size, half_size, half_size, color);
 
 				x -= size * 4.f;
 			} break;
 
 			case 7: {
 				// Vertical rectangle of seven
-				draw_rect(x + size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x + size, y, half_size, 2.5f * size, color);
 
 				// Horizontal rectangle of seven
-				draw_rect(x - half_size, y + size * 2.f, size, half_size, color);
+				push_rect(&batch, x - half_size, y + size * 2.f, size, half_size, color);
 
 				x -= size * 4.f;
 			} break;
 
 			case 8: {
 				// Left vertical rectangle of eight
-				draw_rect(x - size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x - size, y, half_size, 2.5f * size, color);
 
 				// Right vertical rectangle of eight
-				draw_rect(x + size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x + size, y, half_size, 2.5f * size, color);
 
 				// Three horizontal rectangles of eight
-				draw_rect(x, y + size * 2.f, half_size, half_size, color);
-				draw_rect(x, y - size * 2.f, half_size, half_size, color);
-				draw_rect(x, y, half_size, half_size, color);
+				push_rect(&batch, x, y + size * 2.f, half_size, half_size, color);
+				push_rect(&batch, x, y - size * 2.f, half_size, half_size, color);
+				push_rect(&batch, x, y, half_size, half_size, color);
 
 				x -= size * 4.f;
 			} break;
 
 			case 9: {
 				// Top rectangle of nine
-				draw_rect(x - half_size, y + size * 2.f, size, half_size, color);
+				push_rect(&batch, x - half_size, y + size * 2.f, size, half_size, color);
 
 				// Middle rectangle of nine
-				draw_rect(x - half_size, y, size, half_size, color);
+				push_rect(&batch, x - half_size, y, size, half_size, color);
 
 				// Bottom rectangle of nine 
-				draw_rect(x - half_size, y - size * 2.f, size, half_size, color);
+				push_rect(&batch, x - half_size, y - size * 2.f, size, half_size, color);
 
 				// Large vertical rectangle of nine
-				draw_rect(x + size, y, half_size, 2.5f * size, color);
+				push_rect(&batch, x + size, y, half_size, 2.5f * size, color);
 
 				// Small vertical rectangle of nine (top left)
-				draw_rect(x - size, y + size, half_size, half_size, color);
+				push_rect(&batch, x - size, y + size, half_size, half_size, color);
 
 				x -= size * 4.f;
 			} break;
 		}
 
 	}
+
+	draw_rect_batch(&batch);
 }
 
 // Char textures using 2D arrays of c-strings
@@ -476,10 +862,13 @@ const char* letters[][7] = {
 };
 
 // Char renderer function
+template <Blend_Mode mode>
 internal void
-draw_text(const char* text, float x, float y, float size, u32 color) {
+draw_text_blended(const char* text, float x, float y, float size, u32 color, u32 alpha) {
 	float half_size = size * .5f;
 	float original_y = y;
+	Rect_Batch batch;
+	batch.count = 0;
 
 	while (*text) {                                 // While we don't react NULL termination
 		if (*text != 32) {                          // 32 is for space
@@ -490,11 +879,11 @@ draw_text(const char* text, float x, float y, float size, u32 color) {
 
 			float original_x = x;                   // Save original x position to be used later
 
-			for (int i = 0; i < 7; i++) {           // Draw char using draw_rect() renderer
+			for (int i = 0; i < 7; i++) {           // Queue the blocks of the char
 				const char* row = letter[i];
 				while (*row) {
 					if (*row == '0') {
-						draw_rect(x, y, half_size, half_size, color);
+						push_rect_blended<mode>(&batch, x, y, half_size, half_size, color, alpha);
 					}
 					x += size;
 					row++;
@@ -507,4 +896,11 @@ draw_text(const char* text, float x, float y, float size, u32 color) {
 		x += size * 6.f;                           // Increase x to print next letter (size*6 skipped if space)
 		y = original_y;                            // Reset y to the original y
 	}
+
+	draw_rect_batch_blended<mode>(&batch);
+}
+
+internal void
+draw_text(const char* text, float x, float y, float size, u32 color) {
+	draw_text_blended<BLEND_OPAQUE>(text, x, y, size, color, 255);
 }
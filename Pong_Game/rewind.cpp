@@ -0,0 +1,246 @@
+// <------------------------- Rewind --------------------------------------------------->
+// Every gameplay tick is kept in a fixed size ring, so a rally can be stepped back and forward from
+// the pause screen and played on from any point. A tick is stored as the XOR of the match state with
+// the tick before, run length encoded: most of the state does not change from one tick to the next,
+// and the high bytes of a value that moved a little XOR to zero. XOR undoes itself, so stepping either
+// way costs one delta. Every REWIND_KEYFRAME_INTERVAL ticks the state is also stored whole; seeks
+// start from the nearest one and the ring is only ever trimmed back to one.
+
+#define REWIND_KEYFRAME_INTERVAL 240
+#define REWIND_MAX_TICKS (60 * 240 + REWIND_KEYFRAME_INTERVAL)  // A minute at 240 Hz, ticks are dropped a keyframe interval at a time
+#define REWIND_BUFFER_SIZE (2 * 1024 * 1024)        // Power of two, ring positions wrap with a mask
+#define REWIND_MAX_RECORD (sizeof(Game_State) * 3)  // A keyframe plus the worst case delta
+
+struct Rewind_Entry {
+	u32 offset;                         // In the data ring, counting up without wrapping
+	u16 size;
+	u16 keyframe_distance;              // Ticks since the last keyframe, 0 for a keyframe (the whole state, then the delta)
+	float dt;
+};
+
+struct Rewind_History {
+	Rewind_Entry entries[REWIND_MAX_TICKS];     // Tick t is entries[t % REWIND_MAX_TICKS]
+	u32 oldest_tick;
+	u32 tick_count;
+	u32 cursor_tick;                    // The tick game_state is at, the newest one unless stepped back
+	u32 data_end;
+	u8 data[REWIND_BUFFER_SIZE];
+	Game_State newest_state;            // What the next tick's delta is taken against
+	Game_State cursor_state;            // Decoded state at cursor_tick
+
+	u64 records;
+	u64 total_record_time;              // os_get_time_counter() units
+	u64 max_record_time;
+};
+
+global_variable Rewind_History rewind_history;
+global_variable bool rewind_scrubbing;      // An arrow is held on the pause screen, so frames keep coming
+
+internal Rewind_Entry*
+get_rewind_entry(u32 tick) {
+	return &rewind_history.entries[tick % REWIND_MAX_TICKS];
+}
+
+internal u32
+newest_rewind_tick() {
+	return rewind_history.oldest_tick + rewind_history.tick_count - 1;
+}
+
+internal void
+clear_rewind_history() {
+	rewind_history.oldest_tick = 0;
+	rewind_history.tick_count = 0;
+	rewind_history.cursor_tick = 0;
+	rewind_history.data_end = 0;
+	rewind_scrubbing = false;
+}
+
+// ---------------- Delta Encoding --------------------------------
+// Pairs of (bytes unchanged, bytes changed) counts, each pair followed by the changed bytes XORed.
+// Unchanged bytes at the end are left out.
+internal u32
+encode_rewind_delta(u8* out, const u8* state, const u8* previous, u32 size) {
+	u32 length = 0;
+	for (u32 at = 0; at < size;) {
+		u32 skip = 0, count = 0;
+		for (u64 a, b; at + skip + 8 <= size && skip + 8 <= 255; skip += 8) {     // Unchanged words first, most of the state
+			memcpy(&a, state + at + skip, 8);
+			memcpy(&b, previous + at + skip, 8);
+			if (a != b) break;
+		}
+		while (at + skip < size && skip < 255 && state[at + skip] == previous[at + skip]) skip++;
+		at += skip;
+		if (at == size) break;
+		while (at + count < size && count < 255 && state[at + count] != previous[at + count]) count++;
+
+		out[length++] = (u8)skip;
+		out[length++] = (u8)count;
+		for (u32 i = 0; i < count; i++) out[length++] = state[at + i] ^ previous[at + i];
+		at += count;
+	}
+	return length;
+}
+
+internal void
+apply_rewind_delta(u8* state, const u8* delta, u32 length) {
+	u32 at = 0;
+	for (u32 i = 0; i + 2 <= length;) {
+		at += delta[i++];
+		u32 count = delta[i++];
+		for (u32 c = 0; c < count; c++) state[at++] ^= delta[i++];
+	}
+}
+
+// ---------------- Data Ring --------------------------------------
+internal void
+write_rewind_bytes(u32 offset, const u8* bytes, u32 size) {
+	u32 at = offset & (REWIND_BUFFER_SIZE - 1);
+	u32 first = size < REWIND_BUFFER_SIZE - at ? size : REWIND_BUFFER_SIZE - at;
+	memcpy(rewind_history.data + at, bytes, first);
+	memcpy(rewind_history.data, bytes + first, size - first);
+}
+
+internal void
+read_rewind_bytes(u8* bytes, u32 offset, u32 size) {
+	u32 at = offset & (REWIND_BUFFER_SIZE - 1);
+	u32 first = size < REWIND_BUFFER_SIZE - at ? size : REWIND_BUFFER_SIZE - at;
+	memcpy(bytes, rewind_history.data + at, first);
+	memcpy(bytes + first, rewind_history.data, size - first);
+}
+
+// Drops the oldest tick and any after it up to the next keyframe, which the oldest tick always has to be
+internal void
+drop_oldest_rewind_ticks() {
+	Rewind_History* history = &rewind_history;
+	do {
+		history->oldest_tick++;
+		history->tick_count--;
+	} while (history->tick_count && get_rewind_entry(history->oldest_tick)->keyframe_distance);
+}
+
+// ---------------- Recording --------------------------------------
+// After every gameplay tick
+internal void
+record_rewind_tick(const Game_State* state, float dt) {
+	Rewind_History* history = &rewind_history;
+	u64 begin = os_get_time_counter();
+
+	// Room for the largest record first, then the new tick is a keyframe if it starts the history
+	while (history->tick_count && (history->tick_count == REWIND_MAX_TICKS ||
+		history->data_end - get_rewind_entry(history->oldest_tick)->offset + REWIND_MAX_RECORD > REWIND_BUFFER_SIZE)) {
+		drop_oldest_rewind_ticks();
+	}
+
+	u8 record[REWIND_MAX_RECORD];
+	u32 size = 0;
+	u16 keyframe_distance = 0;
+	if (history->tick_count) {
+		keyframe_distance = get_rewind_entry(newest_rewind_tick())->keyframe_distance + 1;
+		if (keyframe_distance == REWIND_KEYFRAME_INTERVAL) keyframe_distance = 0;
+	}
+	if (!keyframe_distance) {
+		memcpy(record, state, sizeof(Game_State));
+		size = sizeof(Game_State);
+	}
+	if (history->tick_count) size += encode_rewind_delta(record + size, (const u8*)state, (const u8*)&history->newest_state, sizeof(Game_State));
+
+	u32 tick = history->oldest_tick + history->tick_count;
+	Rewind_Entry* entry = get_rewind_entry(tick);
+	entry->offset = history->data_end;
+	entry->size = (u16)size;
+	entry->keyframe_distance = keyframe_distance;
+	entry->dt = dt;
+	write_rewind_bytes(history->data_end, record, size);
+	history->data_end += size;
+	history->tick_count++;
+	history->cursor_tick = tick;
+	history->newest_state = *state;
+
+	u64 elapsed = os_get_time_counter() - begin;
+	history->records++;
+	history->total_record_time += elapsed;
+	if (elapsed > history->max_record_time) history->max_record_time = elapsed;
+}
+
+// ---------------- Stepping ---------------------------------------
+// Tick t's delta turns the state at t - 1 into the state at t, and back
+internal void
+apply_rewind_tick_delta(Game_State* state, u32 tick) {
+	Rewind_Entry* entry = get_rewind_entry(tick);
+	u8 record[REWIND_MAX_RECORD];
+	read_rewind_bytes(record, entry->offset, entry->size);
+	u32 delta_start = entry->keyframe_distance ? 0 : sizeof(Game_State);
+	apply_rewind_delta((u8*)state, record + delta_start, entry->size - delta_start);
+}
+
+// Moves game_state to any recorded tick, from the nearest keyframe when that is fewer deltas away
+internal void
+seek_rewind(u32 tick) {
+	Rewind_History* history = &rewind_history;
+	if (!history->tick_count) return;
+	u32 newest = newest_rewind_tick();
+	if (tick < history->oldest_tick) tick = history->oldest_tick;
+	if (tick > newest) tick = newest;
+	if (history->cursor_tick == newest) history->cursor_state = history->newest_state;
+
+	u32 keyframe = tick - get_rewind_entry(tick)->keyframe_distance;
+	u32 distance = tick > history->cursor_tick ? tick - history->cursor_tick : history->cursor_tick - tick;
+	if (tick - keyframe < distance) {
+		read_rewind_bytes((u8*)&history->cursor_state, get_rewind_entry(keyframe)->offset, sizeof(Game_State));
+		history->cursor_tick = keyframe;
+	}
+	for (; history->cursor_tick > tick; history->cursor_tick--) apply_rewind_tick_delta(&history->cursor_state, history->cursor_tick);
+	for (; history->cursor_tick < tick; history->cursor_tick++) apply_rewind_tick_delta(&history->cursor_state, history->cursor_tick + 1);
+	game_state = history->cursor_state;
+}
+
+// On the pause screen: the left and right arrows step a tick back and forward (held, a tick a frame),
+// up and down jump a whole keyframe interval
+internal void
+update_rewind_controls(Input* input) {
+	Rewind_History* history = &rewind_history;
+	rewind_scrubbing = is_down(BUTTON_LEFT) || is_down(BUTTON_RIGHT);
+	if (!history->tick_count) return;
+
+	u32 cursor = history->cursor_tick;
+	if (is_down(BUTTON_LEFT) && cursor > history->oldest_tick) cursor--;
+	if (is_down(BUTTON_RIGHT)) cursor++;
+	if (pressed(BUTTON_UP)) cursor = cursor > history->oldest_tick + REWIND_KEYFRAME_INTERVAL ? cursor - REWIND_KEYFRAME_INTERVAL : history->oldest_tick;
+	if (pressed(BUTTON_DOWN)) cursor += REWIND_KEYFRAME_INTERVAL;
+	if (cursor != history->cursor_tick) seek_rewind(cursor);
+}
+
+// Play goes on from the tick on screen, the ticks after it are dropped
+internal void
+resume_from_rewind() {
+	Rewind_History* history = &rewind_history;
+	rewind_scrubbing = false;
+	if (!history->tick_count || history->cursor_tick == newest_rewind_tick()) return;
+	Rewind_Entry* cursor = get_rewind_entry(history->cursor_tick);
+	history->tick_count = history->cursor_tick - history->oldest_tick + 1;
+	history->data_end = cursor->offset + cursor->size;
+	history->newest_state = history->cursor_state;
+}
+
+// Where the pause screen is in the history, drawn only once it has been stepped back
+internal void
+draw_rewind_timeline() {
+	Rewind_History* history = &rewind_history;
+	if (!history->tick_count || history->cursor_tick == newest_rewind_tick()) return;
+	float position = (float)(history->cursor_tick - history->oldest_tick) / (float)(history->tick_count > 1 ? history->tick_count - 1 : 1);
+	draw_rect(0, -20, 30, .5f, 0x404040);
+	draw_rect(-30.f + 60.f * position, -20, .5f, 2, 0xffff66);
+}
+
+// One line summary for the platform to print at exit
+internal int
+format_rewind_report(char* buffer, int size) {
+	Rewind_History* history = &rewind_history;
+	double seconds = 0.0;
+	for (u32 t = 0; t < history->tick_count; t++) seconds += get_rewind_entry(history->oldest_tick + t)->dt;
+	u32 bytes = history->tick_count ? history->data_end - get_rewind_entry(history->oldest_tick)->offset : 0;
+	double us_per_count = 1000000.0 / (double)os_get_time_frequency();
+	return snprintf(buffer, size, "rewind: %u ticks (%.1fs) in %u KB of %u KB, %.1f KB per second, record mean %.2fus, max %.0fus",
+		history->tick_count, seconds, bytes / 1024, REWIND_BUFFER_SIZE / 1024, seconds > 0 ? bytes / 1024.0 / seconds : 0.0,
+		history->records ? history->total_record_time * us_per_count / history->records : 0.0, history->max_record_time * us_per_count);
+}
@@ -0,0 +1,259 @@
+// <------------------------- Sound ---------------------------------------------------->
+// The simulation only posts sound events, into a lock-free single producer, single consumer queue.
+// A mixer thread run by the platform takes them off, starts a voice for each and mixes the voices
+// into fixed blocks of 16-bit stereo for a sink: an audio device, a WAV file or nothing at all.
+// Posting never waits or allocates, a full queue drops the event. The clips are synthesized into
+// the permanent arena at startup, the mixer only copies and scales samples.
+#include <atomic>
+#include <math.h>
+
+#define SOUND_SAMPLE_RATE 48000
+#define SOUND_BLOCK_FRAMES 256              // 5.3ms, an event waits at most this long to be mixed
+#define SOUND_QUEUE_SIZE 64                 // Power of two
+#define SOUND_MAX_VOICES 16
+
+enum Sound_Id {
+	SOUND_PADDLE_HIT,
+	SOUND_WALL_BOUNCE,
+	SOUND_SCORE,
+	SOUND_MATCH_WON,
+
+	SOUND_COUNT,
+};
+
+struct Sound_Event {
+	Sound_Id sound;
+	float pan;                              // -1 left to 1 right
+	u64 time;                               // os_get_time_counter() when posted
+};
+
+struct Sound_Queue {
+	Sound_Event events[SOUND_QUEUE_SIZE];
+	alignas(64) std::atomic<u32> write_index;   // Only stored by the game thread
+	alignas(64) std::atomic<u32> read_index;    // Only stored by the mixer thread
+	u64 dropped;                                // Game thread, events that found the queue full
+};
+
+global_variable Sound_Queue sound_queue;
+global_variable bool sound_enabled;         // Set by the platform once a mixer is running
+global_variable int sound_muted;            // Nonzero while re-simulating ticks that were already heard
+
+// Game thread: posts a sound, dropped when nobody is listening or the mixer has fallen behind
+internal void
+play_sound(Sound_Id sound, float pan) {
+	if (!sound_enabled || sound_muted) return;
+	u32 write = sound_queue.write_index.load(std::memory_order_relaxed);
+	if (write - sound_queue.read_index.load(std::memory_order_acquire) == SOUND_QUEUE_SIZE) {
+		sound_queue.dropped++;
+		return;
+	}
+	Sound_Event* event = &sound_queue.events[write & (SOUND_QUEUE_SIZE - 1)];
+	event->sound = sound;
+	event->pan = pan < -1.f ? -1.f : pan > 1.f ? 1.f : pan;
+	event->time = os_get_time_counter();
+	sound_queue.write_index.store(write + 1, std::memory_order_release);
+}
+
+// Mixer thread
+internal bool
+pop_sound_event(Sound_Event* event) {
+	u32 read = sound_queue.read_index.load(std::memory_order_relaxed);
+	if (read == sound_queue.write_index.load(std::memory_order_acquire)) return false;
+	*event = sound_queue.events[read & (SOUND_QUEUE_SIZE - 1)];
+	sound_queue.read_index.store(read + 1, std::memory_order_release);
+	return true;
+}
+
+// ---------------- Clips ------------------------------------------
+struct Sound_Clip {
+	s16* samples;                           // Mono
+	u32 count;
+};
+
+// A square wave note with an exponential fade, written at offset seconds into the clip
+internal void
+synthesize_note(Sound_Clip* clip, float offset, float seconds, float frequency, float volume) {
+	u32 start = (u32)(offset * SOUND_SAMPLE_RATE);
+	u32 count = (u32)(seconds * SOUND_SAMPLE_RATE);
+	for (u32 i = 0; i < count && start + i < clip->count; i++) {
+		float t = (float)i / SOUND_SAMPLE_RATE;
+		float wave = fmodf(t * frequency, 1.f) < .5f ? 1.f : -1.f;
+		float envelope = expf(-5.f * t / seconds) * (i < 64 ? i / 64.f : 1.f);     // Short attack, no click
+		clip->samples[start + i] = (s16)(32767.f * volume * wave * envelope);
+	}
+}
+
+internal Sound_Clip
+make_sound_clip(Memory_Arena* arena, float seconds) {
+	Sound_Clip clip;
+	clip.count = (u32)(seconds * SOUND_SAMPLE_RATE);
+	clip.samples = push_array(arena, s16, clip.count);
+	if (!clip.samples) clip.count = 0;
+	else memset(clip.samples, 0, clip.count * sizeof(s16));
+	return clip;
+}
+
+// ---------------- Mixer ------------------------------------------
+struct Sound_Voice {
+	const Sound_Clip* clip;
+	u32 position;
+	float left_gain, right_gain;
+};
+
+struct Sound_Mixer {
+	Sound_Clip clips[SOUND_COUNT];
+	Sound_Voice voices[SOUND_MAX_VOICES];
+	int voice_count;
+	float mix[SOUND_BLOCK_FRAMES * 2];
+
+	u64 blocks;
+	u64 underruns;                          // Blocks that reached the sink after it had run dry
+	u64 events_played;
+	u64 voices_stolen;
+	u64 total_latency;                      // os_get_time_counter() units from posting to mixing
+	u64 max_latency;
+};
+
+internal void
+init_sound_mixer(Sound_Mixer* mixer, Memory_Arena* arena) {
+	*mixer = {};
+	Sound_Clip* clips = mixer->clips;
+	clips[SOUND_PADDLE_HIT] = make_sound_clip(arena, .08f);
+	synthesize_note(&clips[SOUND_PADDLE_HIT], 0.f, .08f, 440.f, .25f);
+	clips[SOUND_WALL_BOUNCE] = make_sound_clip(arena, .05f);
+	synthesize_note(&clips[SOUND_WALL_BOUNCE], 0.f, .05f, 220.f, .2f);
+	clips[SOUND_SCORE] = make_sound_clip(arena, .3f);
+	synthesize_note(&clips[SOUND_SCORE], 0.f, .15f, 660.f, .25f);
+	synthesize_note(&clips[SOUND_SCORE], .15f, .15f, 440.f, .25f);
+	clips[SOUND_MATCH_WON] = make_sound_clip(arena, .6f);
+	const float notes[] = { 523.f, 659.f, 784.f, 1047.f };
+	for (int n = 0; n < 4; n++) synthesize_note(&clips[SOUND_MATCH_WON], .15f * n, .15f, notes[n], .25f);
+}
+
+// Starts the posted sounds and mixes the next block into samples (SOUND_BLOCK_FRAMES interleaved stereo pairs)
+internal void
+mix_sound_block(Sound_Mixer* mixer, s16* samples) {
+	Sound_Event event;
+	while (pop_sound_event(&event)) {
+		u64 latency = os_get_time_counter() - event.time;
+		mixer->total_latency += latency;
+		if (latency > mixer->max_latency) mixer->max_latency = latency;
+		mixer->events_played++;
+
+		// All voices busy: the one closest to its end makes room
+		int v = mixer->voice_count;
+		if (v == SOUND_MAX_VOICES) {
+			v = 0;
+			for (int i = 1; i < mixer->voice_count; i++) {
+				const Sound_Voice* voice = &mixer->voices[i];
+				const Sound_Voice* stolen = &mixer->voices[v];
+				if (voice->clip->count - voice->position < stolen->clip->count - stolen->position) v = i;
+			}
+			mixer->voices_stolen++;
+		}
+		else mixer->voice_count++;
+
+		// Constant power panning
+		float angle = (event.pan + 1.f) * .25f * 3.14159265f;
+		Sound_Voice* voice = &mixer->voices[v];
+		voice->clip = &mixer->clips[event.sound];
+		voice->position = 0;
+		voice->left_gain = cosf(angle);
+		voice->right_gain = sinf(angle);
+	}
+
+	memset(mixer->mix, 0, sizeof(mixer->mix));
+	for (int v = 0; v < mixer->voice_count;) {
+		Sound_Voice* voice = &mixer->voices[v];
+		u32 remaining = voice->clip->count - voice->position;
+		u32 count = remaining < SOUND_BLOCK_FRAMES ? remaining : SOUND_BLOCK_FRAMES;
+		const s16* clip = voice->clip->samples + voice->position;
+		for (u32 i = 0; i < count; i++) {
+			mixer->mix[2 * i] += clip[i] * voice->left_gain;
+			mixer->mix[2 * i + 1] += clip[i] * voice->right_gain;
+		}
+
+		voice->position += count;
+		if (voice->position == voice->clip->count) *voice = mixer->voices[--mixer->voice_count];
+		else v++;
+	}
+
+	for (int i = 0; i < SOUND_BLOCK_FRAMES * 2; i++) {
+		float sample = mixer->mix[i];
+		samples[i] = (s16)(sample > 32767.f ? 32767.f : sample < -32768.f ? -32768.f : sample);
+	}
+	mixer->blocks++;
+}
+
+// One line summary for the platform to print at exit
+internal int
+format_sound_report(const Sound_Mixer* mixer, char* buffer, int size) {
+	double ms_per_count = 1000.0 / (double)os_get_time_frequency();
+	return snprintf(buffer, size, "sound: %llu blocks of %.1fms, %llu events played, %llu dropped, %llu voices stolen, %llu underruns, event to mix mean %.2fms, max %.2fms",
+		mixer->blocks, 1000.f * SOUND_BLOCK_FRAMES / SOUND_SAMPLE_RATE, mixer->events_played, sound_queue.dropped, mixer->voices_stolen, mixer->underruns,
+		mixer->events_played ? mixer->total_latency * ms_per_count / mixer->events_played : 0.0, mixer->max_latency * ms_per_count);
+}
+
+// ---------------- Sinks ------------------------------------------
+// Where mixed blocks go. A device sink's write waits for room, so the device's clock paces the mixer,
+// and returns false when the device had already run dry. The null and WAV sinks here take blocks as
+// fast as they come, the platform's mixer thread keeps time for them.
+struct Sound_Sink {
+	void* data;
+	bool (*write)(Sound_Sink* sink, const s16* samples, int frames);
+	void (*close)(Sound_Sink* sink);
+};
+
+internal bool null_sink_write(Sound_Sink*, const s16*, int) { return true; }
+internal void null_sink_close(Sound_Sink*) {}
+
+internal Sound_Sink
+make_null_sound_sink() {
+	Sound_Sink sink = { 0, null_sink_write, null_sink_close };
+	return sink;
+}
+
+// 16-bit stereo PCM, the sizes in the header are filled in on close
+struct Wav_Header {
+	char riff[4];
+	u32 riff_size;
+	char wave[4];
+	char fmt[4];
+	u32 fmt_size;
+	u16 format;
+	u16 channels;
+	u32 sample_rate;
+	u32 byte_rate;
+	u16 block_align;
+	u16 bits_per_sample;
+	char data[4];
+	u32 data_size;
+};
+
+internal bool
+wav_sink_write(Sound_Sink* sink, const s16* samples, int frames) {
+	fwrite(samples, 2 * sizeof(s16), frames, (FILE*)sink->data);
+	return true;
+}
+
+internal void
+wav_sink_close(Sound_Sink* sink) {
+	FILE* file = (FILE*)sink->data;
+	u32 data_size = (u32)(ftell(file) - sizeof(Wav_Header));
+	u32 riff_size = data_size + (u32)sizeof(Wav_Header) - 8;
+	Wav_Header header = { { 'R', 'I', 'F', 'F' }, riff_size, { 'W', 'A', 'V', 'E' }, { 'f', 'm', 't', ' ' },
+		16, 1, 2, SOUND_SAMPLE_RATE, SOUND_SAMPLE_RATE * 2 * sizeof(s16), 2 * sizeof(s16), 16, { 'd', 'a', 't', 'a' }, data_size };
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+}
+
+internal bool
+make_wav_sound_sink(Sound_Sink* sink, const char* path) {
+	FILE* file = fopen(path, "wb");
+	if (!file) return false;
+	Wav_Header header = {};
+	fwrite(&header, sizeof(header), 1, file);
+	*sink = { file, wav_sink_write, wav_sink_close };
+	return true;
+}
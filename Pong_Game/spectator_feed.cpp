@@ -0,0 +1,219 @@
+// <------------------------- Spectator Feed ------------------------------------------->
+// The game publishes every tick's state, and optionally every finished frame, into a block of shared
+// memory that other processes on the machine can watch. There is one writer and any number of readers,
+// and the writer never waits for them or knows they are there. Ticks go into a ring of slots, each
+// guarded by a sequence number (a seqlock): odd while the writer fills the slot, 2n + 2 once it holds
+// tick n. A reader copies a slot and checks the sequence before and after, if it moved the writer
+// lapped the reader and the copy is dropped. Readers map the block read-only, so one that stalls or
+// dies holds nothing up. Frames work the same way in a ring of their own.
+// Shared by the writer (linux_platform.cpp) and readers (linux_spectator.cpp), so nothing in here
+// comes from the game: a tick is a flat copy of what a viewer needs.
+#include <atomic>
+
+#define SPECTATOR_MAGIC 0x43455053          // "SPEC"
+#define SPECTATOR_VERSION 1
+#define SPECTATOR_TICK_SLOTS 256
+#define SPECTATOR_FRAME_SLOTS 3
+#define SPECTATOR_MAX_PADDLES 4
+#define SPECTATOR_MAX_BALLS 16
+
+struct Spectator_Tick {
+	u64 tick;
+	u64 time;                               // Writer's clock in nanoseconds when it was published
+	s32 gamemode;                           // Gamemode in game.cpp
+	s32 score[2];                           // Right side, left side
+	s32 which_player_won;                   // 0 nobody yet, 1 the right side, 2 the left side
+	s32 paddle_count;
+	s32 ball_count;
+	float paddle_px[SPECTATOR_MAX_PADDLES], paddle_py[SPECTATOR_MAX_PADDLES];
+	float ball_px[SPECTATOR_MAX_BALLS], ball_py[SPECTATOR_MAX_BALLS];
+	u64 tick_end;                           // tick again, a torn copy that got past the sequence check would not match
+};
+
+struct alignas(64) Spectator_Slot {
+	std::atomic<u64> sequence;
+	Spectator_Tick tick;
+};
+
+// Followed by frame_width * frame_height pixels in framebuffer order
+struct alignas(64) Spectator_Frame_Slot {
+	std::atomic<u64> sequence;
+	u64 tick;                               // The tick the frame shows
+};
+
+struct Spectator_Header {
+	std::atomic<u32> magic;                 // Stored last, a reader that sees it sees the rest of the header
+	u32 version;
+	u32 tick_slot_count;
+	u32 frame_slot_count;                   // 0 when frames are not published
+	s32 frame_width, frame_height;
+	u64 frame_slot_size;
+	std::atomic<u32> writer_closed;         // The writer exited, readers should let go of the block
+	alignas(64) std::atomic<u64> ticks_published;
+	alignas(64) std::atomic<u64> frames_published;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the feed's sequence numbers are shared between processes");
+
+#define SPECTATOR_HEADER_SIZE ((sizeof(Spectator_Header) + 63) & ~(size_t)63)
+
+internal u64
+spectator_frame_slot_size(int frame_width, int frame_height) {
+	return (sizeof(Spectator_Frame_Slot) + (u64)frame_width * frame_height * sizeof(u32) + 63) & ~(u64)63;
+}
+
+// The whole block, frames only when they have a size
+internal size_t
+spectator_feed_size(int frame_width, int frame_height) {
+	size_t frame_slots = frame_width > 0 && frame_height > 0 ? SPECTATOR_FRAME_SLOTS : 0;
+	return SPECTATOR_HEADER_SIZE + SPECTATOR_TICK_SLOTS * sizeof(Spectator_Slot) + frame_slots * spectator_frame_slot_size(frame_width, frame_height);
+}
+
+internal Spectator_Slot*
+get_spectator_slot(const Spectator_Header* header, u64 tick) {
+	u8* ticks = (u8*)header + SPECTATOR_HEADER_SIZE;
+	return (Spectator_Slot*)ticks + tick % header->tick_slot_count;
+}
+
+internal Spectator_Frame_Slot*
+get_spectator_frame_slot(const Spectator_Header* header, u64 frame) {
+	u8* frames = (u8*)header + SPECTATOR_HEADER_SIZE + header->tick_slot_count * sizeof(Spectator_Slot);
+	return (Spectator_Frame_Slot*)(frames + (frame % header->frame_slot_count) * header->frame_slot_size);
+}
+
+internal u32*
+get_spectator_frame_pixels(Spectator_Frame_Slot* slot) {
+	return (u32*)(slot + 1);
+}
+
+// ---------------- Writer ----------------------------------------
+// On a zeroed block of spectator_feed_size() bytes, frame_width and frame_height 0 for no frames
+internal void
+init_spectator_feed(Spectator_Header* header, int frame_width, int frame_height) {
+	header->version = SPECTATOR_VERSION;
+	header->tick_slot_count = SPECTATOR_TICK_SLOTS;
+	header->frame_slot_count = frame_width > 0 && frame_height > 0 ? SPECTATOR_FRAME_SLOTS : 0;
+	header->frame_width = frame_width;
+	header->frame_height = frame_height;
+	header->frame_slot_size = spectator_frame_slot_size(frame_width, frame_height);
+	header->magic.store(SPECTATOR_MAGIC, std::memory_order_release);
+}
+
+internal void
+publish_spectator_tick(Spectator_Header* header, Spectator_Tick* tick) {
+	u64 n = header->ticks_published.load(std::memory_order_relaxed);
+	tick->tick = n;
+	tick->tick_end = n;
+
+	Spectator_Slot* slot = get_spectator_slot(header, n);
+	slot->sequence.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(&slot->tick, tick, sizeof(*tick));
+	slot->sequence.store(2 * n + 2, std::memory_order_release);
+	header->ticks_published.store(n + 1, std::memory_order_release);
+}
+
+internal void
+publish_spectator_frame(Spectator_Header* header, const void* pixels, u64 tick) {
+	if (!header->frame_slot_count) return;
+	u64 n = header->frames_published.load(std::memory_order_relaxed);
+
+	Spectator_Frame_Slot* slot = get_spectator_frame_slot(header, n);
+	slot->sequence.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot->tick = tick;
+	memcpy(get_spectator_frame_pixels(slot), pixels, (size_t)header->frame_width * header->frame_height * sizeof(u32));
+	slot->sequence.store(2 * n + 2, std::memory_order_release);
+	header->frames_published.store(n + 1, std::memory_order_release);
+}
+
+// ---------------- Reader ----------------------------------------
+enum Spectator_Read {
+	SPECTATOR_READ_OK,
+	SPECTATOR_NOT_YET,                      // Not published yet
+	SPECTATOR_OVERWRITTEN,                  // The writer has moved past it, or did while it was copied
+};
+
+internal bool
+is_spectator_feed_ready(const Spectator_Header* header) {
+	return header->magic.load(std::memory_order_acquire) == SPECTATOR_MAGIC && header->version == SPECTATOR_VERSION;
+}
+
+internal Spectator_Read
+read_spectator_tick(const Spectator_Header* header, u64 tick, Spectator_Tick* out) {
+	Spectator_Slot* slot = get_spectator_slot(header, tick);
+	u64 expected = 2 * tick + 2;
+	u64 before = slot->sequence.load(std::memory_order_acquire);
+	if (before < expected) return SPECTATOR_NOT_YET;
+	if (before > expected) return SPECTATOR_OVERWRITTEN;
+
+	memcpy(out, &slot->tick, sizeof(*out));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (slot->sequence.load(std::memory_order_relaxed) != before) return SPECTATOR_OVERWRITTEN;
+	return SPECTATOR_READ_OK;
+}
+
+// The newest finished frame into pixels (frame_width * frame_height), false if there is none or the
+// writer got to its slot first
+internal bool
+read_latest_spectator_frame(const Spectator_Header* header, u32* pixels, u64* tick) {
+	u64 published = header->frames_published.load(std::memory_order_acquire);
+	if (!header->frame_slot_count || !published) return false;
+
+	u64 n = published - 1;
+	Spectator_Frame_Slot* slot = get_spectator_frame_slot(header, n);
+	u64 before = slot->sequence.load(std::memory_order_acquire);
+	if (before != 2 * n + 2) return false;
+
+	*tick = slot->tick;
+	memcpy(pixels, get_spectator_frame_pixels(slot), (size_t)header->frame_width * header->frame_height * sizeof(u32));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return slot->sequence.load(std::memory_order_relaxed) == before;
+}
+
+// Where one reader is in the feed
+struct Spectator_Reader {
+	u64 next_tick;
+	u64 ticks_read;
+	u64 ticks_missed;                       // Overwritten before this reader got to them
+	u64 torn_reads;                         // Copies the sequence check passed that did not match, always 0
+	Spectator_Tick latest;
+};
+
+// Starts at the newest tick, the ones from before the reader attached are not missed
+internal void
+init_spectator_reader(Spectator_Reader* reader, const Spectator_Header* header) {
+	*reader = {};
+	reader->next_tick = header->ticks_published.load(std::memory_order_acquire);
+}
+
+// Reads every tick published since the last call into reader->latest, skipping ahead when the writer
+// has lapped the reader. Returns how many ticks were read.
+internal int
+follow_spectator_feed(const Spectator_Header* header, Spectator_Reader* reader) {
+	int count = 0;
+	u64 published = header->ticks_published.load(std::memory_order_acquire);
+	while (reader->next_tick < published) {
+		// Lapped: skip to half a ring behind the writer, so the next copies do not get overwritten too
+		u64 oldest = published > header->tick_slot_count ? published - header->tick_slot_count / 2 : 0;
+		if (reader->next_tick < oldest) {
+			reader->ticks_missed += oldest - reader->next_tick;
+			reader->next_tick = oldest;
+		}
+
+		Spectator_Tick tick;
+		Spectator_Read result = read_spectator_tick(header, reader->next_tick, &tick);
+		if (result == SPECTATOR_NOT_YET) break;
+		if (result == SPECTATOR_OVERWRITTEN) {
+			published = header->ticks_published.load(std::memory_order_acquire);
+			continue;
+		}
+
+		if (tick.tick != reader->next_tick || tick.tick_end != reader->next_tick) reader->torn_reads++;
+		else reader->latest = tick;
+		reader->next_tick++;
+		reader->ticks_read++;
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,225 @@
+// <------------------------- Multi-Ball Stress Mode ----------------------------------->
+// Hundreds to tens of thousands of balls bounce around the arena under the normal ball rules.
+// A uniform grid over the arena is the broadphase: each ball sits in the intrusive list of the
+// cell holding its centre and only moves to another list when it crosses a cell edge, so
+// ball-vs-paddle and ball-vs-ball checks only look at nearby balls.
+
+#define MAX_STRESS_BALLS 32768
+#define MIN_STRESS_BALLS 256
+
+// Grid cells are two balls wide so that overlapping balls are always in neighbouring cells
+#define STRESS_GRID_COLS 90
+#define STRESS_GRID_ROWS 45
+#define STRESS_GRID_CELLS (STRESS_GRID_COLS * STRESS_GRID_ROWS)
+#define STRESS_NO_BALL -1
+
+const real stress_ball_hs = .5f;
+const real stress_cell_size = 2.f * arena_half_size_x / STRESS_GRID_COLS;
+
+struct Stress_State {
+	int count;
+	bool balls_collide;                 // Ball vs ball collisions, off by default
+
+	// Hot ball data
+	real px[MAX_STRESS_BALLS], py[MAX_STRESS_BALLS];
+	real dpx[MAX_STRESS_BALLS], dpy[MAX_STRESS_BALLS];
+
+	// Broadphase: per cell doubly linked lists of ball indices
+	int cell[MAX_STRESS_BALLS];
+	int next[MAX_STRESS_BALLS], prev[MAX_STRESS_BALLS];
+	int cell_head[STRESS_GRID_CELLS];
+
+	u32 random_state;
+
+	// Load test counters for the last tick
+	int pairs_tested;
+	float ns_per_ball;
+};
+
+Stress_State stress_state = {};
+
+// Worked out in float and then converted, (max - min) * 65535 is past the range of fixed point
+internal real
+stress_random_range(Stress_State* stress, float min, float max) {
+	return (real)(min + (max - min) * (float)(random_u32(&stress->random_state) & 0xffff) / 65535.f);
+}
+
+internal int
+stress_cell_x(real px) {
+	return clamp(0, (int)((px + arena_half_size_x) / stress_cell_size), STRESS_GRID_COLS - 1);
+}
+
+internal int
+stress_cell_y(real py) {
+	return clamp(0, (int)((py + arena_half_size_y) / stress_cell_size), STRESS_GRID_ROWS - 1);
+}
+
+internal int
+stress_cell_of(real px, real py) {
+	return stress_cell_y(py) * STRESS_GRID_COLS + stress_cell_x(px);
+}
+
+internal void
+stress_link(Stress_State* stress, int b, int cell) {
+	stress->cell[b] = cell;
+	stress->prev[b] = STRESS_NO_BALL;
+	stress->next[b] = stress->cell_head[cell];
+	if (stress->cell_head[cell] != STRESS_NO_BALL) stress->prev[stress->cell_head[cell]] = b;
+	stress->cell_head[cell] = b;
+}
+
+internal void
+stress_unlink(Stress_State* stress, int b) {
+	if (stress->prev[b] != STRESS_NO_BALL) stress->next[stress->prev[b]] = stress->next[b];
+	else stress->cell_head[stress->cell[b]] = stress->next[b];
+	if (stress->next[b] != STRESS_NO_BALL) stress->prev[stress->next[b]] = stress->prev[b];
+}
+
+// Serves ball b from the centre line in a random direction
+internal void
+stress_serve_ball(Stress_State* stress, int b) {
+	stress->px[b] = 0.f;
+	stress->py[b] = stress_random_range(stress, -(float)arena_half_size_y + 1.f, (float)arena_half_size_y - 1.f);
+	stress->dpx[b] = (random_u32(&stress->random_state) & 1) ? 100.f : -100.f;
+	stress->dpy[b] = stress_random_range(stress, -60.f, 60.f);
+}
+
+internal void
+init_stress_mode(Stress_State* stress, int count) {
+	stress->count = clamp(MIN_STRESS_BALLS, count, MAX_STRESS_BALLS);
+	if (!stress->random_state) stress->random_state = 0x9e3779b9;
+
+	for (int c = 0; c < STRESS_GRID_CELLS; c++) {
+		stress->cell_head[c] = STRESS_NO_BALL;
+	}
+	for (int b = 0; b < stress->count; b++) {
+		stress_serve_ball(stress, b);
+		stress->px[b] = stress_random_range(stress, -(float)arena_half_size_x, (float)arena_half_size_x);
+		stress_link(stress, b, stress_cell_of(stress->px[b], stress->py[b]));
+	}
+}
+
+// Elastic hit between two equal balls: swap velocities along the axis of least overlap and separate them
+internal void
+stress_collide_balls(Stress_State* stress, int a, int b) {
+	real dx = stress->px[b] - stress->px[a];
+	real dy = stress->py[b] - stress->py[a];
+	real overlap_x = 2.f * stress_ball_hs - (dx < 0 ? -dx : dx);
+	real overlap_y = 2.f * stress_ball_hs - (dy < 0 ? -dy : dy);
+
+	if (overlap_x < overlap_y) {
+		if ((stress->dpx[b] - stress->dpx[a]) * dx >= 0) return;   // Already separating
+		real swap = stress->dpx[a]; stress->dpx[a] = stress->dpx[b]; stress->dpx[b] = swap;
+		real push = (dx < 0 ? -.5f : .5f) * overlap_x;
+		stress->px[a] -= push, stress->px[b] += push;
+	}
+	else {
+		if ((stress->dpy[b] - stress->dpy[a]) * dy >= 0) return;
+		real swap = stress->dpy[a]; stress->dpy[a] = stress->dpy[b]; stress->dpy[b] = swap;
+		real push = (dy < 0 ? -.5f : .5f) * overlap_y;
+		stress->py[a] -= push, stress->py[b] += push;
+	}
+}
+
+// Tests ball a against every ball in the list starting at b
+internal void
+stress_collide_list(Stress_State* stress, int a, int b) {
+	for (; b != STRESS_NO_BALL; b = stress->next[b]) {
+		stress->pairs_tested++;
+		if (aabb_vs_aabb(stress->px[a], stress->py[a], stress_ball_hs, stress_ball_hs,
+			stress->px[b], stress->py[b], stress_ball_hs, stress_ball_hs)) {
+			stress_collide_balls(stress, a, b);
+		}
+	}
+}
+
+internal void
+simulate_stress_mode(Stress_State* stress, Paddle_Pool* paddles, const Paddle_Traits* traits, real dt) {
+	u64 tick_begin = os_get_time_counter();
+	int count = stress->count;
+	stress->pairs_tested = 0;
+
+	// Equations of Motion:-
+	for (int b = 0; b < count; b++) {
+		stress->px[b] += stress->dpx[b] * dt;
+		stress->py[b] += stress->dpy[b] * dt;
+	}
+
+	// Broadphase update: only balls that crossed into another cell move between lists
+	for (int b = 0; b < count; b++) {
+		int cell = stress_cell_of(stress->px[b], stress->py[b]);
+		if (cell != stress->cell[b]) {
+			stress_unlink(stress, b);
+			stress_link(stress, b, cell);
+		}
+	}
+
+	// Ball Collision with Players :- only the cells under each paddle (grown by a ball) are visited
+	for (int p = 0; p < paddles->count; p++) {
+		real reach_x = traits->half_size_x[p] + stress_ball_hs;
+		real reach_y = traits->half_size_y[p] + stress_ball_hs;
+		int x0 = stress_cell_x(paddles->px[p] - reach_x), x1 = stress_cell_x(paddles->px[p] + reach_x);
+		int y0 = stress_cell_y(paddles->py[p] - reach_y), y1 = stress_cell_y(paddles->py[p] + reach_y);
+
+		for (int y = y0; y <= y1; y++) {
+			for (int x = x0; x <= x1; x++) {
+				for (int b = stress->cell_head[y * STRESS_GRID_COLS + x]; b != STRESS_NO_BALL; b = stress->next[b]) {
+					stress->pairs_tested++;
+					if (aabb_vs_aabb(stress->px[b], stress->py[b], stress_ball_hs, stress_ball_hs,
+						paddles->px[p], paddles->py[p], traits->half_size_x[p], traits->half_size_y[p])) {
+						bounce_ball_off_paddle(&stress->px[b], stress->py[b], &stress->dpx[b], &stress->dpy[b], stress_ball_hs, paddles, traits, p);
+					}
+				}
+			}
+		}
+	}
+
+	// Ball Collision with Balls :- each pair once, from the ball's own cell and its forward neighbours
+	if (stress->balls_collide) {
+		for (int c = 0; c < STRESS_GRID_CELLS; c++) {
+			int cx = c % STRESS_GRID_COLS, cy = c / STRESS_GRID_COLS;
+			for (int a = stress->cell_head[c]; a != STRESS_NO_BALL; a = stress->next[a]) {
+				stress_collide_list(stress, a, stress->next[a]);
+				if (cx + 1 < STRESS_GRID_COLS) stress_collide_list(stress, a, stress->cell_head[c + 1]);
+				if (cy + 1 < STRESS_GRID_ROWS) {
+					if (cx > 0) stress_collide_list(stress, a, stress->cell_head[c + STRESS_GRID_COLS - 1]);
+					stress_collide_list(stress, a, stress->cell_head[c + STRESS_GRID_COLS]);
+					if (cx + 1 < STRESS_GRID_COLS) stress_collide_list(stress, a, stress->cell_head[c + STRESS_GRID_COLS + 1]);
+				}
+			}
+		}
+	}
+
+	// Speed clamps, top and bottom walls, and a new serve for balls leaving the arena
+	for (int b = 0; b < count; b++) {
+		apply_ball_limits(&stress->py[b], &stress->dpx[b], &stress->dpy[b], stress_ball_hs);
+		if (stress->px[b] + stress_ball_hs > 99.f || stress->px[b] + stress_ball_hs < -99.f) {
+			stress_serve_ball(stress, b);
+		}
+	}
+
+	u64 tick_end = os_get_time_counter();
+	stress->ns_per_ball = 1000000000.f * (float)(tick_end - tick_begin) / (float)os_get_time_frequency() / (float)count;
+}
+
+internal void
+render_stress_mode(const Stress_State* stress, const Game_State* state) {
+	draw_arena((float)arena_half_size_x, (float)arena_half_size_y, 0x000000, 0x006400);
+
+	for (int b = 0; b < stress->count; b++) {
+		draw_rect((float)stress->px[b], (float)stress->py[b], (float)stress_ball_hs, (float)stress_ball_hs, 0xffff66);
+	}
+
+	const Paddle_Pool* paddles = &state->paddles;
+	for (int p = 0; p < paddles->count; p++) {
+		draw_rect((float)paddles->px[p], (float)paddles->py[p], (float)state->paddle_traits.half_size_x[p], (float)state->paddle_traits.half_size_y[p], state->paddle_traits.color[p]);
+	}
+
+	// Load test readout
+	draw_text("BALLS", -85, 43, .5f, 0xffffff);
+	draw_number(stress->count, -40, 41, .5f, 0xbbffbb);
+	draw_text("PAIRS", -25, 43, .5f, 0xffffff);
+	draw_number(stress->pairs_tested, 25, 41, .5f, 0xbbffbb);
+	draw_text("NS PER BALL", 35, 43, .5f, 0xffffff);
+	draw_number((int)stress->ns_per_ball, 85, 41, .5f, 0xbbffbb);
+}
@@ -0,0 +1,214 @@
+// <------------------------- Suspend and Resume -------------------------------------->
+// A match in progress is written out when the player quits it, when the program exits or crashes,
+// and every few seconds of play, then picked up paused on the next launch. The file is a versioned
+// field by field encoding of the simulation (only the paddles and balls in use), built in a static
+// buffer so writing it never allocates and can run from a crash handler.
+
+#define SUSPEND_MAGIC 0x53555350        // "PSUS"
+#define SUSPEND_VERSION 1
+#define SUSPEND_MAX_SIZE 2048
+#define SUSPEND_AUTOSAVE_SECONDS 2.f
+
+struct Suspend_Header {
+	u32 magic;
+	u16 version;
+	u8 real_format;                     // PONG_FIXED_POINT of the writer, the two are not interchangeable
+	u8 unused;
+	u32 payload_size;
+	u32 checksum;                       // FNV-1a of the payload
+};
+
+struct Suspend_Buffer {
+	u8* data;
+	u32 size;
+	u32 capacity;
+	bool overflowed;                    // Ran past the end, the contents are not usable
+};
+
+struct Suspend_Stats {
+	u64 writes;
+	u64 total_write_time;               // os_get_time_counter() units, serializing and writing
+	u64 max_write_time;
+	u64 resume_time;
+	bool resumed;
+};
+
+global_variable u8 suspend_data[SUSPEND_MAX_SIZE];
+global_variable float suspend_autosave_timer;
+global_variable Suspend_Stats suspend_stats;
+
+internal void
+suspend_put(Suspend_Buffer* buffer, const void* data, u32 size) {
+	if (buffer->overflowed || size > buffer->capacity - buffer->size) buffer->overflowed = true;
+	else memcpy(buffer->data + buffer->size, data, size);
+	buffer->size += size;
+}
+
+internal void
+suspend_get(Suspend_Buffer* buffer, void* data, u32 size) {
+	if (buffer->overflowed || size > buffer->capacity - buffer->size) {
+		buffer->overflowed = true;
+		memset(data, 0, size);
+	}
+	else memcpy(data, buffer->data + buffer->size, size);
+	buffer->size += size;
+}
+
+#define suspend_put_value(buffer, value) suspend_put(buffer, &(value), sizeof(value))
+#define suspend_get_value(buffer, value) suspend_get(buffer, &(value), sizeof(value))
+
+internal u32
+suspend_checksum(const u8* data, u32 size) {
+	u32 hash = 2166136261u;
+	for (u32 i = 0; i < size; i++) hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+// Only single player and local multiplayer matches, netplay and the stress mode cannot be resumed alone
+internal bool
+is_match_in_progress() {
+	if (netplay_session.active || game_state.which_player_won != PLAYER_NULL) return false;
+	return current_gamemode == GM_GAMEPLAY || current_gamemode == GM_PAUSED || current_gamemode == GM_QUIT;
+}
+
+// Both directions go through one field list, so the encoder and decoder cannot drift apart
+internal void
+transfer_match(Suspend_Buffer* buffer, Game_State* state, bool writing) {
+#define transfer(value) (writing ? suspend_put_value(buffer, value) : suspend_get_value(buffer, value))
+	u8 paddle_count = (u8)state->paddles.count, ball_count = (u8)state->balls.count;
+	transfer(paddle_count);
+	transfer(ball_count);
+	if (paddle_count > MAX_PADDLES || ball_count > MAX_BALLS) {
+		buffer->overflowed = true;
+		return;
+	}
+	state->paddles.count = paddle_count;
+	state->balls.count = ball_count;
+
+	for (int i = 0; i < paddle_count; i++) {
+		transfer(state->paddles.px[i]);
+		transfer(state->paddles.py[i]);
+		transfer(state->paddles.dpx[i]);
+		transfer(state->paddles.dpy[i]);
+		transfer(state->paddles.hit_ball[i]);
+		transfer(state->paddle_traits.half_size_x[i]);
+		transfer(state->paddle_traits.half_size_y[i]);
+		transfer(state->paddle_traits.color[i]);
+		transfer(state->paddle_traits.side[i]);
+		transfer(state->paddle_traits.is_ai[i]);
+		transfer(state->paddle_traits.key_up[i]);
+		transfer(state->paddle_traits.key_down[i]);
+		transfer(state->paddle_traits.key_left[i]);
+		transfer(state->paddle_traits.key_right[i]);
+		transfer(state->ai.planned_event[i]);
+		transfer(state->ai.target_py[i]);
+		transfer(state->ai.next_target_py[i]);
+		transfer(state->ai.reaction_timer[i]);
+		transfer(state->ai.intercept_timer[i]);
+	}
+	for (int i = 0; i < ball_count; i++) {
+		transfer(state->balls.px[i]);
+		transfer(state->balls.py[i]);
+		transfer(state->balls.dpx[i]);
+		transfer(state->balls.dpy[i]);
+		transfer(state->ball_traits.half_size_x[i]);
+		transfer(state->ball_traits.half_size_y[i]);
+		transfer(state->ball_traits.color[i]);
+	}
+	transfer(state->score);
+	transfer(state->which_player_won);
+	transfer(state->random_state);
+	transfer(state->ai_random_state);
+	transfer(state->ball_events);
+	transfer(state->keeps_stats);
+#undef transfer
+}
+
+// Writes the match in progress, returns false if there is none or the platform could not write it
+internal bool
+suspend_match() {
+	if (!is_match_in_progress()) return false;
+	u64 begin = os_get_time_counter();
+
+	Suspend_Buffer buffer = { suspend_data + sizeof(Suspend_Header), 0, SUSPEND_MAX_SIZE - sizeof(Suspend_Header), false };
+	suspend_put_value(&buffer, is_player1_ai);
+	suspend_put_value(&buffer, is_player2_ai);
+	transfer_match(&buffer, &game_state, true);
+	if (buffer.overflowed) return false;
+
+	Suspend_Header header = { SUSPEND_MAGIC, SUSPEND_VERSION, PONG_FIXED_POINT, 0, buffer.size, suspend_checksum(buffer.data, buffer.size) };
+	memcpy(suspend_data, &header, sizeof(header));
+	String data = { (char*)suspend_data, (unsigned int)(sizeof(header) + buffer.size) };
+	bool written = os_write_suspend_file(data);
+
+	if (written) {
+		u64 elapsed = os_get_time_counter() - begin;
+		suspend_stats.writes++;
+		suspend_stats.total_write_time += elapsed;
+		if (elapsed > suspend_stats.max_write_time) suspend_stats.max_write_time = elapsed;
+	}
+	return written;
+}
+
+// A finished match is not resumed
+internal void
+clear_suspended_match() {
+	String empty = {};
+	os_write_suspend_file(empty);
+}
+
+// Called by the platform at startup, returns true if a match was resumed (it starts paused)
+internal bool
+resume_match() {
+	u64 begin = os_get_time_counter();
+	String file = os_read_suspend_file(&game_memory.transient);
+	Suspend_Header header;
+	if (file.size < sizeof(header)) return false;
+	memcpy(&header, file.data, sizeof(header));
+	if (header.magic != SUSPEND_MAGIC || header.version != SUSPEND_VERSION || header.real_format != PONG_FIXED_POINT ||
+		header.payload_size != file.size - sizeof(header)) return false;
+
+	Suspend_Buffer buffer = { (u8*)file.data + sizeof(header), 0, header.payload_size, false };
+	if (suspend_checksum(buffer.data, buffer.capacity) != header.checksum) return false;
+
+	// Decoded into a copy, so a bad file leaves the game as it was
+	bool player1_ai, player2_ai;
+	Game_State state = {};
+	suspend_get_value(&buffer, player1_ai);
+	suspend_get_value(&buffer, player2_ai);
+	transfer_match(&buffer, &state, false);
+	if (buffer.overflowed || buffer.size != buffer.capacity) return false;
+
+	is_player1_ai = player1_ai;
+	is_player2_ai = player2_ai;
+	game_state = state;
+	clear_rewind_history();
+	current_gamemode = GM_PAUSED;
+	start_fade(.15f);
+
+	suspend_stats.resumed = true;
+	suspend_stats.resume_time = os_get_time_counter() - begin;
+	return true;
+}
+
+// Every frame: autosaves the running match every few seconds of play
+internal void
+update_suspend_autosave(float dt) {
+	if (current_gamemode != GM_GAMEPLAY || !is_match_in_progress()) return;
+	suspend_autosave_timer += dt;
+	if (suspend_autosave_timer >= SUSPEND_AUTOSAVE_SECONDS) {
+		suspend_autosave_timer = 0.f;
+		suspend_match();
+	}
+}
+
+// One line summary for the platform to print at exit
+internal int
+format_suspend_report(char* buffer, int size) {
+	double us_per_count = 1000000.0 / (double)os_get_time_frequency();
+	int length = snprintf(buffer, size, "suspend: %llu writes, mean %.0fus, max %.0fus", (unsigned long long)suspend_stats.writes,
+		suspend_stats.writes ? suspend_stats.total_write_time * us_per_count / suspend_stats.writes : 0.0,
+		suspend_stats.max_write_time * us_per_count);
+	if (suspend_stats.resumed && length < size) length += snprintf(buffer + length, size - length, ", resumed in %.0fus", suspend_stats.resume_time * us_per_count);
+	return length;
+}
@@ -0,0 +1,121 @@
+// <------------------------- Live Tuning ---------------------------------------------->
+// The gameplay constants above can be overridden from a text file of `name value` lines, where
+// `#` starts a comment and values missing from the file keep what they have. The platform reads
+// the file at startup and then on its own thread whenever it changes: the thread parses it into
+// a Tuning_Values copy and hands that to the game through a lock-free mailbox, and the game
+// applies the newest copy between ticks, so a reload never stalls a frame or lands mid-tick.
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+
+struct Tuning_Entry {
+	const char* name;
+	real* real_value;
+	int* int_value;
+};
+
+global_variable Tuning_Entry tuning_entries[] = {
+	{ "player_fixed_ddpx", &player_fixed_ddpx, 0 },
+	{ "player_fixed_ddpy", &player_fixed_ddpy, 0 },
+	{ "player_friction_coeff", &player_friction_coeff, 0 },
+	{ "ball_max_speed_x", &ball_max_speed_x, 0 },
+	{ "ball_min_speed_x", &ball_min_speed_x, 0 },
+	{ "ball_max_speed_y", &ball_max_speed_y, 0 },
+	{ "front_hit_coeff_x", &front_hit_coeff_x, 0 },
+	{ "back_hit_coeff_x", &back_hit_coeff_x, 0 },
+	{ "player_transfer_coeff_x", &player_transfer_coeff_x, 0 },
+	{ "player_transfer_coeff_y", &player_transfer_coeff_y, 0 },
+	{ "ball_pos_transfer_coeff_y", &ball_pos_transfer_coeff_y, 0 },
+	{ "arena_coverage", &arena_coverage, 0 },
+	{ "win_score", 0, &win_score },
+	{ "ai_reaction_delay", &ai_reaction_delay, 0 },
+	{ "ai_aim_error", &ai_aim_error, 0 },
+	{ "animated_menu_background", 0, &animated_menu_background },
+};
+
+#define TUNING_ENTRY_COUNT (int)(sizeof(tuning_entries) / sizeof(tuning_entries[0]))
+
+struct Tuning_Values {
+	float values[TUNING_ENTRY_COUNT];
+	bool present[TUNING_ENTRY_COUNT];
+	int present_count;
+	int error_line;                     // First line that could not be parsed, 0 if none
+};
+
+// Parses null terminated text, only touches the out values so it can run on any thread
+internal void
+parse_tuning(Tuning_Values* out, const char* text) {
+	*out = {};
+	int line = 1;
+	for (const char* at = text; *at; line++) {
+		while (*at == ' ' || *at == '\t' || *at == '\r') at++;
+
+		if (*at != '#' && *at != '\n' && *at) {
+			const char* name = at;
+			while (*at && *at != ' ' && *at != '\t' && *at != '\n' && *at != '\r') at++;
+			int name_length = (int)(at - name);
+
+			char* value_end;
+			float value = strtof(at, &value_end);
+			int entry = -1;
+			for (int e = 0; e < TUNING_ENTRY_COUNT; e++) {
+				if ((int)strlen(tuning_entries[e].name) == name_length && !strncmp(tuning_entries[e].name, name, name_length)) entry = e;
+			}
+
+			if (entry < 0 || value_end == at) {
+				if (!out->error_line) out->error_line = line;
+			}
+			else {
+				if (!out->present[entry]) out->present_count++;
+				out->values[entry] = value;
+				out->present[entry] = true;
+				at = value_end;
+			}
+		}
+
+		while (*at && *at != '\n') at++;
+		if (*at) at++;
+	}
+}
+
+internal void
+apply_tuning(const Tuning_Values* tuning) {
+	for (int e = 0; e < TUNING_ENTRY_COUNT; e++) {
+		if (!tuning->present[e]) continue;
+		if (tuning_entries[e].real_value) *tuning_entries[e].real_value = (real)tuning->values[e];
+		else *tuning_entries[e].int_value = (int)tuning->values[e];
+	}
+}
+
+// ---------------- Mailbox --------------------------------------
+// A triple buffer: the watcher thread fills its back slot and swaps it into the middle, the game
+// swaps the middle out when it is flagged fresh. Neither side ever waits for the other.
+#define TUNING_SLOT_MASK 3
+#define TUNING_FRESH 4
+
+global_variable Tuning_Values tuning_slots[3];
+global_variable std::atomic<int> tuning_middle(0);
+global_variable int tuning_back = 1;        // Only touched by the watcher thread
+global_variable int tuning_front = 2;       // Only touched by the game
+
+// Called by the watcher thread with a freshly parsed file
+internal void
+publish_tuning(const Tuning_Values* tuning) {
+	tuning_slots[tuning_back] = *tuning;
+	tuning_back = tuning_middle.exchange(tuning_back | TUNING_FRESH, std::memory_order_acq_rel) & TUNING_SLOT_MASK;
+}
+
+// For the platform: a settled screen is simulated again when new values are waiting
+internal bool
+has_published_tuning() {
+	return (tuning_middle.load(std::memory_order_relaxed) & TUNING_FRESH) != 0;
+}
+
+// Called by the game between ticks, returns true if new values were applied
+internal bool
+apply_published_tuning() {
+	if (!(tuning_middle.load(std::memory_order_relaxed) & TUNING_FRESH)) return false;
+	tuning_front = tuning_middle.exchange(tuning_front, std::memory_order_acq_rel) & TUNING_SLOT_MASK;
+	apply_tuning(&tuning_slots[tuning_front]);
+	return true;
+}
@@ -16,3 +16,13 @@ clamp(int min, int value, int max) {
 	else if (value > max) return max;
 	else return value;
 }
+
+// xorshift32 pseudo-random numbers, state must start non-zero
+inline u32
+random_u32(u32* state) {
+	u32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
@@ -1,4 +1,7 @@
+#include <winsock2.h>                 // Must come before windows.h, which pulls in the old winsock.h
+#include <ws2tcpip.h>
 #include <windows.h>
+#include <stdio.h>
 #include "utils.cpp"
 
 struct Render_State {
@@ -12,12 +15,386 @@ struct Render_State {
 };
 
 global_variable bool running = true;
+global_variable bool force_present = true; // Present the next frame even if the game reports no change (eg. new buffer)
 global_variable Render_State render_state;
+global_variable int framebuffer_max_width, framebuffer_max_height;
 
 #include "renderer.cpp"
 #include "platform_common.cpp"
+#include "input_latency.cpp"
+
+// ------------ OS Helper Functions ----------------------------
+#include <cassert>
+
+// The one block of memory the program runs in, see init_game_memory()
+internal void*
+os_reserve_memory(size_t size) {
+	os_allocation_count++;
+	return VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+// Reads into the given arena, with a 0 after the data so text files can be used as strings
+internal String
+os_read_entire_file(Memory_Arena* arena, const char* file_path) {
+	String result = { 0 };
+
+	HANDLE file_handle = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		return result;
+	}
+
+	DWORD file_size = GetFileSize(file_handle, 0);
+	char* data = (char*)push_size(arena, (size_t)file_size + 1);
+
+	DWORD bytes_read;
+	if (data && ReadFile(file_handle, data, file_size, &bytes_read, 0) && file_size == bytes_read) {
+		data[file_size] = 0;
+		result.data = data;
+		result.size = file_size;
+	}
+
+	CloseHandle(file_handle);
+	return result;
+}
+
+internal String
+os_read_save_file(Memory_Arena* arena) {
+	return os_read_entire_file(arena, "save.pongsav");
+}
+
+internal int
+os_write_entire_file(const char* file_path, String data) {
+	int result = false;
+
+	HANDLE file_handle = CreateFileA(file_path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		assert(0);
+		return result;
+	}
+
+	DWORD bytes_written;
+	result = WriteFile(file_handle, data.data, (DWORD)data.size, &bytes_written, 0) && bytes_written == data.size;
+
+	CloseHandle(file_handle);
+	return result;
+}
+
+internal int
+os_write_save_file(String data) {
+	return os_write_entire_file("save.pongsav", data);
+}
+
+// The suspended match file stays open and is overwritten in place, a torn write fails its checksum
+global_variable HANDLE suspend_file = INVALID_HANDLE_VALUE;
+
+internal String
+os_read_suspend_file(Memory_Arena* arena) {
+	return os_read_entire_file(arena, "suspend.pongsav");
+}
+
+internal int
+os_write_suspend_file(String data) {
+	if (suspend_file == INVALID_HANDLE_VALUE) suspend_file = CreateFileA("suspend.pongsav", GENERIC_WRITE, FILE_SHARE_READ, 0, OPEN_ALWAYS, 0, 0);
+	if (suspend_file == INVALID_HANDLE_VALUE) return false;
+
+	DWORD bytes_written;
+	SetFilePointer(suspend_file, 0, 0, FILE_BEGIN);
+	return WriteFile(suspend_file, data.data, (DWORD)data.size, &bytes_written, 0) && bytes_written == data.size && SetEndOfFile(suspend_file);
+}
+
+// The profile store's paged file stays open, pages are read and records rewritten in place
+global_variable HANDLE profile_file = INVALID_HANDLE_VALUE;
+
+internal bool
+open_profile_file() {
+	if (profile_file == INVALID_HANDLE_VALUE) profile_file = CreateFileA("profiles.pongdb", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, OPEN_ALWAYS, 0, 0);
+	return profile_file != INVALID_HANDLE_VALUE;
+}
+
+// Bytes read, fewer than size past the end of the file
+internal int
+os_read_profile_file(void* buffer, u64 offset, u32 size) {
+	if (!open_profile_file()) return 0;
+	OVERLAPPED position = {};
+	position.Offset = (DWORD)offset;
+	position.OffsetHigh = (DWORD)(offset >> 32);
+	DWORD bytes_read = 0;
+	if (!ReadFile(profile_file, buffer, size, &bytes_read, &position)) return 0;
+	return (int)bytes_read;
+}
+
+internal int
+os_write_profile_file(const void* data, u64 offset, u32 size) {
+	if (!open_profile_file()) return false;
+	OVERLAPPED position = {};
+	position.Offset = (DWORD)offset;
+	position.OffsetHigh = (DWORD)(offset >> 32);
+	DWORD bytes_written = 0;
+	return WriteFile(profile_file, data, size, &bytes_written, &position) && bytes_written == size;
+}
+
+// High resolution (<1us) time stamp, used by the game to seed its randomness
+internal u64
+os_get_time_counter() {
+	LARGE_INTEGER curr_time;
+	QueryPerformanceCounter(&curr_time);
+	return curr_time.QuadPart;
+}
+
+// Counts per second of os_get_time_counter()
+internal u64
+os_get_time_frequency() {
+	LARGE_INTEGER perf;
+	QueryPerformanceFrequency(&perf);
+	return perf.QuadPart;
+}
+
+// Message times are GetTickCount() ms. One reading of both clocks at startup maps them onto the
+// counter, so a key is timestamped when it was posted rather than when the frame got round to it.
+// The tick only moves every 10-16 ms, and that is how precise these timestamps are.
+global_variable DWORD message_tick_base;
+global_variable u64 message_counter_base;
+
+internal void
+init_message_clock() {
+	message_tick_base = GetTickCount();
+	message_counter_base = os_get_time_counter();
+
+	DWORD adjustment, increment;
+	BOOL adjustment_disabled;
+	if (GetSystemTimeAdjustment(&adjustment, &increment, &adjustment_disabled)) input_latency.timestamp_resolution_us = increment / 10;
+}
+
+// A message time on the os_get_time_counter() clock, never later than now
+internal u64
+message_time_to_counter(DWORD message_time) {
+	u64 now = os_get_time_counter();
+	u64 time = message_counter_base + (u64)(DWORD)(message_time - message_tick_base) * os_get_time_frequency() / 1000;
+	return time < now ? time : now;
+}
+
+// UDP socket connected to a single remote peer, non-blocking
+global_variable SOCKET udp_socket = INVALID_SOCKET;
+
+internal bool
+os_udp_open(u16 local_port, const char* remote_host, u16 remote_port) {
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data)) return false;
+
+	udp_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (udp_socket == INVALID_SOCKET) {
+		WSACleanup();
+		return false;
+	}
+
+	sockaddr_in local = {};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(local_port);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	char port[8];
+	sprintf_s(port, sizeof(port), "%u", remote_port);
+
+	addrinfo* remote = 0;
+	if (bind(udp_socket, (sockaddr*)&local, sizeof(local)) == SOCKET_ERROR || getaddrinfo(remote_host, port, &hints, &remote)) {
+		closesocket(udp_socket);
+		udp_socket = INVALID_SOCKET;
+		WSACleanup();
+		return false;
+	}
+	int connected = connect(udp_socket, remote->ai_addr, (int)remote->ai_addrlen);
+	freeaddrinfo(remote);
+	u_long non_blocking = 1;
+	ioctlsocket(udp_socket, FIONBIO, &non_blocking);
+	return connected == 0;
+}
+
+internal void
+os_udp_close() {
+	if (udp_socket != INVALID_SOCKET) {
+		closesocket(udp_socket);
+		WSACleanup();
+	}
+	udp_socket = INVALID_SOCKET;
+}
+
+internal void
+os_udp_send(const void* data, int size) {
+	send(udp_socket, (const char*)data, size, 0);
+}
+
+// Returns the size of the datagram read, or -1 when there is none
+internal int
+os_udp_receive(void* buffer, int max_size) {
+	int result = recv(udp_socket, (char*)buffer, max_size, 0);
+	return result == SOCKET_ERROR ? -1 : result;
+}
+
 #include "game.cpp"
 
+// ---------------- Present Pipeline ----------------------------
+// -pipeline moves StretchDIBits() to a present thread of its own with three framebuffers (see
+// present_pipeline.cpp), woken by an event the game sets and never waits on. Without it the game
+// thread presents each frame itself, timed the same way for the exit report.
+#include "present_pipeline.cpp"
+
+struct Win32_Presenter {
+	bool pipelined;
+	HWND window;
+	Present_Pipeline pipeline;
+	Present_Stats serial_stats;
+	HANDLE wake;
+	HANDLE thread;
+	std::atomic<bool> running;
+};
+
+global_variable Win32_Presenter win32_presenter;
+
+internal DWORD WINAPI
+present_thread(void* param) {
+	Win32_Presenter* presenter = (Win32_Presenter*)param;
+	HDC hdc = GetDC(presenter->window);
+	while (WaitForSingleObject(presenter->wake, INFINITE) == WAIT_OBJECT_0 && presenter->running.load(std::memory_order_relaxed)) {
+		Present_Frame* frame = take_present_frame(&presenter->pipeline);
+		if (!frame) continue;
+
+		// The window may have been resized since, the frame keeps the size it was drawn at
+		BITMAPINFO bitmap_info = {};
+		bitmap_info.bmiHeader.biSize = sizeof(bitmap_info.bmiHeader);
+		bitmap_info.bmiHeader.biWidth = frame->width;
+		bitmap_info.bmiHeader.biHeight = frame->height;
+		bitmap_info.bmiHeader.biPlanes = 1;
+		bitmap_info.bmiHeader.biBitCount = 32;
+		bitmap_info.bmiHeader.biCompression = BI_RGB;
+
+		u64 begin = os_get_time_counter();
+		StretchDIBits(hdc, 0, 0, frame->width, frame->height, 0, 0, frame->width, frame->height,
+			frame->pixels, &bitmap_info, DIB_RGB_COLORS, SRCCOPY);
+		u64 end = os_get_time_counter();
+		record_present(&presenter->pipeline.stats, frame->drawn_time, begin, end);
+		record_input_latency(&input_latency, frame->event_times, frame->event_count, end, os_get_time_frequency());
+	}
+	ReleaseDC(presenter->window, hdc);
+	return 0;
+}
+
+// The game keeps drawing into render_state.memory, which becomes the first of the three buffers
+internal bool
+start_present_pipeline(Win32_Presenter* presenter, HWND window, size_t framebuffer_size) {
+	if (!init_present_pipeline(&presenter->pipeline, render_state.memory, &game_memory.permanent, framebuffer_size)) return false;
+	presenter->window = window;
+	presenter->wake = CreateEventA(0, FALSE, FALSE, 0);
+	if (!presenter->wake) return false;
+	presenter->running.store(true, std::memory_order_relaxed);
+	presenter->thread = CreateThread(0, 0, present_thread, presenter, 0, 0);
+	if (!presenter->thread) return false;
+	presenter->pipelined = true;
+	return true;
+}
+
+internal void
+stop_present_pipeline(Win32_Presenter* presenter) {
+	presenter->running.store(false, std::memory_order_relaxed);
+	SetEvent(presenter->wake);
+	WaitForSingleObject(presenter->thread, INFINITE);
+	CloseHandle(presenter->thread);
+	CloseHandle(presenter->wake);
+}
+
+// ---------------- Render Workers ------------------------------
+// Threads that draw bands of rows alongside the game thread (see run_row_bands in renderer.cpp).
+// A frame is cut into a few more bands than there are threads and each thread takes the next band
+// left, so one that gets descheduled holds up a small band rather than a whole share of the frame.
+#define RENDER_WORKERS_MAX 15
+#define RENDER_BANDS_PER_THREAD 4
+
+struct Render_Workers {
+	HANDLE threads[RENDER_WORKERS_MAX];
+	int count;
+	HANDLE start;                           // Released once per worker for each job
+	HANDLE done;                            // Released by each worker once no band is left
+	Draw_Rows* draw_rows;
+	void* data;
+	int height;
+	int band_count;
+	std::atomic<int> next_band;
+	std::atomic<bool> running;
+};
+
+global_variable Render_Workers render_workers;
+
+internal void
+draw_next_bands(Render_Workers* workers) {
+	for (;;) {
+		int band = workers->next_band.fetch_add(1, std::memory_order_relaxed);
+		if (band >= workers->band_count) return;
+		int y_begin = (int)((s64)workers->height * band / workers->band_count);
+		int y_end = (int)((s64)workers->height * (band + 1) / workers->band_count);
+		workers->draw_rows(workers->data, y_begin, y_end);
+	}
+}
+
+internal DWORD WINAPI
+render_worker_thread(void* param) {
+	Render_Workers* workers = (Render_Workers*)param;
+	while (WaitForSingleObject(workers->start, INFINITE) == WAIT_OBJECT_0 && workers->running.load(std::memory_order_relaxed)) {
+		draw_next_bands(workers);
+		ReleaseSemaphore(workers->done, 1, 0);
+	}
+	return 0;
+}
+
+// The semaphores order the job's fields before the workers read them and the rows before the return
+internal void
+run_bands_on_render_workers(Draw_Rows* draw_rows, void* data, int height) {
+	Render_Workers* workers = &render_workers;
+	int band_count = (workers->count + 1) * RENDER_BANDS_PER_THREAD;
+	workers->draw_rows = draw_rows;
+	workers->data = data;
+	workers->height = height;
+	workers->band_count = band_count < height ? band_count : height;
+	workers->next_band.store(0, std::memory_order_relaxed);
+	ReleaseSemaphore(workers->start, workers->count, 0);
+	draw_next_bands(workers);
+	for (int i = 0; i < workers->count; i++) WaitForSingleObject(workers->done, INFINITE);
+}
+
+// One thread per other processor, with none the game thread keeps drawing every row itself
+internal void
+start_render_workers() {
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+	int count = (int)system_info.dwNumberOfProcessors - 1;
+	if (count > RENDER_WORKERS_MAX) count = RENDER_WORKERS_MAX;
+	if (count <= 0) return;
+	render_workers.start = CreateSemaphoreA(0, 0, RENDER_WORKERS_MAX, 0);
+	render_workers.done = CreateSemaphoreA(0, 0, RENDER_WORKERS_MAX, 0);
+	if (!render_workers.start || !render_workers.done) return;
+
+	render_workers.running.store(true, std::memory_order_relaxed);
+	while (render_workers.count < count) {
+		HANDLE thread = CreateThread(0, 0, render_worker_thread, &render_workers, 0, 0);
+		if (!thread) break;
+		render_workers.threads[render_workers.count++] = thread;
+	}
+	if (render_workers.count) run_row_bands = run_bands_on_render_workers;
+}
+
+internal void
+stop_render_workers() {
+	run_row_bands = 0;
+	render_workers.running.store(false, std::memory_order_relaxed);
+	if (render_workers.count) ReleaseSemaphore(render_workers.start, render_workers.count, 0);
+	for (int i = 0; i < render_workers.count; i++) {
+		WaitForSingleObject(render_workers.threads[i], INFINITE);
+		CloseHandle(render_workers.threads[i]);
+	}
+	render_workers.count = 0;
+}
+
 // WndProc func to handle messages from Windows OS (event-driven)
 LRESULT CALLBACK window_callback(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
 	LRESULT result = 0;
@@ -33,11 +410,10 @@ LRESULT CALLBACK window_callback(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPa
 			render_state.width = rect.right - rect.left;
 			render_state.height = rect.bottom - rect.top;
 
-			int size = render_state.width * render_state.height * sizeof(u32);
-
-			// Free prev. buffer memory on changing size so that new buffer memory can be allocated
-			if (render_state.memory) VirtualFree(render_state.memory, 0, MEM_RELEASE); // Free all (specified by 0 and MEM_RELEASE) memory at address render_state.memory
-			render_state.memory = VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE); // render_state.size memory allocated with READWRITE perms using MEM_COMMIT | MEM_RESERVE type allocation
+			// The framebuffer was reserved at startup for the whole virtual desktop, a resize only changes how much of it is used
+			// (a window somehow bigger than that keeps the reserved size and its extra area is left unpainted)
+			if (render_state.width > framebuffer_max_width) render_state.width = framebuffer_max_width;
+			if (render_state.height > framebuffer_max_height) render_state.height = framebuffer_max_height;
 
 			// Bitmap_Info struct member initialization
 			render_state.bitmap_info.bmiHeader.biSize = sizeof(render_state.bitmap_info.bmiHeader); // The number of bytes required by the structure
@@ -47,6 +423,18 @@ LRESULT CALLBACK window_callback(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPa
 			render_state.bitmap_info.bmiHeader.biBitCount = 32;                                     // number of bits-per-pixel (32 bits since we're using u32 for each pixel)
 			render_state.bitmap_info.bmiHeader.biCompression = BI_RGB;                              // type of compression for a compressed bottom-up (ie. height > 0) bitmap, BI_RGB => uncompressed
 
+			force_present = true;       // New buffer is blank, so the idle loop must redraw it
+		} break;
+
+		case WM_PAINT: {                // Presents can be skipped while idle, so repaint uncovered areas from the last frame
+			PAINTSTRUCT paint;
+			HDC paint_hdc = BeginPaint(hwnd, &paint);
+			if (win32_presenter.pipelined) force_present = true;   // The last frame is the present thread's, send it a new one
+			else {
+				StretchDIBits(paint_hdc, 0, 0, render_state.width, render_state.height, 0, 0, render_state.width, render_state.height,
+					render_state.memory, &render_state.bitmap_info, DIB_RGB_COLORS, SRCCOPY);
+			}
+			EndPaint(hwnd, &paint);
 		} break;
 
 		default:                        // ..Otherwise, just create the default window procedure for the given parameters and return it
@@ -55,11 +443,222 @@ LRESULT CALLBACK window_callback(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPa
 	return result;
 }
 
+// ---------------- Live Tuning ---------------------------------
+// tuning.txt is reloaded when a file in the working directory changes and its write time moved.
+// Reads and parses happen on the watcher thread, into an arena of its own, and reach the game
+// through the mailbox in tuning.cpp.
+#define TUNING_FILE_MAX_SIZE (64 * 1024)
+
+struct Tuning_Watch {
+	const char* path;
+	Memory_Arena arena;
+	HANDLE change;
+	HANDLE published;  // Signalled after each reload, so a settled screen wakes up to apply it
+	FILETIME last_write_time;
+	Tuning_Values values;
+};
+
+global_variable Tuning_Watch tuning_watch;
+
+internal bool
+read_tuning_file(Tuning_Watch* watch) {
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(watch->path, GetFileExInfoStandard, &attributes)) return false;
+	if (!CompareFileTime(&attributes.ftLastWriteTime, &watch->last_write_time)) return false;
+
+	// A file still open in the editor fails to read, its next write notifies again
+	watch->arena.used = 0;
+	String file = os_read_entire_file(&watch->arena, watch->path);
+	if (!file.data) return false;
+	watch->last_write_time = attributes.ftLastWriteTime;
+
+	parse_tuning(&watch->values, file.data);
+	if (watch->values.error_line) {
+		char message[320];
+		sprintf_s(message, sizeof(message), "%s(%d): not a tuning value\n", watch->path, watch->values.error_line);
+		OutputDebugStringA(message);
+	}
+	return true;
+}
+
+internal DWORD WINAPI
+tuning_watch_thread(void* param) {
+	Tuning_Watch* watch = (Tuning_Watch*)param;
+	while (WaitForSingleObject(watch->change, INFINITE) == WAIT_OBJECT_0) {
+		if (read_tuning_file(watch)) {
+			publish_tuning(&watch->values);
+			SetEvent(watch->published);
+		}
+		if (!FindNextChangeNotification(watch->change)) break;
+	}
+	return 0;
+}
+
+// Applies the file right away if there is one, then reloads it on every change
+internal void
+start_tuning_watch(Tuning_Watch* watch, const char* path) {
+	watch->path = path;
+	watch->arena.base = (u8*)push_size(&game_memory.permanent, TUNING_FILE_MAX_SIZE);
+	watch->arena.size = watch->arena.base ? TUNING_FILE_MAX_SIZE : 0;
+
+	// Watching starts before the first read so that no change can slip in between
+	watch->change = FindFirstChangeNotificationA(".", FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+	if (read_tuning_file(watch)) apply_tuning(&watch->values);
+
+	if (watch->change == INVALID_HANDLE_VALUE) return;
+	watch->published = CreateEventA(0, FALSE, FALSE, 0);
+	if (!watch->published) return;
+	HANDLE thread = CreateThread(0, 0, tuning_watch_thread, watch, 0, 0);
+	if (thread) CloseHandle(thread);
+}
+
+// ---------------- Sound ---------------------------------------
+// The mixer thread hands blocks to the default waveOut device, which paces it: SOUND_DEVICE_BLOCKS
+// blocks are queued and the thread waits for the oldest to play out before mixing the next one, so
+// an event is heard at most that many blocks after it was posted. No device, no sound.
+#define SOUND_DEVICE_BLOCKS 4
+
+struct Wave_Out_Sink {
+	HWAVEOUT device;
+	HANDLE block_done;                  // Signalled by the device as each block finishes
+	WAVEHDR headers[SOUND_DEVICE_BLOCKS];
+	s16 samples[SOUND_DEVICE_BLOCKS][SOUND_BLOCK_FRAMES * 2];
+	int next;
+};
+
+global_variable Wave_Out_Sink wave_out_sink;
+
+internal bool
+wave_out_sink_write(Sound_Sink* sink, const s16* samples, int frames) {
+	Wave_Out_Sink* wave_out = (Wave_Out_Sink*)sink->data;
+	WAVEHDR* header = &wave_out->headers[wave_out->next];
+	while ((header->dwFlags & WHDR_PREPARED) && !(header->dwFlags & WHDR_DONE)) {
+		WaitForSingleObject(wave_out->block_done, INFINITE);
+	}
+
+	// Late if the device has played every block it was given (and it has been given some)
+	bool on_time = !(header->dwFlags & WHDR_PREPARED);
+	for (int i = 0; i < SOUND_DEVICE_BLOCKS; i++) {
+		if ((wave_out->headers[i].dwFlags & WHDR_PREPARED) && !(wave_out->headers[i].dwFlags & WHDR_DONE)) on_time = true;
+	}
+
+	if (header->dwFlags & WHDR_PREPARED) waveOutUnprepareHeader(wave_out->device, header, sizeof(WAVEHDR));
+	memcpy(wave_out->samples[wave_out->next], samples, frames * 2 * sizeof(s16));
+	*header = {};
+	header->lpData = (LPSTR)wave_out->samples[wave_out->next];
+	header->dwBufferLength = frames * 2 * sizeof(s16);
+	waveOutPrepareHeader(wave_out->device, header, sizeof(WAVEHDR));
+	waveOutWrite(wave_out->device, header, sizeof(WAVEHDR));
+	wave_out->next = (wave_out->next + 1) % SOUND_DEVICE_BLOCKS;
+	return on_time;
+}
+
+internal void
+wave_out_sink_close(Sound_Sink* sink) {
+	Wave_Out_Sink* wave_out = (Wave_Out_Sink*)sink->data;
+	waveOutReset(wave_out->device);
+	for (int i = 0; i < SOUND_DEVICE_BLOCKS; i++) {
+		if (wave_out->headers[i].dwFlags & WHDR_PREPARED) waveOutUnprepareHeader(wave_out->device, &wave_out->headers[i], sizeof(WAVEHDR));
+	}
+	waveOutClose(wave_out->device);
+	CloseHandle(wave_out->block_done);
+}
+
+internal bool
+make_wave_out_sound_sink(Sound_Sink* sink) {
+	Wave_Out_Sink* wave_out = &wave_out_sink;
+	wave_out->block_done = CreateEventA(0, FALSE, FALSE, 0);
+	WAVEFORMATEX format = {};
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 2;
+	format.nSamplesPerSec = SOUND_SAMPLE_RATE;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = 2 * sizeof(s16);
+	format.nAvgBytesPerSec = SOUND_SAMPLE_RATE * format.nBlockAlign;
+	if (!wave_out->block_done || waveOutOpen(&wave_out->device, WAVE_MAPPER, &format, (DWORD_PTR)wave_out->block_done, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+		if (wave_out->block_done) CloseHandle(wave_out->block_done);
+		return false;
+	}
+	*sink = { wave_out, wave_out_sink_write, wave_out_sink_close };
+	return true;
+}
+
+struct Sound_Output {
+	Sound_Mixer mixer;
+	Sound_Sink sink;
+	HANDLE thread;
+	std::atomic<bool> running;
+};
+
+global_variable Sound_Output sound_output;
+
+internal DWORD WINAPI
+sound_mixer_thread(void* param) {
+	Sound_Output* output = (Sound_Output*)param;
+	s16 samples[SOUND_BLOCK_FRAMES * 2];
+	while (output->running.load(std::memory_order_relaxed)) {
+		mix_sound_block(&output->mixer, samples);
+		if (!output->sink.write(&output->sink, samples, SOUND_BLOCK_FRAMES)) output->mixer.underruns++;
+	}
+	return 0;
+}
+
+internal bool
+start_sound_output(Sound_Output* output) {
+	if (!make_wave_out_sound_sink(&output->sink)) return false;
+	init_sound_mixer(&output->mixer, &game_memory.permanent);
+	output->running.store(true, std::memory_order_relaxed);
+	output->thread = CreateThread(0, 0, sound_mixer_thread, output, 0, 0);
+	if (!output->thread) {
+		output->sink.close(&output->sink);
+		return false;
+	}
+	sound_enabled = true;
+	return true;
+}
+
+internal void
+stop_sound_output(Sound_Output* output) {
+	sound_enabled = false;
+	output->running.store(false, std::memory_order_relaxed);
+	WaitForSingleObject(output->thread, INFINITE);
+	CloseHandle(output->thread);
+	output->sink.close(&output->sink);
+}
+
+// A crash still writes the match in progress before the process dies
+internal LONG WINAPI
+suspend_on_crash(EXCEPTION_POINTERS* exception) {
+	suspend_match();
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
 // Entry Point for the Window-based game
 int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd) {
 	// Do not show mouse cursor
 	ShowCursor(FALSE);
 
+	// All the memory the game uses, reserved once: the framebuffer (big enough for a window over the whole
+	// virtual desktop, three of them when pipelined) and the profile index in the permanent arena, and a
+	// transient arena emptied every frame
+	bool pipelined = strstr(lpCmdLine, "-pipeline") != 0;
+	framebuffer_max_width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+	framebuffer_max_height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+	size_t framebuffer_size = (size_t)framebuffer_max_width * framebuffer_max_height * sizeof(u32);
+	{
+		size_t permanent_size = (pipelined ? PRESENT_BUFFER_COUNT : 1) * framebuffer_size + 1024 * 1024 +
+			get_profile_store_memory_size(get_profile_store_capacity());
+		size_t transient_size = 1024 * 1024;
+		void* block = os_reserve_memory(permanent_size + transient_size);
+		if (!block) return 1;
+		init_game_memory(&game_memory, block, permanent_size, transient_size);
+		render_state.memory = push_size(&game_memory.permanent, framebuffer_size);
+	}
+
+	// Gameplay constants from tuning.txt, kept live while the game runs
+	start_tuning_watch(&tuning_watch, "tuning.txt");
+	start_sound_output(&sound_output);
+
 	// Create a Window class that can be used to create our kind of windows
 	WNDCLASS window_class = {};
 	window_class.style = CS_HREDRAW | CS_VREDRAW;
@@ -93,7 +692,41 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 		SetWindowPos(window, HWND_TOP, mi.rcMonitor.left, mi.rcMonitor.top, mi.rcMonitor.right - mi.rcMonitor.left, mi.rcMonitor.bottom - mi.rcMonitor.top, SWP_NOOWNERZORDER | SWP_FRAMECHANGED);
 	}
 
+	// Remote play from the command line: -net <local port> <remote host> <remote port> <player 0|1> [delay] [rollback window],
+	// anywhere among the other flags. Asking for it and not getting it ends the run instead of starting an offline match.
+	if (const char* net = strstr(lpCmdLine, "-net ")) {
+		static char remote_host[256];
+		Netplay_Config config = {};
+		int local_port = 0, remote_port = 0;
+		config.seed = 0x1234567;
+		config.input_delay = 2;
+		config.max_rollback = 8;
+		if (sscanf_s(net, "-net %d %255s %d %d %d %d", &local_port, remote_host, (unsigned)sizeof(remote_host),
+			&remote_port, &config.local_player, &config.input_delay, &config.max_rollback) < 4) {
+			MessageBoxA(window, "Usage: -net <local port> <remote host> <remote port> <player 0|1> [delay] [rollback window]", "My Pong Game", MB_ICONERROR);
+			return 1;
+		}
+		config.local_port = (u16)local_port;
+		config.remote_host = remote_host;
+		config.remote_port = (u16)remote_port;
+		if (!start_netplay(&netplay_session, &game_state, config)) {
+			char message[320];
+			sprintf_s(message, sizeof(message), "Could not start remote play on port %d with %s:%d", local_port, remote_host, remote_port);
+			MessageBoxA(window, message, "My Pong Game", MB_ICONERROR);
+			return 1;
+		}
+		current_gamemode = GM_NETPLAY;
+	}
+
+	// An unfinished match from the last run starts paused
+	if (current_gamemode != GM_NETPLAY) resume_match();
+	SetUnhandledExceptionFilter(suspend_on_crash);
+
 	HDC hdc = GetDC(window);                  // Get Device context for our current window to be used as an argument for StretchDIBits()
+	if (pipelined) start_present_pipeline(&win32_presenter, window, framebuffer_size);   // Serial if the thread cannot start
+	start_render_workers();
+	init_message_clock();
+	u64 start_time = os_get_time_counter();
 
 	Input input = {};                         // Empty Input struct to hold Button_State for all buttons
 
@@ -110,17 +743,29 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 		performance_freq = (float)perf.QuadPart; // Get 64-bit part from LARGE_INTEGER then convert to float
 	}
 
+	// The screen is settled when the game is in an idle mode and the last frame did not change it
+	bool screen_settled = false;
+
 	while (running) {
 
+		// ------------ (0) Idle Wait --------------------------
+		// Nothing animates on a settled screen, so sleep until a message arrives or tuning.txt is
+		// reloaded instead of polling - keeps the pause screen well under 1% CPU
+		if (screen_settled) {
+			HANDLE* published = tuning_watch.published ? &tuning_watch.published : 0;
+			MsgWaitForMultipleObjects(published ? 1 : 0, published, FALSE, INFINITE, QS_ALLINPUT);
+		}
+
+		begin_frame_memory(&game_memory);
+
 		// ------------ (1) Take Input -------------------------
 		// MSG Struct used for messages from Windows (or from Users->Windows->our App)
 		MSG msgInput;
 
-		// Reset .changed for all buttons to be false at the start of each frame (will be modified by switch (vk_code) when key pressed)
-		for (int i = 0; i < BUTTON_COUNT; i++) {
-			input.buttons[i].changed = false;
-		}
+		// Forget last frame's transitions at the start of each frame (new ones are counted by process_button_transition() when a key goes down/up)
+		begin_input_frame(&input);
 
+		// Input is drained right before simulating, after any idle wait, so the frame sees every key that arrived before it started
 		while (PeekMessage(&msgInput, window, 0, 0, PM_REMOVE)) {
 
 			switch (msgInput.message) {
@@ -128,6 +773,10 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 				case WM_KEYDOWN: {                                            // *Note: Same code to be executed for KEYUP and KEYDOWN messages
 					u32 vk_code = (u32)msgInput.wParam;                       // vk_code tells which specific key was pressed
 
+					// Timestamp the key when it was posted, so the time it waited in the queue while the last frame
+					// simulated and presented is counted too
+					u64 key_time = message_time_to_counter(msgInput.time);
+
 					// Bit-twiddling to check if last bit is 0 ie. if the key with obtained vk_code is down or not (required due to *Note) 
 					bool curr_is_down = ((msgInput.lParam & (1 << 31)) == 0); 
 					// Additional notes on key state management:
@@ -141,11 +790,10 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 
 						// ------------------- Multi-line Process_Button() Macro -----------------------------------------------------------------
 						// This basically checks ((WM_KEYUP || WM_KEYDOWN) && (vk_code == vk)) ie. if vk = b key went down/up during this frame
-						// Get if button b went down or up in this frame from curr_is_down and since it did go down/up in this frame, it must have changed
+						// Every down/up of button b is counted as a half transition, so several presses in one frame are all kept
 						#define process_button(b, vk)\
 						case vk: {\
-							input.buttons[b].changed = curr_is_down != input.buttons[b].is_down;\
-							input.buttons[b].is_down = curr_is_down;\
+							process_button_transition(&input, b, curr_is_down, key_time);\
 						} break;
 
 						// Processs all buttons using the macro (includes the cases for switch)
@@ -170,26 +818,49 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 			}
 		}
 
-		// ------------ (2) Simulate stuff ---------------------
-		simulate_game(&input, delta_time);
-
-		// ------------ (3) Render stuff on screen -------------
-		// StretchDIBits() copies the color data for a rectangle of pixels in a DIB/JPEG/PNG image to the specified destination rectangle
-		StretchDIBits(
-			hdc,                        // hdc: handle to the destination device context
-			0,                          // xDest: x-coordinate of the upper-left corner of the destination rectangle (logical units)
-			0,                          // yDest: y-coordinate of the bottom-right corner of the destination rectangle (logical units)
-			render_state.width,         // DestWidth: width of the destination rectangle (logical units)
-			render_state.height,        // DestHeight: height of the of the destination rectangle (logical units)
-			0,                          // xSrc: x-coordinate of the source rectangle (in pixels)
-			0,                          // ySrc: y-coordinate of the source rectangle (in pixels)
-			render_state.width,         // SrcWidth: width of the source rectangle (in pixels)
-			render_state.height,        // SrcHeight: height of the of the source rectangle (in pixels)
-			render_state.memory,        // *lpBits: pointer to the image bits which are stored as an array of bytes
-			&render_state.bitmap_info,  // *lpbmi: pointer to a BITMAPINFO structure that contains information about the DIB
-			DIB_RGB_COLORS,             // iUsage: whether bmiColors of BITMAPINFO struct contains explicit RGB values
-			SRCCOPY                     // rop: raster-operation specifies how src pixels and dest pixels are combined to form the new image
-		);                              // If the function succeeds, the return value is the number of scan lines copied
+		// A settled screen only needs simulating again once something could have changed it
+		if (!screen_settled || any_button_changed(&input) || has_published_tuning() || force_present) {
+
+			// ------------ (2) Simulate stuff ---------------------
+			bool frame_changed = simulate_game(&input, delta_time);
+			screen_settled = is_idle_gamemode() && !frame_changed;
+
+			// ------------ (3) Render stuff on screen -------------
+			// Skip the present when the framebuffer is the same as the one already on screen
+			bool presented = frame_changed || force_present;
+			if (presented && win32_presenter.pipelined) {
+				force_present = false;
+				render_state.memory = publish_present_frame(&win32_presenter.pipeline, render_state.width, render_state.height, &input);
+				SetEvent(win32_presenter.wake);
+			}
+			else if (presented) {
+				force_present = false;
+				u64 present_begin = os_get_time_counter();
+
+				// StretchDIBits() copies the color data for a rectangle of pixels in a DIB/JPEG/PNG image to the specified destination rectangle
+				StretchDIBits(
+					hdc,                        // hdc: handle to the destination device context
+					0,                          // xDest: x-coordinate of the upper-left corner of the destination rectangle (logical units)
+					0,                          // yDest: y-coordinate of the bottom-right corner of the destination rectangle (logical units)
+					render_state.width,         // DestWidth: width of the destination rectangle (logical units)
+					render_state.height,        // DestHeight: height of the of the destination rectangle (logical units)
+					0,                          // xSrc: x-coordinate of the source rectangle (in pixels)
+					0,                          // ySrc: y-coordinate of the source rectangle (in pixels)
+					render_state.width,         // SrcWidth: width of the source rectangle (in pixels)
+					render_state.height,        // SrcHeight: height of the of the source rectangle (in pixels)
+					render_state.memory,        // *lpBits: pointer to the image bits which are stored as an array of bytes
+					&render_state.bitmap_info,  // *lpbmi: pointer to a BITMAPINFO structure that contains information about the DIB
+					DIB_RGB_COLORS,             // iUsage: whether bmiColors of BITMAPINFO struct contains explicit RGB values
+					SRCCOPY                     // rop: raster-operation specifies how src pixels and dest pixels are combined to form the new image
+				);                              // If the function succeeds, the return value is the number of scan lines copied
+				u64 present_end = os_get_time_counter();
+				record_present(&win32_presenter.serial_stats, present_begin, present_begin, present_end);
+
+				// Key arrival to present, for every transition this frame simulated (the present thread does this when pipelined)
+				record_input_latency(&input_latency, input.event_times, input.event_count, present_end, os_get_time_frequency());
+			}
+			else record_unpresented_input(&input_latency, &input);
+		}
 
 		// ----------- End of Frame - Time Delta Calculation -----------------
 		// Must be inside running loop to capture end of frame time correctly
@@ -201,6 +872,49 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 		// Divide the difference by secs per frame to get the delta time in seconds
 		delta_time = (float)(frame_end_time.QuadPart - frame_begin_time.QuadPart) / performance_freq;
 		frame_begin_time = frame_end_time;         // Curr. frame_end_time is the next frame_begin_time
+
+		end_frame_memory(&game_memory);
 	}
 
+	// Closing the window mid-match keeps it for the next run
+	suspend_match();
+	bool had_sound = sound_enabled;
+	if (had_sound) stop_sound_output(&sound_output);
+	if (win32_presenter.pipelined) stop_present_pipeline(&win32_presenter);
+	stop_render_workers();
+	double wall_seconds = (double)(os_get_time_counter() - start_time) / (double)os_get_time_frequency();
+
+	// Memory high-water marks, suspend, rewind, profiles, present and sound timings, in the debugger's output window
+	{
+		char report[256];
+		format_memory_report(&game_memory, report, sizeof(report));
+		OutputDebugStringA(report);
+		OutputDebugStringA("\n");
+		format_suspend_report(report, sizeof(report));
+		OutputDebugStringA(report);
+		OutputDebugStringA("\n");
+		format_rewind_report(report, sizeof(report));
+		OutputDebugStringA(report);
+		OutputDebugStringA("\n");
+		format_profile_report(report, sizeof(report));
+		OutputDebugStringA(report);
+		OutputDebugStringA("\n");
+		Win32_Presenter* presenter = &win32_presenter;
+		format_present_report(presenter->pipelined ? &presenter->pipeline.stats : &presenter->serial_stats,
+			presenter->pipelined ? &presenter->pipeline : 0, wall_seconds, report, sizeof(report));
+		OutputDebugStringA(report);
+		OutputDebugStringA("\n");
+		if (had_sound) {
+			format_sound_report(&sound_output.mixer, report, sizeof(report));
+			OutputDebugStringA(report);
+			OutputDebugStringA("\n");
+		}
+	}
+
+	// Input latency histogram on request: Pong_Game.exe -input-latency
+	if (strstr(lpCmdLine, "-input-latency")) {
+		static char latency_text[16 * 1024];
+		String latency_csv = { latency_text, (unsigned int)format_latency_histogram(&input_latency, latency_text, sizeof(latency_text)) };
+		os_write_entire_file("input_latency.csv", latency_csv);
+	}
 }
@@ -0,0 +1,49 @@
+#!/bin/sh
+# Profile-guided build of the Linux targets, compared against the plain -O2 build.
+# Usage: scripts/pgo.sh [build dir]     (default: build-pgo)
+#   1. -O2 reference build                          <dir>/o2
+#   2. instrumented build                           <dir>/pgo
+#   3. training: a scripted match and pong_bench -train
+#   4. the same build directory rebuilt with the profile, so GCC finds its .gcda files
+#   5. three benchmark runs of each build, merged and compared
+# CXX selects the compiler as usual; with Clang the raw profiles are merged with llvm-profdata.
+set -e
+
+src=$(cd "$(dirname "$0")/.." && pwd)
+out=$(mkdir -p "${1:-build-pgo}" && cd "${1:-build-pgo}" && pwd)
+profile="$out/profile"
+jobs=$(nproc 2>/dev/null || echo 1)
+
+cmake -S "$src" -B "$out/o2" -DCMAKE_BUILD_TYPE=Release >/dev/null
+cmake --build "$out/o2" -j"$jobs"
+
+rm -rf "$profile"
+cmake -S "$src" -B "$out/pgo" -DCMAKE_BUILD_TYPE=Release -DPONG_PGO=GENERATE -DPONG_PGO_DIR="$profile" >/dev/null
+cmake --build "$out/pgo" -j"$jobs" --clean-first
+
+echo "training..."
+mkdir -p "$out/train"
+cd "$out/train"
+# Into a single player match, a while of play, pause and resume, then back out to the menu
+waits=$(printf '%0600d' 0 | tr 0 .)
+(printf '\n\n'; printf '%s' "$waits"; printf 'p..p'; printf '%s' "$waits"; printf '\033\n') | "$out/pgo/pong_linux" -unpaced >/dev/null
+"$out/pgo/pong_bench" -train
+
+if ls "$profile"/*.profraw >/dev/null 2>&1; then
+	llvm-profdata merge -output="$profile/default.profdata" "$profile"/*.profraw
+fi
+
+cmake -S "$src" -B "$out/pgo" -DPONG_PGO=USE >/dev/null
+cmake --build "$out/pgo" -j"$jobs" --clean-first
+
+echo "benchmarking..."
+for build in o2 pgo; do
+	for run in 1 2 3; do
+		"$out/$build/pong_bench" -json "$out/$build-$run.json" >/dev/null
+	done
+	"$out/$build/pong_bench" -merge "$out/$build-1.json" "$out/$build-2.json" "$out/$build-3.json" -json "$out/$build.json" >/dev/null
+done
+
+# The threshold only keeps the exit code quiet, this is a report rather than a gate
+echo "PGO build against -O2 (negative is faster):"
+"$out/pgo/pong_bench" -merge "$out/pgo.json" -baseline "$out/o2.json" -threshold 1000 || true